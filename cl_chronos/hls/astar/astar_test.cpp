@@ -74,6 +74,9 @@ ALL TIMES.
 #include <stdlib.h>
 #include <vector>
 #include "queue"
+#include <thread>
+
+#include "../../tools/graph_gen/latlon_bin.h"
 
 
 const double EarthRadius_m = 6371000.0;
@@ -87,7 +90,8 @@ struct Adj {
 
 struct Vertex {
     double lat, lon;  // in RADIANS
-    std::vector<Adj> adj;
+    Adj* adj;       // n_adj entries
+    uint32_t n_adj;
 
     // Ephemeral state (used during search)
     uint32_t prev; // nullptr if not visited (not in closed set)
@@ -115,70 +119,35 @@ uint32_t destNode;
 uint32_t actDist;
 std::string graph_name = "monaco";
 
-uint32_t readU (std::ifstream& f){
-      union U {
-          uint32_t val;
-          char bytes[sizeof(uint32_t)];
-      };
-      U u;
-      f.read(u.bytes, sizeof(uint32_t));
-      assert(!f.fail());
-      return u.val;
-  };
-double readD (std::ifstream& f){
-    union U {
-        double val;
-        char bytes[sizeof(double)];
-    };
-    U u;
-    f.read(u.bytes, sizeof(double));
-    assert(!f.fail());
-    return u.val;
-};
-
 void LoadGraph(const char* file) {
-    const uint32_t MAGIC_NUMBER = 0x150842A7 + 0;  // increment every time you change the file format
-    std::ifstream f;
-    f.open(file, std::ios::binary);
-    if (!f.is_open()) {
-        printf("ERROR: Could not open input file\n");
-        exit(1);
-    }
-
-    uint32_t magic = readU(f);
-    if (magic != MAGIC_NUMBER) {
-        printf("ERROR: Wrong input file format (magic number %d, expected %d)\n",
-                magic, MAGIC_NUMBER);
-        exit(1);
-    }
-
-    numNodes = readU(f);
-    printf("Reading %d nodes...\n", numNodes);
+    LatLonBin g;
+    g.open(file);
+    numNodes = g.numV;
 
+    // One adjacency array for the whole graph, filled in parallel
     graph = new Vertex[numNodes];
-    uint32_t i = 0;
-    while (i < numNodes) {
-        graph[i].lat = readD(f);
-        graph[i].lon = readD(f);
-        uint32_t n = readU(f);
-        graph[i].adj.resize(n);
-        for (uint32_t j = 0; j < n; j++) graph[i].adj[j].n = readU(f);
-        for (uint32_t j = 0; j < n; j++) graph[i].adj[j].d_m = readD(f)*EarthRadius_m;
-
-        graph[i].currentF = ~0;
-        graph[i].prev = 0;
-		i++;
-    }
-
-    f.get();
-    assert(f.eof());
+    Adj* adjs = new Adj[g.numE];
+    g.ForVertices(std::thread::hardware_concurrency(), [&](uint32_t lo, uint32_t hi) {
+        for (uint32_t i = lo; i < hi; i++) {
+            graph[i].lat = g.lat(i);
+            graph[i].lon = g.lon(i);
+            graph[i].adj = adjs + g.edge_offset[i];
+            graph[i].n_adj = g.degree(i);
+            for (uint32_t j = 0; j < graph[i].n_adj; j++) {
+                graph[i].adj[j].n = g.neighbor(i, j);
+                graph[i].adj[j].d_m = g.dist(i, j)*EarthRadius_m;
+            }
+            graph[i].currentF = ~0;
+            graph[i].prev = 0;
+        }
+    });
 
 #if 1
     FILE* fout = fopen("fout","w");
     // Print graph
     for (uint32_t i = 0; i < numNodes; i++) {
         fprintf(fout, "%6d: %7f %7f", i, graph[i].lat, graph[i].lon);
-        for (int j= 0; j<graph[i].adj.size();j++) {
+        for (int j= 0; j<graph[i].n_adj;j++) {
         	Adj a = graph[i].adj[j];
         	fprintf(fout, " %5ld %7f", a.n, a.d_m);
         }
@@ -186,10 +155,8 @@ void LoadGraph(const char* file) {
     }
 #endif
 
-    uint64_t adjs = 0;
-    for (uint32_t i = 0; i < numNodes; i++) adjs += graph[i].adj.size();
-    printf("Read %d nodes, %ld adjacencies\n", numNodes, adjs);
-    numEdges = adjs;
+    printf("Read %d nodes, %ld adjacencies\n", numNodes, g.numE);
+    numEdges = g.numE;
 
 }
 
@@ -240,7 +207,7 @@ void WriteFile() {
 	uint32_t offset = 0;
 	for (int i=0;i<numNodes;i++) {
 		data[BASE_EDGE_OFFSET + i] = offset;
-		for (int j= 0; j<graph[i].adj.size();j++) {
+		for (int j= 0; j<graph[i].n_adj;j++) {
 			Adj a = graph[i].adj[j];
 			data[BASE_NEIGHBORS + (offset*2)  ] = a.n;
 			data[BASE_NEIGHBORS + (offset*2)+1] = a.d_m;
@@ -322,7 +289,7 @@ int main () {
     			actDist = t.fScore;
     			break;
     		}
-			for (int i= 0; i<graph[t.vertex].adj.size();i++){
+			for (int i= 0; i<graph[t.vertex].n_adj;i++){
 				Adj neighbor = graph[t.vertex].adj[i];
 				Vertex* n = &graph[neighbor.n];
 				uint32_t nFScore = t.fScore + (neighbor.d_m);
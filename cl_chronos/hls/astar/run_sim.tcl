@@ -50,7 +50,9 @@ open_project	-reset astar_prj
 
 # The source file and test bench
 add_files			astar.cpp
-add_files -tb	astar_test.cpp
+# the testbench reads the .bin graphs with tools/graph_gen/latlon_bin.h,
+# which needs C++11 and threads
+add_files -tb	astar_test.cpp -cflags "-std=c++11 -pthread"
 add_files -tb	monaco.bin
 # Specify the top-level function for synthesis
 set_top		astar_dist
@@ -69,7 +71,7 @@ create_clock -period 8
 #set_clock_uncertainty 1.25
 
 # Simulate the C code 
-#csim_design
+#csim_design -ldflags "-pthread"
 csynth_design
 
 # Do not perform any other steps
@@ -0,0 +1,230 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// color on images written with graph_gen --varint-edges (header word 10 is
+// 2). Edge offsets, in the header array and in data word 3, are byte offsets
+// into the neighbor section, where each list is a varint degree followed by
+// a varint neighbor gap per edge; see tools/graph_gen/varint.cpp. 'make sim'
+// builds it against simulator.h, which runs the image on the host and
+// checks the colors against its ground truth.
+//
+// A vertex's degree is the first varint of its list. Notify tasks walk the
+// list 6 edges at a time and pass the byte position in the list and the last
+// neighbor on to their continuation, since the gaps can only be decoded in
+// order.
+
+#ifndef RISCV
+#include "../include/simulator.h"
+#else
+#include "../include/chronos.h"
+#endif
+#include "../include/graph_image.h"
+
+#define EDGE_FORMAT_VARINT 2
+
+#define ENQUEUER_TASK  0
+#define CALC_COLOR_TASK  1
+#define NOTIFY_NEIGHBORS_TASK 2
+#define RECEIVE_COLOR_TASK 3
+
+uint32_t* chronos_mem = 0;
+
+uint* colors;
+uint* edge_offset;
+uint8_t* edge_neighbors;
+
+uint* scratch;
+uint numV;
+
+// LEB128: 7 bits per byte, low bits first, bit 7 set on all but the last
+static inline uint read_varint(uint8_t** p) {
+   uint x = 0;
+   uint shift = 0;
+   uint8_t b;
+   do {
+      b = *(*p)++;
+      x |= (uint) (b & 0x7f) << shift;
+      shift += 7;
+   } while (b & 0x80);
+   return x;
+}
+
+// The first gap of a list is relative to the vertex itself, zigzag encoded
+static inline uint unzigzag(uint x) {
+   return (x >> 1) ^ -(x & 1);
+}
+
+static inline uint degree_of(uint vid) {
+   uint8_t* p = edge_neighbors + edge_offset_of(edge_offset, vid);
+   return read_varint(&p);
+}
+
+void enqueuer_task(uint ts, uint object, uint enq_start) {
+   int n_child = 0;
+   uint next_ts;
+   while(enq_start + n_child < numV) {
+     if (n_child == 7) {
+         enq_task_arg2(ENQUEUER_TASK, 0, object, enq_start + 7, 0);
+         break;
+     }
+     uint nextV = enq_start + n_child;
+     uint degree = degree_of(nextV);
+     if (degree>255) degree = 255;
+     next_ts = (255-degree) << 24 | nextV << 1;
+     enq_task_arg0(CALC_COLOR_TASK, next_ts, nextV);
+     n_child++;
+   }
+}
+
+void calc_color_task(uint ts, uint vid) {
+   // find first unset bit;
+   vid = vid & 0xffffff;
+   uint bit = 0;
+   uint vec = scratch[vid*2];
+   while (vec & 1) {
+      vec >>= 1;
+      bit++;
+   }
+   // color = bit
+   enq_task_arg3(NOTIFY_NEIGHBORS_TASK, ts, (1<<24) | vid, bit, 0, 0);
+
+}
+
+// pos is the byte position of the next edge in the list (0 for the first
+// task), prev the neighbor decoded just before it
+void notify_neighbors_task(uint ts, uint vid, uint color, uint pos, uint prev) {
+   vid = vid & 0xffffff;
+   uint8_t* list = edge_neighbors + edge_offset_of(edge_offset, vid);
+   uint8_t* end = edge_neighbors + edge_offset_of(edge_offset, vid+1);
+   uint8_t* p = list;
+   uint degree = read_varint(&p);
+   bool first = (pos == 0);
+   if (first) {
+      undo_log_write(&(colors[vid*4]), colors[vid*4]);
+      colors[vid*4] = color;
+      prev = vid;
+   } else {
+      p = list + pos;
+   }
+
+   uint neighbor = prev;
+   for (int i = 0; i < 6 && p < end; i++) {
+      uint gap = read_varint(&p);
+      neighbor += first ? unzigzag(gap) : gap;
+      first = false;
+      uint n_deg = degree_of(neighbor);
+      if ( (n_deg < degree) || ((n_deg == degree) & neighbor > vid)) {
+          enq_task_arg2(RECEIVE_COLOR_TASK, ts, neighbor, color, vid);
+      }
+   }
+   if (p < end) {
+      enq_task_arg3(NOTIFY_NEIGHBORS_TASK, ts, (1<<24) | vid, color,
+            p - list, neighbor);
+   }
+}
+
+void receive_color_task(uint ts, uint vid, uint color, uint neighbor) {
+   if (color < 32) {
+      uint vec = scratch[vid*2];
+      undo_log_write(&(scratch[vid*2]), vec);
+      vec = vec | ( 1<<color);
+      scratch[vid*2] = vec;
+   } // else todo
+}
+
+
+int main(int argc, char** argv) {
+   chronos_init();
+
+#ifndef RISCV
+   // Simulator code
+
+   if (argc < 2) {
+       printf("usage: color_varint_sim in_file\n");
+       exit(0);
+   }
+
+   FILE* fp = fopen(argv[1], "rb");
+   if (fp == NULL) {
+       printf("ERROR: could not open %s\n", argv[1]);
+       exit(1);
+   }
+   fseek (fp , 0 , SEEK_END);
+   long lSize = ftell (fp);
+   rewind (fp);
+   chronos_mem = (uint32_t*) malloc(lSize);
+   if (fread( (void*) chronos_mem, 1, lSize, fp) != (size_t) lSize ||
+         chronos_mem[0] != 0xdead || chronos_mem[10] != EDGE_FORMAT_VARINT) {
+       printf("ERROR: %s is not a graph_gen --varint-edges color image\n", argv[1]);
+       exit(1);
+   }
+   fclose(fp);
+   // as the runtime does
+   enq_task_arg1(ENQUEUER_TASK, 0, 0x20000, 0);
+#endif
+
+   // graph_gen writes word numbers; the image is loaded at chronos_mem
+   graph_image_init(chronos_mem);
+   colors = image_section(chronos_mem, 5);
+   edge_offset = image_section(chronos_mem, 3);
+   edge_neighbors = (uint8_t*) image_section(chronos_mem, 4);
+   scratch = image_section(chronos_mem, 7);
+   numV = chronos_mem[1];
+
+   while (1) {
+      uint ttype, ts, object, arg0, arg1, arg2;
+      deq_task_arg3(&ttype, &ts, &object, &arg0, &arg1, &arg2);
+#ifndef RISCV
+      if (ttype == (uint) -1) break;
+#endif
+      switch(ttype) {
+        case ENQUEUER_TASK:
+           enqueuer_task(ts, object, arg0);
+           break;
+        case CALC_COLOR_TASK:
+           calc_color_task(ts, object);
+           break;
+        case NOTIFY_NEIGHBORS_TASK:
+           notify_neighbors_task(ts, object, arg0, arg1, arg2);
+           break;
+        case RECEIVE_COLOR_TASK:
+           receive_color_task(ts, object, arg0, arg1);
+           break;
+      }
+      finish_task();
+   }
+
+#ifndef RISCV
+   uint32_t* ref = image_section(chronos_mem, 6);
+   uint errors = 0;
+   for (uint i = 0; i < numV; i++) {
+      if (colors[i*4] != ref[i]) {
+         if (errors < 10) printf("vid:%6d color:%4u ref:%4u\n", i, colors[i*4], ref[i]);
+         errors++;
+      }
+   }
+   printf("Total Errors %u / %u\n", errors, numV);
+   return errors != 0;
+#endif
+   return 0;
+}
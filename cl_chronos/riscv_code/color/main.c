@@ -22,14 +22,14 @@
  */
 
 #include "../include/chronos.h"
+#include "../include/graph_image.h"
 
-const int ADDR_BASE_DATA         = 5 << 2;
-const int ADDR_BASE_EDGE_OFFSET  = 3 << 2;
-const int ADDR_BASE_NEIGHBORS    = 4 << 2;
 const int ADDR_BASE_INITLIST     = 9 << 2;
-const int ADDR_BASE_SCRATCH      = 7 << 2;
 const int ADDR_NUMV              = 1 << 2;
 
+// The image is loaded at address 0
+uint32_t* chronos_mem = 0;
+
 #define ENQUEUER_TASK  0
 #define CALC_COLOR_TASK  1
 #define NOTIFY_NEIGHBORS_TASK 2
@@ -54,7 +54,7 @@ void enqueuer_task(uint ts, uint object, uint enq_start, uint arg1) {
          break;
      }
      uint nextV = enq_start + n_child;
-     uint degree = edge_offset[nextV+1] - edge_offset[nextV];
+     uint degree = edge_offset_of(edge_offset, nextV+1) - edge_offset_of(edge_offset, nextV);
      if (degree>255) degree = 255;
      next_ts = (255-degree) << 24 | nextV << 1;
      enq_task_arg0(CALC_COLOR_TASK, next_ts, nextV);
@@ -82,17 +82,17 @@ void notify_neighbors_task(uint ts, uint vid, uint color, uint enq_start) {
       undo_log_write(&(colors[vid*4]), colors[vid*4]);
       colors[vid*4] = color;
    }
-   uint eo_begin = edge_offset[vid] + enq_start;
-   uint eo_end = edge_offset[vid+1];
+   edge_t eo_begin = edge_offset_of(edge_offset, vid) + enq_start;
+   edge_t eo_end = edge_offset_of(edge_offset, vid+1);
    uint degree = eo_end - eo_begin;
    if (eo_end > eo_begin + 6) {
        enq_task_arg1(NOTIFY_NEIGHBORS_TASK, ts, (1<<24) | vid, enq_start +6);
        eo_end = eo_begin + 6;
    }
 
-   for (int i = eo_begin; i < eo_end; i++) {
+   for (edge_t i = eo_begin; i < eo_end; i++) {
       uint neighbor = edge_neighbors[i];
-      uint n_deg = edge_offset[neighbor+1] - edge_offset[neighbor];
+      uint n_deg = edge_offset_of(edge_offset, neighbor+1) - edge_offset_of(edge_offset, neighbor);
       if ( (n_deg < degree) || ((n_deg == degree) & neighbor > vid)) {
           enq_task_arg2(RECEIVE_COLOR_TASK, ts, neighbor, color, vid);
       }
@@ -113,10 +113,11 @@ void receive_color_task(uint ts, uint vid, uint color, uint neighbor) {
 void main() {
    chronos_init();
 
-   colors = (uint*) ((*(int *) (ADDR_BASE_DATA))<<2) ;
-   edge_offset  =(uint*) ((*(int *)(ADDR_BASE_EDGE_OFFSET))<<2) ;
-   edge_neighbors  =(uint*) ((*(int *)(ADDR_BASE_NEIGHBORS))<<2) ;
-   scratch  =(uint*) ((*(int *)(ADDR_BASE_SCRATCH))<<2);
+   graph_image_init(chronos_mem);
+   colors = image_section(chronos_mem, 5);
+   edge_offset = image_section(chronos_mem, 3);
+   edge_neighbors = image_section(chronos_mem, 4);
+   scratch = image_section(chronos_mem, 7);
    initlist  =(uint*) ((*(int *)(ADDR_BASE_INITLIST))<<2) ;
    numV  =*(uint *)(ADDR_NUMV) ;
 
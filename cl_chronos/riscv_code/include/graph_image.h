@@ -0,0 +1,76 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Section and edge offsets of graph_gen sssp and color images, including
+// large ones (tools/graph_gen/graph_gen.h). Those have a 32-word header with
+// (low, high) copies of header words 2-8 in words 18-31, and two words per
+// edge offset.
+//
+// The rv32 cores only reach the image below the code at 0x80000000, where
+// the 32-bit header words (the low halves) are exact, so on RISCV only the
+// edge offset stride changes. The simulator uses the full 64-bit values.
+
+#ifndef GRAPH_IMAGE_H
+#define GRAPH_IMAGE_H
+
+#define LARGE_IMAGE_MAGIC 0x6c617267 // header word 16
+#define LARGE_HEADER_WORDS 32         // header word 17
+
+// an edge (or edge byte) index
+#ifdef RISCV
+typedef uint edge_t;
+#else
+typedef unsigned long long edge_t;
+#endif
+
+// 1 in large images
+static uint edge_offset_shift = 0;
+
+static inline void graph_image_init(uint32_t* mem) {
+   // as the runtime and its emulator tell large images apart
+   edge_offset_shift = (mem[16] == LARGE_IMAGE_MAGIC) && (mem[17] == LARGE_HEADER_WORDS);
+}
+
+// Header word i (2-8), in words from the start of the image
+static inline edge_t image_header(uint32_t* mem, uint i) {
+#ifndef RISCV
+   if (edge_offset_shift) return mem[14 + 2*i] | (edge_t) mem[15 + 2*i] << 32;
+#endif
+   return mem[i];
+}
+
+static inline uint32_t* image_section(uint32_t* mem, uint i) {
+   return mem + image_header(mem, i);
+}
+
+// Entry v of the edge offset array
+static inline edge_t edge_offset_of(uint32_t* edge_offset, uint v) {
+#ifndef RISCV
+   if (edge_offset_shift) {
+      return edge_offset[2 * (edge_t) v] | (edge_t) edge_offset[2 * (edge_t) v + 1] << 32;
+   }
+#endif
+   return edge_offset[v << edge_offset_shift];
+}
+
+#endif
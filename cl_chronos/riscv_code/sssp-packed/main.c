@@ -0,0 +1,84 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// sssp on images written with graph_gen --packed-edges: each edge is one
+// word, weight[31:24] neighbor[23:0], instead of the (neighbor, weight) pair
+// read by riscv_code/sssp. This halves the edge bytes fetched per
+// relaxation; header word 9 (edge format) is 1 for these images.
+
+#include "../include/chronos.h"
+#include "../include/graph_image.h"
+
+// The image is loaded at address 0
+uint32_t* chronos_mem = 0;
+
+uint32_t* dist;
+uint32_t* edge_offset;
+uint32_t* edge_neighbors;
+
+#define VISIT_NODE_TASK  0
+
+void visit_node_task(uint ts, uint vid) {
+
+      unsigned int cur_dist = (unsigned int) dist[vid];
+      if (cur_dist <= ts) {
+         return;
+      }
+
+      undo_log_write(&(dist[vid]), cur_dist);
+      dist[vid] = ts;
+      edge_t end = edge_offset_of(edge_offset, vid+1);
+      for (edge_t i = edge_offset_of(edge_offset, vid); i < end; i++) {
+         uint32_t edge = edge_neighbors[i];
+         int neighbor = edge & 0xffffff;
+         int weight = edge >> 24;
+
+         enq_task_arg0(VISIT_NODE_TASK, ts + weight, neighbor);
+      }
+}
+
+
+int main() {
+   chronos_init();
+
+   // Dereference the pointers to array base addresses.
+   // (graph_gen writes the word number, not the byte)
+   graph_image_init(chronos_mem);
+   dist = image_section(chronos_mem, 5);
+   edge_offset = image_section(chronos_mem, 3);
+   edge_neighbors = image_section(chronos_mem, 4);
+
+   while (1) {
+      uint ttype, ts, object;
+      deq_task_arg0(&ttype, &ts, &object);
+      switch(ttype){
+          case VISIT_NODE_TASK:
+              visit_node_task(ts, object);
+              break;
+          default:
+              break;
+      }
+
+      finish_task();
+   }
+}
@@ -0,0 +1,155 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// sssp on images written with graph_gen --varint-edges (header word 9 is 2).
+// Edge offsets are byte offsets into the neighbor section, where each list
+// is a varint degree followed by a (neighbor gap, weight) varint pair per
+// edge; see tools/graph_gen/varint.cpp. 'make sim' builds it against
+// simulator.h, which runs the image on the host and checks the distances
+// against its ground truth.
+
+#ifndef RISCV
+#include "../include/simulator.h"
+#else
+#include "../include/chronos.h"
+#endif
+#include "../include/graph_image.h"
+
+#define EDGE_FORMAT_VARINT 2
+
+uint32_t* chronos_mem = 0;
+
+uint32_t* dist;
+uint32_t* edge_offset;
+uint8_t* edge_neighbors;
+
+#define VISIT_NODE_TASK  0
+
+// LEB128: 7 bits per byte, low bits first, bit 7 set on all but the last
+static inline uint read_varint(uint8_t** p) {
+   uint x = 0;
+   uint shift = 0;
+   uint8_t b;
+   do {
+      b = *(*p)++;
+      x |= (uint) (b & 0x7f) << shift;
+      shift += 7;
+   } while (b & 0x80);
+   return x;
+}
+
+// The first gap of a list is relative to the vertex itself, zigzag encoded
+static inline uint unzigzag(uint x) {
+   return (x >> 1) ^ -(x & 1);
+}
+
+void visit_node_task(uint ts, uint vid) {
+
+      uint cur_dist = dist[vid];
+      if (cur_dist <= ts) {
+         return;
+      }
+
+      undo_log_write(&(dist[vid]), cur_dist);
+      dist[vid] = ts;
+
+      uint8_t* p = edge_neighbors + edge_offset_of(edge_offset, vid);
+      uint degree = read_varint(&p);
+      uint neighbor = vid;
+      for (uint i = 0; i < degree; i++) {
+         uint gap = read_varint(&p);
+         neighbor += (i == 0) ? unzigzag(gap) : gap;
+         uint weight = read_varint(&p);
+
+         enq_task_arg0(VISIT_NODE_TASK, ts + weight, neighbor);
+      }
+}
+
+
+int main(int argc, char** argv) {
+   chronos_init();
+
+#ifndef RISCV
+   // Simulator code
+
+   if (argc < 2) {
+       printf("usage: sssp_varint_sim in_file\n");
+       exit(0);
+   }
+
+   FILE* fp = fopen(argv[1], "rb");
+   if (fp == NULL) {
+       printf("ERROR: could not open %s\n", argv[1]);
+       exit(1);
+   }
+   fseek (fp , 0 , SEEK_END);
+   long lSize = ftell (fp);
+   rewind (fp);
+   chronos_mem = (uint32_t*) malloc(lSize);
+   if (fread( (void*) chronos_mem, 1, lSize, fp) != (size_t) lSize ||
+         chronos_mem[0] != 0xdead || chronos_mem[9] != EDGE_FORMAT_VARINT) {
+       printf("ERROR: %s is not a graph_gen --varint-edges sssp image\n", argv[1]);
+       exit(1);
+   }
+   fclose(fp);
+   enq_task_arg0(VISIT_NODE_TASK, 0, chronos_mem[7]);
+#endif
+
+   // graph_gen writes word numbers; the image is loaded at chronos_mem
+   graph_image_init(chronos_mem);
+   dist = image_section(chronos_mem, 5);
+   edge_offset = image_section(chronos_mem, 3);
+   edge_neighbors = (uint8_t*) image_section(chronos_mem, 4);
+
+   while (1) {
+      uint ttype, ts, object;
+      deq_task_arg0(&ttype, &ts, &object);
+#ifndef RISCV
+      if (ttype == (uint) -1) break;
+#endif
+      switch(ttype){
+          case VISIT_NODE_TASK:
+              visit_node_task(ts, object);
+              break;
+          default:
+              break;
+      }
+
+      finish_task();
+   }
+
+#ifndef RISCV
+   uint numV = chronos_mem[1];
+   uint32_t* ref = image_section(chronos_mem, 6);
+   uint errors = 0;
+   for (uint i = 0; i < numV; i++) {
+      if (dist[i] != ref[i]) {
+         if (errors < 10) printf("vid:%6d dist:%9u ref:%9u\n", i, dist[i], ref[i]);
+         errors++;
+      }
+   }
+   printf("Total Errors %u / %u\n", errors, numV);
+   return errors != 0;
+#endif
+   return 0;
+}
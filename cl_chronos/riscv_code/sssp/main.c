@@ -23,11 +23,10 @@
 
 
 #include "../include/chronos.h"
+#include "../include/graph_image.h"
 
-// The location pointing to the base of each of the arrays
-const int ADDR_BASE_DIST = 5 << 2;
-const int ADDR_BASE_EDGE_OFFSET = 3 << 2;
-const int ADDR_BASE_NEIGHBORS = 4 << 2;
+// The image is loaded at address 0
+uint32_t* chronos_mem = 0;
 
 uint32_t* dist;
 uint32_t* edge_offset;
@@ -44,7 +43,8 @@ void visit_node_task(uint ts, uint vid) {
 
       undo_log_write(&(dist[vid]), cur_dist);
       dist[vid] = ts;
-      for (int i = edge_offset[vid]; i < edge_offset[vid+1]; i++) {
+      edge_t end = edge_offset_of(edge_offset, vid+1);
+      for (edge_t i = edge_offset_of(edge_offset, vid); i < end; i++) {
          int neighbor = edge_neighbors[i*2];
          int weight = edge_neighbors[i*2+1];
 
@@ -57,10 +57,11 @@ int main() {
    chronos_init();
 
    // Dereference the pointers to array base addresses.
-   // ( The '<<2' is because graph_gen writes the word number, not the byte)
-   dist = (uint32_t*) ((*(uint32_t *) (ADDR_BASE_DIST))<<2) ;
-   edge_offset  =(uint32_t*) ((*(int *)(ADDR_BASE_EDGE_OFFSET))<<2) ;
-   edge_neighbors  =(uint32_t*) ((*(int *)(ADDR_BASE_NEIGHBORS))<<2) ;
+   // (graph_gen writes the word number, not the byte)
+   graph_image_init(chronos_mem);
+   dist = image_section(chronos_mem, 5);
+   edge_offset = image_section(chronos_mem, 3);
+   edge_neighbors = image_section(chronos_mem, 4);
 
    while (1) {
       uint ttype, ts, object;
@@ -0,0 +1,516 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// An in-process stand-in for the F1 card (--device=emu), to run and profile
+// the host side of the runtime (staging, configuration, polling, readback,
+// verification) on any Linux machine.
+//
+// The OCL register map of header.h is a flat register file: pokes are stored
+// and read back, except for
+//   OCL_PARAM_*                the defaults of design/config.sv, with
+//                              --n_tiles tiles
+//   OCL_CUR_CYCLE_MSB/LSB      a 125 MHz counter that advances on every read
+//   OCL_TASK_ENQ_*             stage a task; OCL_TASK_ENQ queues it with
+//                              the poked ts
+//   CORE_START (ID_ALL_CORES)  starts (and with 0, stops) the task engine
+//   CQ_GVT_TS, OCL_DONE        the ts of the running task, ~0 once the
+//                              engine is done
+//   TASK_UNIT_STAT_N_DEQ_TASK  tasks run so far
+//   L2_FLUSH                   reads 0 (done); DDR is always up to date
+// The DDR is a lazily allocated anonymous mapping of FPGA_DDR_SIZE bytes.
+// Reads past it (the debug logs) return zeros.
+//
+// The task engine is one thread that runs the pending tasks to completion in
+// ts order, with the semantics of the app's cores on the same image:
+//   sssp   visit tasks, on pair, packed and varint edges
+//   color  the riscv app, as riscv_code/color-varint does it (full degree,
+//          continuations carry the color), on pair and varint edges
+//   astar  visit_vertex and queue_vertex (design/apps/astar); visiting the
+//          target ends the run like the terminate tasks
+// There is no speculation, tiling or timing, only what ends up in DDR. The
+// other apps have no task model: their tasks are dropped, so they fail
+// verification.
+
+#include "header.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+
+// the APP_* whose tasks the engine runs, from open
+static int emu_app = -1;
+
+// design/config.sv, design/spill_config.vh
+#define EMU_N_CORES              16
+#define EMU_LOG_TQ_SIZE          12
+#define EMU_TQ_STAGES            13
+#define EMU_LOG_CQ_SIZE          7
+#define EMU_LOG_SPILL_Q_SIZE     8
+#define EMU_LOG_READY_LIST_SIZE  4
+#define EMU_LOG_L2_BANKS         1
+#define EMU_CYCLE_NS             8
+
+// OCL addresses are tile[23:16] comp[15:8] addr[7:0]
+#define EMU_REG_WORDS            (1 << 22)
+
+typedef struct {
+    uint32_t ts;
+    // orders tasks of equal ts, lowest first
+    uint32_t tiebreak;
+    uint32_t ttype;
+    uint32_t object;
+    uint32_t args[3];
+} emu_task_t;
+
+static uint8_t* emu_ddr;
+static uint32_t* emu_regs;
+static struct timespec emu_t0;
+static uint64_t emu_last_cycle;
+
+// the task being enqueued over OCL
+static emu_task_t emu_enq;
+static uint32_t emu_enq_arg_word;
+
+// pending tasks, a binary min-heap on (ts, tiebreak)
+static emu_task_t* emu_heap;
+static uint64_t emu_heap_size;
+static uint64_t emu_heap_capacity;
+
+static pthread_t emu_engine;
+static bool emu_started;
+static bool emu_joined;
+// shared with the engine thread
+static uint32_t emu_gvt;
+static uint32_t emu_n_deq;
+static bool emu_stop;
+
+static bool emu_before(const emu_task_t* a, const emu_task_t* b) {
+    return a->ts < b->ts || (a->ts == b->ts && a->tiebreak < b->tiebreak);
+}
+
+static void emu_push(uint32_t ttype, uint32_t ts, uint32_t object,
+        uint32_t arg0, uint32_t arg1, uint32_t arg2) {
+    if (emu_heap_size == emu_heap_capacity) {
+        emu_heap_capacity = emu_heap_capacity ? emu_heap_capacity * 2 : 1024;
+        emu_heap = (emu_task_t*) realloc(emu_heap, emu_heap_capacity * sizeof(emu_task_t));
+        if (emu_heap == NULL) {
+            printf("ERROR: emulator out of memory for %lu tasks\n", emu_heap_capacity);
+            exit(1);
+        }
+    }
+    // astar: queue tasks first, then visits by increasing g, as the
+    // reference breaks ties (tools/graph_gen/astar_ref.cpp)
+    uint32_t tiebreak = 0;
+    if (emu_app == APP_ASTAR && ttype == 0) tiebreak = arg0 == ~0u ? arg0 : arg0 + 1;
+    emu_task_t t = {ts, tiebreak, ttype, object, {arg0, arg1, arg2}};
+    uint64_t i = emu_heap_size++;
+    while (i > 0 && emu_before(&t, &emu_heap[(i - 1) / 2])) {
+        emu_heap[i] = emu_heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    emu_heap[i] = t;
+}
+
+static emu_task_t emu_pop() {
+    emu_task_t top = emu_heap[0];
+    emu_task_t last = emu_heap[--emu_heap_size];
+    uint64_t i = 0;
+    while (true) {
+        uint64_t c = 2 * i + 1;
+        if (c >= emu_heap_size) break;
+        if (c + 1 < emu_heap_size && emu_before(&emu_heap[c + 1], &emu_heap[c])) c++;
+        if (!emu_before(&emu_heap[c], &last)) break;
+        emu_heap[i] = emu_heap[c];
+        i = c;
+    }
+    if (emu_heap_size > 0) emu_heap[i] = last;
+    return top;
+}
+
+// The image, as the cores see it in DDR (large images have 64-bit section
+// and edge offsets; see header.h)
+static uint32_t* emu_mem;
+static bool emu_large;
+
+static uint64_t emu_header(uint32_t i) {
+    if (emu_large && i >= 2 && i <= 8) {
+        return emu_mem[14 + 2*i] | (uint64_t) emu_mem[15 + 2*i] << 32;
+    }
+    return emu_mem[i];
+}
+
+static uint32_t* emu_section(uint32_t i) {
+    return emu_mem + emu_header(i);
+}
+
+static uint64_t emu_edge_offset(const uint32_t* edge_offset, uint32_t v) {
+    if (emu_large) {
+        return edge_offset[2 * (uint64_t) v] | (uint64_t) edge_offset[2 * (uint64_t) v + 1] << 32;
+    }
+    return edge_offset[v];
+}
+
+// tools/graph_gen/varint.cpp
+static uint32_t emu_read_varint(const uint8_t** p) {
+    uint32_t x = 0;
+    uint32_t shift = 0;
+    uint8_t b;
+    do {
+        b = *(*p)++;
+        x |= (uint32_t) (b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return x;
+}
+
+static uint32_t emu_unzigzag(uint32_t x) {
+    return (x >> 1) ^ -(x & 1);
+}
+
+static void emu_sssp_task(const emu_task_t* t) {
+    uint32_t* dist = emu_section(5);
+    const uint32_t* edge_offset = emu_section(3);
+    const uint32_t* neighbors = emu_section(4);
+    uint32_t vid = t->object;
+    if (dist[vid] <= t->ts) return;
+    dist[vid] = t->ts;
+    uint64_t begin = emu_edge_offset(edge_offset, vid);
+    uint64_t end = emu_edge_offset(edge_offset, vid + 1);
+    if (emu_mem[9] == EDGE_FORMAT_VARINT) {
+        const uint8_t* p = (const uint8_t*) neighbors + begin;
+        uint32_t degree = emu_read_varint(&p);
+        uint32_t neighbor = vid;
+        for (uint32_t i = 0; i < degree; i++) {
+            uint32_t gap = emu_read_varint(&p);
+            neighbor += (i == 0) ? emu_unzigzag(gap) : gap;
+            uint32_t weight = emu_read_varint(&p);
+            emu_push(0, t->ts + weight, neighbor, 0, 0, 0);
+        }
+    } else if (emu_mem[9] == EDGE_FORMAT_PACKED) {
+        for (uint64_t i = begin; i < end; i++) {
+            emu_push(0, t->ts + (neighbors[i] >> 24), neighbors[i] & 0xffffff, 0, 0, 0);
+        }
+    } else {
+        for (uint64_t i = begin; i < end; i++) {
+            emu_push(0, t->ts + neighbors[2*i + 1], neighbors[2*i], 0, 0, 0);
+        }
+    }
+}
+
+// color task types (riscv_code/color)
+#define COLOR_ENQUEUER        0
+#define COLOR_CALC            1
+#define COLOR_NOTIFY          2
+#define COLOR_RECEIVE         3
+
+static uint32_t emu_color_degree(const uint32_t* edge_offset, const uint8_t* lists, uint32_t v) {
+    if (emu_mem[10] == EDGE_FORMAT_VARINT) {
+        const uint8_t* p = lists + emu_edge_offset(edge_offset, v);
+        return emu_read_varint(&p);
+    }
+    return emu_edge_offset(edge_offset, v + 1) - emu_edge_offset(edge_offset, v);
+}
+
+static void emu_color_task(const emu_task_t* t) {
+    uint32_t numV = emu_mem[1];
+    uint32_t* colors = emu_section(5);
+    uint32_t* scratch = emu_section(7);
+    const uint32_t* edge_offset = emu_section(3);
+    const uint32_t* neighbors = emu_section(4);
+    const uint8_t* lists = (const uint8_t*) neighbors;
+    bool varint = (emu_mem[10] == EDGE_FORMAT_VARINT);
+    uint32_t vid = t->object & 0xffffff;
+
+    switch (t->ttype) {
+        case COLOR_ENQUEUER: {
+            uint32_t enq_start = t->args[0];
+            for (uint32_t n_child = 0; enq_start + n_child < numV; n_child++) {
+                if (n_child == 7) {
+                    emu_push(COLOR_ENQUEUER, 0, t->object, enq_start + 7, 0, 0);
+                    break;
+                }
+                uint32_t v = enq_start + n_child;
+                uint32_t degree = emu_color_degree(edge_offset, lists, v);
+                if (degree > 255) degree = 255;
+                emu_push(COLOR_CALC, (255 - degree) << 24 | v << 1, v, 0, 0, 0);
+            }
+            break;
+        }
+        case COLOR_CALC: {
+            uint32_t vec = scratch[vid*2];
+            uint32_t bit = 0;
+            while (vec & 1) {
+                vec >>= 1;
+                bit++;
+            }
+            emu_push(COLOR_NOTIFY, t->ts, (1<<24) | vid, bit, 0, 0);
+            break;
+        }
+        case COLOR_NOTIFY: {
+            // args: color, position of the next edge (edge index, or byte
+            // in a varint list), previous varint neighbor
+            uint32_t color = t->args[0];
+            uint32_t pos = t->args[1];
+            uint32_t degree = emu_color_degree(edge_offset, lists, vid);
+            if (pos == 0) colors[vid*4] = color;
+            uint64_t begin = emu_edge_offset(edge_offset, vid);
+            uint64_t end = emu_edge_offset(edge_offset, vid + 1);
+            const uint8_t* p = NULL;
+            uint32_t neighbor = t->args[2];
+            if (varint) {
+                p = lists + begin;
+                emu_read_varint(&p);
+                if (pos == 0) neighbor = vid;
+                else p = lists + begin + pos;
+            }
+            uint32_t i;
+            for (i = 0; i < 6; i++) {
+                if (varint) {
+                    if (p >= lists + end) break;
+                    uint32_t gap = emu_read_varint(&p);
+                    neighbor += (pos == 0 && i == 0) ? emu_unzigzag(gap) : gap;
+                } else {
+                    if (begin + pos + i >= end) break;
+                    neighbor = neighbors[begin + pos + i];
+                }
+                uint32_t n_deg = emu_color_degree(edge_offset, lists, neighbor);
+                if (n_deg < degree || (n_deg == degree && neighbor > vid)) {
+                    emu_push(COLOR_RECEIVE, t->ts, neighbor, color, vid, 0);
+                }
+            }
+            if (varint ? p < lists + end : begin + pos + i < end) {
+                uint32_t next = varint ? p - (lists + begin) : pos + i;
+                emu_push(COLOR_NOTIFY, t->ts, (1<<24) | vid, color, next, neighbor);
+            }
+            break;
+        }
+        case COLOR_RECEIVE:
+            if (t->args[0] < 32) scratch[vid*2] |= 1u << t->args[0];
+            break;
+    }
+}
+
+// astar_dist of hls/astar, in double precision on the ap_fixed<32,3>
+// coordinates, as tools/graph_gen/astar_ref.cpp computes it
+static uint32_t emu_astar_dist(const uint32_t* src, const uint32_t* dst) {
+    const double fp_factor = (double) (1 << 29);
+    double xdiff = (int32_t) (src[0] - dst[0]) / fp_factor;
+    double ydiff = (int32_t) (src[1] - dst[1]) / fp_factor;
+    double latS = sin(xdiff);
+    double lonS = sin(ydiff);
+    double a = latS * latS + lonS * lonS
+        * cos((int32_t) src[0] / fp_factor) * cos((int32_t) dst[0] / fp_factor);
+    return (uint32_t) (2 * sqrt(a) * 6371000.0);
+}
+
+static void emu_astar_task(const emu_task_t* t) {
+    uint32_t* data = emu_section(5);
+    const uint32_t* edge_offset = emu_section(3);
+    const uint32_t* neighbors = emu_section(4);
+    const uint32_t* latlon = emu_section(6);
+    uint32_t target = emu_header(8);
+    uint32_t vid = t->object;
+    // args: g (path length), parent
+    uint32_t g = t->args[0];
+
+    if (t->ttype == 1) {
+        // queue_vertex
+        uint32_t f = g + emu_astar_dist(latlon + 2 * (uint64_t) vid,
+                latlon + 2 * (uint64_t) target);
+        emu_push(0, t->ts > f ? t->ts : f, vid, g, t->args[1], 0);
+        return;
+    }
+    // visit_vertex
+    if (data[vid] != ~0u) return;
+    data[vid] = t->ts;
+    if (vid == target) {
+        emu_heap_size = 0;
+        return;
+    }
+    uint64_t end = emu_edge_offset(edge_offset, vid + 1);
+    for (uint64_t e = emu_edge_offset(edge_offset, vid); e < end; e++) {
+        emu_push(1, t->ts, neighbors[2*e], g + neighbors[2*e + 1], vid, 0);
+    }
+}
+
+static void* emu_run(void* arg) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    emu_mem = (uint32_t*) emu_ddr;
+    emu_large = (emu_mem[16] == LARGE_IMAGE_MAGIC) && (emu_mem[17] == LARGE_HEADER_WORDS);
+    void (*run_task)(const emu_task_t*) = NULL;
+    switch (emu_app) {
+        case APP_SSSP: run_task = emu_sssp_task; break;
+        case APP_COLOR: run_task = emu_color_task; break;
+        case APP_ASTAR: run_task = emu_astar_task; break;
+        default:
+            printf("WARNING: the emulator has no task model for app %d, dropping its tasks\n",
+                    emu_app);
+            break;
+    }
+    while (emu_heap_size > 0 && !__atomic_load_n(&emu_stop, __ATOMIC_RELAXED)) {
+        emu_task_t t = emu_pop();
+        __atomic_store_n(&emu_gvt, t.ts, __ATOMIC_RELAXED);
+        if (run_task) run_task(&t);
+        __atomic_add_fetch(&emu_n_deq, 1, __ATOMIC_RELAXED);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Emulator: %u tasks in %.3f s%s\n", emu_n_deq,
+            (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+            emu_heap_size ? ", stopped" : "");
+    // stopped early, gvt stays where it was
+    if (emu_heap_size == 0) __atomic_store_n(&emu_gvt, ~0u, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static uint64_t emu_cycles() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    uint64_t ns = (t.tv_sec - emu_t0.tv_sec) * 1000000000ull + t.tv_nsec - emu_t0.tv_nsec;
+    uint64_t cycles = ns / EMU_CYCLE_NS;
+    // two back-to-back reads never return the same value on the card
+    if (cycles <= emu_last_cycle) cycles = emu_last_cycle + 1;
+    emu_last_cycle = cycles;
+    return cycles;
+}
+
+static int emu_init(int slot_id) {
+    emu_ddr = (uint8_t*) mmap(NULL, FPGA_DDR_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (emu_ddr == MAP_FAILED) {
+        printf("ERROR: could not map %llu bytes of emulated DDR\n", FPGA_DDR_SIZE);
+        return 1;
+    }
+    emu_regs = (uint32_t*) calloc(EMU_REG_WORDS, sizeof(uint32_t));
+    if (emu_regs == NULL) return 1;
+    clock_gettime(CLOCK_MONOTONIC, &emu_t0);
+    return 0;
+}
+
+static int emu_open(int slot_id, int pf_id, int bar_id, int app) {
+    emu_app = app;
+    return 0;
+}
+
+static int emu_peek(uint32_t ocl_addr, uint32_t* data) {
+    uint32_t comp = (ocl_addr >> 8) & 0xff;
+    uint32_t addr = ocl_addr & 0xff;
+    if (ocl_addr >= (EMU_REG_WORDS << 2)) return 1;
+    *data = emu_regs[ocl_addr >> 2];
+    if (comp == ID_OCL_SLAVE) {
+        switch (addr) {
+            case OCL_PARAM_N_TILES: *data = active_tiles; break;
+            case OCL_PARAM_N_CORES: *data = EMU_N_CORES; break;
+            case OCL_PARAM_LOG_TQ_HEAP_STAGES: *data = EMU_TQ_STAGES; break;
+            case OCL_PARAM_LOG_TQ_SIZE: *data = EMU_LOG_TQ_SIZE; break;
+            case OCL_PARAM_LOG_CQ_SIZE: *data = EMU_LOG_CQ_SIZE; break;
+            case OCL_PARAM_LOG_SPILL_Q_SIZE: *data = EMU_LOG_SPILL_Q_SIZE; break;
+            case OCL_PARAM_LOG_READY_LIST_SIZE: *data = EMU_LOG_READY_LIST_SIZE; break;
+            case OCL_PARAM_LOG_L2_BANKS: *data = EMU_LOG_L2_BANKS; break;
+            case OCL_PARAM_NO_ROLLBACK: *data = 0; break;
+            case OCL_PARAM_APP_ID: *data = 0; break;
+            case OCL_CUR_CYCLE_MSB: *data = emu_cycles() >> 32; break;
+            case OCL_CUR_CYCLE_LSB: *data = emu_cycles(); break;
+            case OCL_DONE: *data = __atomic_load_n(&emu_gvt, __ATOMIC_ACQUIRE) == ~0u ? ~0u : 0; break;
+        }
+    } else if (comp == ID_CQ && addr == CQ_GVT_TS) {
+        *data = __atomic_load_n(&emu_gvt, __ATOMIC_ACQUIRE);
+    } else if (comp == ID_TASK_UNIT && addr == TASK_UNIT_STAT_N_DEQ_TASK) {
+        *data = __atomic_load_n(&emu_n_deq, __ATOMIC_RELAXED);
+    } else if ((comp == ID_L2_RW || comp == ID_L2_RO) && addr == L2_FLUSH) {
+        *data = 0;
+    }
+    return 0;
+}
+
+static int emu_poke(uint32_t ocl_addr, uint32_t data) {
+    uint32_t comp = (ocl_addr >> 8) & 0xff;
+    uint32_t addr = ocl_addr & 0xff;
+    if (ocl_addr >= (EMU_REG_WORDS << 2)) return 1;
+    emu_regs[ocl_addr >> 2] = data;
+    if (comp == ID_OCL_SLAVE) {
+        switch (addr) {
+            case OCL_TASK_ENQ_TTYPE: emu_enq.ttype = data; break;
+            case OCL_TASK_ENQ_OBJECT: emu_enq.object = data; break;
+            case OCL_TASK_ENQ_ARG_WORD: emu_enq_arg_word = data; break;
+            case OCL_TASK_ENQ_ARGS:
+                if (emu_enq_arg_word < 3) emu_enq.args[emu_enq_arg_word] = data;
+                break;
+            case OCL_TASK_ENQ:
+                if (emu_started) {
+                    printf("ERROR: the emulator only takes tasks before CORE_START\n");
+                    return 1;
+                }
+                emu_push(emu_enq.ttype, data, emu_enq.object,
+                        emu_enq.args[0], emu_enq.args[1], emu_enq.args[2]);
+                break;
+        }
+    } else if (comp == ID_ALL_CORES && addr == CORE_START) {
+        if (data != 0 && !emu_started) {
+            emu_started = true;
+            emu_gvt = 0;
+            if (pthread_create(&emu_engine, NULL, emu_run, NULL) != 0) {
+                printf("ERROR: could not start the emulator's task engine\n");
+                return 1;
+            }
+        } else if (data == 0 && emu_started && !emu_joined) {
+            __atomic_store_n(&emu_stop, true, __ATOMIC_RELAXED);
+            pthread_join(emu_engine, NULL);
+            emu_joined = true;
+        }
+    }
+    return 0;
+}
+
+// memcpy on any number of threads
+static uint32_t emu_dma_channels() {
+    return DMA_MAX_CHANNELS;
+}
+
+static int emu_dma_write(uint32_t channel, const void* buf, uint64_t len, uint64_t addr) {
+    if (addr > FPGA_DDR_SIZE || len > FPGA_DDR_SIZE - addr) return 1;
+    memcpy(emu_ddr + addr, buf, len);
+    return 0;
+}
+
+static int emu_dma_read(uint32_t channel, void* buf, uint64_t len, uint64_t addr) {
+    uint64_t n = 0;
+    if (addr < FPGA_DDR_SIZE) {
+        n = FPGA_DDR_SIZE - addr < len ? FPGA_DDR_SIZE - addr : len;
+        memcpy(buf, emu_ddr + addr, n);
+    }
+    memset((uint8_t*) buf + n, 0, len - n);
+    return 0;
+}
+
+const device_t device_emu = {
+    .name = "emu",
+    .init = emu_init,
+    .open = emu_open,
+    .peek = emu_peek,
+    .poke = emu_poke,
+    .dma_channels = emu_dma_channels,
+    .dma_write = emu_dma_write,
+    .dma_read = emu_dma_read,
+};
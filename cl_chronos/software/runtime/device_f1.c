@@ -0,0 +1,160 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// The F1 card, through the AWS FPGA SDK: OCL registers on the app PF's BAR0
+// and the DDR through the XDMA queues.
+
+#include "header.h"
+
+pci_bar_handle_t pci_bar_handle;
+
+// A write and a read queue per XDMA channel. Engine channel 0, which
+// takes the small transfers, writes on XDMA channel 1 and reads on 0, as
+// the runtime always has.
+static int f1_write_fd[DMA_MAX_CHANNELS];
+static int f1_read_fd[DMA_MAX_CHANNELS];
+static uint32_t f1_n_channels;
+
+int check_slot_config(int slot_id)
+{
+    int rc;
+    struct fpga_mgmt_image_info info = {0};
+
+    /* get local image description, contains status, vendor id, and device id */
+    rc = fpga_mgmt_describe_local_image(slot_id, &info, 0);
+    fail_on(rc, out, "Unable to get local image information. Are you running as root?");
+
+    /* check to see if the slot is ready */
+    if (info.status != FPGA_STATUS_LOADED) {
+        rc = 1;
+        fail_on(rc, out, "Slot %d is not ready", slot_id);
+    }
+
+    /* confirm that the AFI that we expect is in fact loaded */
+    if (info.spec.map[FPGA_APP_PF].vendor_id != pci_vendor_id ||
+            info.spec.map[FPGA_APP_PF].device_id != pci_device_id) {
+        rc = 1;
+        printf("The slot appears loaded, but the pci vendor or device ID doesn't "
+                "match the expected values. You may need to rescan the fpga with \n"
+                "fpga-describe-local-image -S %i -R\n"
+                "Note that rescanning can change which device file in /dev/ a FPGA will map to.\n"
+                "To remove and re-add your edma driver and reset the device file mappings, run\n"
+                "`sudo rmmod edma-drv && sudo insmod <aws-fpga>/sdk/linux_kernel_drivers/edma/edma-drv.ko`\n",
+                slot_id);
+        fail_on(rc, out, "The PCI vendor id and device of the loaded image are "
+                "not the expected values.");
+    }
+
+out:
+    return rc;
+}
+
+static int f1_init(int slot_id) {
+    int rc;
+    /* initialize the fpga_plat library */
+    rc = fpga_mgmt_init();
+    fail_on(rc, out, "Unable to initialize the fpga_mgmt library");
+
+    /* initialize the fpga_pci library so we could have access to FPGA PCIe from this applications */
+    rc = fpga_pci_init();
+    fail_on(rc, out, "Unable to initialize the fpga_pci library");
+
+    pci_bar_handle = PCI_BAR_HANDLE_INIT;
+
+    rc = check_afi_ready(slot_id);
+    fail_on(rc, out, "AFI not ready");
+out:
+    return rc;
+}
+
+static int f1_open(int slot_id, int pf_id, int bar_id, int app) {
+    /* make sure the AFI is loaded and ready */
+    if (check_slot_config(slot_id) != 0) {
+        printf("slot config is not correct\n");
+        return 1;
+    }
+    for (f1_n_channels = 0; f1_n_channels < DMA_MAX_CHANNELS; f1_n_channels++) {
+        uint32_t c = f1_n_channels;
+        f1_write_fd[c] = fpga_dma_open_queue(FPGA_DMA_XDMA, slot_id,
+                /*channel*/ (c + 1) % DMA_MAX_CHANNELS, /*is_read*/ false);
+        f1_read_fd[c] = fpga_dma_open_queue(FPGA_DMA_XDMA, slot_id,
+                /*channel*/ c, /*is_read*/ true);
+        if (f1_write_fd[c] < 0 || f1_read_fd[c] < 0) {
+            if (f1_write_fd[c] >= 0) close(f1_write_fd[c]);
+            if (f1_read_fd[c] >= 0) close(f1_read_fd[c]);
+            break;
+        }
+    }
+    if (f1_n_channels == 0) {
+        printf("unable to open the dma queues\n");
+        return 1;
+    }
+    if (f1_n_channels < DMA_MAX_CHANNELS) {
+        printf("WARNING: only %u of %d dma channels available\n",
+                f1_n_channels, DMA_MAX_CHANNELS);
+    }
+    int rc = fpga_pci_attach(slot_id, pf_id, bar_id, 0, &pci_bar_handle);
+    if (rc != 0) {
+        for (uint32_t c = 0; c < f1_n_channels; c++) {
+            close(f1_write_fd[c]);
+            close(f1_read_fd[c]);
+        }
+        f1_n_channels = 0;
+    }
+    return rc;
+}
+
+static int f1_peek(uint32_t ocl_addr, uint32_t* data) {
+    return fpga_pci_peek(pci_bar_handle, ocl_addr, data);
+}
+
+static int f1_poke(uint32_t ocl_addr, uint32_t data) {
+    return fpga_pci_poke(pci_bar_handle, ocl_addr, data);
+}
+
+static uint32_t f1_dma_channels() {
+    return f1_n_channels;
+}
+
+static int f1_dma_write(uint32_t channel, const void* buf, uint64_t len, uint64_t addr) {
+    return fpga_dma_burst_write(f1_write_fd[channel], (uint8_t*) buf, len, addr);
+}
+
+static int f1_dma_read(uint32_t channel, void* buf, uint64_t len, uint64_t addr) {
+    return fpga_dma_burst_read(f1_read_fd[channel], (uint8_t*) buf, len, addr);
+}
+
+const device_t device_f1 = {
+    .name = "f1",
+    .init = f1_init,
+    .open = f1_open,
+    .peek = f1_peek,
+    .poke = f1_poke,
+    .dma_channels = f1_dma_channels,
+    .dma_write = f1_dma_write,
+    .dma_read = f1_dma_read,
+    // Since shell v1.4, writes through this path larger than 512 B do not
+    // work; the uploads have always been split into 512 B pieces
+    .max_write_size = 512,
+};
@@ -0,0 +1,194 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// The DMA engine: transfers between host memory and the DDR, sharded over
+// the device's DMA channels (the four XDMA channels on F1) with a thread
+// per channel. Shards are DMA_SHARD_SIZE bytes, aligned on the DDR side,
+// and handed out in address order, so a read completes roughly front to
+// back: dma_wait lets the caller consume the front of a read (eg: verify
+// results) while the rest is still in flight. Transfers that fit in one
+// shard run inline on channel 0.
+
+#include "header.h"
+
+#include <pthread.h>
+#include <time.h>
+
+struct dma_job;
+
+typedef struct {
+    struct dma_job* job;
+    uint32_t channel;
+    pthread_t thread;
+} dma_channel_t;
+
+struct dma_job {
+    bool write;
+    unsigned char* buf;
+    uint64_t len;
+    uint64_t addr;
+    uint64_t n_shards;
+    uint64_t next_shard;        // next one to hand out (atomic)
+    bool* shard_done;
+    uint64_t n_done_prefix;     // shards done from the first one
+    uint64_t done_bytes;        // bytes done from the start (atomic)
+    bool error;
+    uint32_t n_channels;
+    dma_channel_t channels[DMA_MAX_CHANNELS];
+    pthread_mutex_t lock;
+    pthread_cond_t progress;
+    struct timespec start;
+    struct timespec end;        // when the last byte was done
+};
+
+// Bytes [begin, end) of the job in shard s
+static void dma_shard(const dma_job_t* job, uint64_t s, uint64_t* begin, uint64_t* end) {
+    uint64_t first = DMA_SHARD_SIZE - (job->addr & (DMA_SHARD_SIZE - 1));
+    *begin = (s == 0) ? 0 : first + (s - 1) * DMA_SHARD_SIZE;
+    *end = first + s * DMA_SHARD_SIZE;
+    if (*end > job->len) *end = job->len;
+}
+
+static int dma_transfer(uint32_t channel, bool write, unsigned char* buf,
+        uint64_t len, uint64_t addr) {
+    int rc = write ? device->dma_write(channel, buf, len, addr)
+        : device->dma_read(channel, buf, len, addr);
+    if (rc != 0) {
+        printf("ERROR: dma %s of %lu bytes at %lx failed on channel %u\n",
+                write ? "write" : "read", len, addr, channel);
+    }
+    return rc;
+}
+
+static void* dma_channel_run(void* arg) {
+    dma_channel_t* ch = (dma_channel_t*) arg;
+    dma_job_t* job = ch->job;
+    while (true) {
+        uint64_t s = __atomic_fetch_add(&job->next_shard, 1, __ATOMIC_RELAXED);
+        if (s >= job->n_shards) break;
+        uint64_t begin, end;
+        dma_shard(job, s, &begin, &end);
+        int rc = dma_transfer(ch->channel, job->write, job->buf + begin,
+                end - begin, job->addr + begin);
+        pthread_mutex_lock(&job->lock);
+        if (rc != 0) job->error = true;
+        job->shard_done[s] = true;
+        while (job->n_done_prefix < job->n_shards && job->shard_done[job->n_done_prefix]) {
+            job->n_done_prefix++;
+        }
+        uint64_t done_bytes = job->len;
+        if (job->n_done_prefix < job->n_shards) {
+            dma_shard(job, job->n_done_prefix, &done_bytes, &end);
+        }
+        if (done_bytes == job->len) clock_gettime(CLOCK_MONOTONIC, &job->end);
+        __atomic_store_n(&job->done_bytes, done_bytes, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&job->progress);
+        pthread_mutex_unlock(&job->lock);
+        if (rc != 0) break;
+    }
+    return NULL;
+}
+
+dma_job_t* dma_start(bool write, void* buf, uint64_t len, uint64_t addr) {
+    dma_job_t* job = (dma_job_t*) calloc(1, sizeof(dma_job_t));
+    job->write = write;
+    job->buf = (unsigned char*) buf;
+    job->len = len;
+    job->addr = addr;
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->progress, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &job->start);
+
+    uint64_t first = DMA_SHARD_SIZE - (addr & (DMA_SHARD_SIZE - 1));
+    if (len <= first) {
+        job->error = (len > 0) && (dma_transfer(0, write, job->buf, len, addr) != 0);
+        job->done_bytes = len;
+        job->n_channels = 1;
+        clock_gettime(CLOCK_MONOTONIC, &job->end);
+        return job;
+    }
+    job->n_shards = 1 + (len - first + DMA_SHARD_SIZE - 1) / DMA_SHARD_SIZE;
+    job->shard_done = (bool*) calloc(job->n_shards, sizeof(bool));
+    job->n_channels = device->dma_channels();
+    if (job->n_channels > DMA_MAX_CHANNELS) job->n_channels = DMA_MAX_CHANNELS;
+    if (job->n_channels > job->n_shards) job->n_channels = job->n_shards;
+    for (uint32_t c = 0; c < job->n_channels; c++) {
+        dma_channel_t* ch = &job->channels[c];
+        ch->job = job;
+        ch->channel = c;
+        if (pthread_create(&ch->thread, NULL, dma_channel_run, ch) != 0) {
+            printf("ERROR: could not start the thread of dma channel %u\n", c);
+            exit(1);
+        }
+    }
+    return job;
+}
+
+void dma_wait(dma_job_t* job, uint64_t len) {
+    if (__atomic_load_n(&job->done_bytes, __ATOMIC_ACQUIRE) >= len) return;
+    pthread_mutex_lock(&job->lock);
+    while (job->done_bytes < len && !job->error) {
+        pthread_cond_wait(&job->progress, &job->lock);
+    }
+    bool error = job->error;
+    pthread_mutex_unlock(&job->lock);
+    if (error) exit(1);
+}
+
+double dma_finish(dma_job_t* job, const char* report) {
+    for (uint32_t c = 0; c < job->n_channels && job->n_shards > 0; c++) {
+        pthread_join(job->channels[c].thread, NULL);
+    }
+    if (job->error) exit(1);
+    double secs = (job->end.tv_sec - job->start.tv_sec)
+        + (job->end.tv_nsec - job->start.tv_nsec) / 1e9;
+    if (report) {
+        printf("%s: %.1f MB in %.3f s, %.2f GB/s on %u channel%s\n", report,
+                job->len / 1e6, secs, secs > 0 ? job->len / secs / 1e9 : 0.0,
+                job->n_channels, job->n_channels == 1 ? "" : "s");
+    }
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->progress);
+    free(job->shard_done);
+    free(job);
+    return secs;
+}
+
+void dma_write(unsigned char* write_buffer, uint64_t write_len, uint64_t write_addr) {
+    uint64_t max = device->max_write_size;
+    if (max == 0) {
+        dma_finish(dma_start(true, write_buffer, write_len, write_addr), NULL);
+        return;
+    }
+    for (uint64_t offset = 0; offset < write_len; offset += max) {
+        uint64_t len = write_len - offset < max ? write_len - offset : max;
+        if (dma_transfer(0, true, write_buffer + offset, len, write_addr + offset) != 0) {
+            exit(1);
+        }
+    }
+}
+
+void dma_read(void* read_buffer, uint64_t read_len, uint64_t read_addr) {
+    dma_finish(dma_start(false, read_buffer, read_len, read_addr), NULL);
+}
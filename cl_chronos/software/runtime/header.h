@@ -28,10 +28,25 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#ifndef CONFIG_EMU_ONLY
 #include <fpga_pci.h>
 #include <fpga_mgmt.h>
 #include <fpga_dma.h>
 #include <utils/lcd.h>
+#else
+// make DEVICE=emu: built without the AWS SDK, only the emulator device.
+// What the runtime uses from the SDK headers outside device_f1.c.
+#define FPGA_APP_PF 0
+#define APP_PF_BAR0 0
+#define fail_on(CONDITION, LABEL, ...) \
+    do { \
+        if (CONDITION) { \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            goto LABEL; \
+        } \
+    } while (0)
+#endif
 
 #include <fcntl.h>
 #include <errno.h>
@@ -61,6 +76,24 @@
 
 #define TOTAL_SPILL_ALLOCATION (SPILL_TASK_BASE_OFFSET*2)
 
+// Input images (tools/graph_gen/graph_gen.h). Large ones have a 32-word
+// header with 64-bit copies of words 2-8 in words 18-31.
+#define IMAGE_HEADER_WORDS       16
+#define LARGE_HEADER_WORDS       32
+#define LARGE_IMAGE_MAGIC        0x6c617267 // header word 16
+#define IMAGE_CHUNK_SIZE         (64 << 20) // staging buffer for the image DMA
+#define FPGA_DDR_SIZE            (64ull << 30)
+#define RISCV_CODE_BASE          0x80000000
+// Edge formats (tools/graph_gen/graph_gen.h); header word 9 for sssp, 10
+// for color
+#define EDGE_FORMAT_PAIR         0
+#define EDGE_FORMAT_PACKED       1
+#define EDGE_FORMAT_VARINT       2
+
+// DMA engine (dma_engine.c)
+#define DMA_MAX_CHANNELS         4
+#define DMA_SHARD_SIZE           (4 << 20) // a power of 2
+
 
 #define ID_ALL_CORES              32
 #define ID_ALL_APP_CORES         33
@@ -260,18 +293,18 @@
 
 #define RISCV_ID 256
 
-int log_sssp_core(pci_bar_handle_t pci_bar_handle, int fd, int cid, FILE* fw);
-int log_task_unit(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_cq(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_cache(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_splitter(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_coalescer(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_riscv(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_ddr(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_serializer(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_ro_stage(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_rw_stage(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
-int log_undo_log(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*, uint32_t);
+int log_sssp_core(int cid, FILE* fw);
+int log_task_unit(FILE* fw, unsigned char*, uint32_t);
+int log_cq(FILE* fw, unsigned char*, uint32_t);
+int log_cache(FILE* fw, unsigned char*, uint32_t);
+int log_splitter(FILE* fw, unsigned char*, uint32_t);
+int log_coalescer(FILE* fw, unsigned char*, uint32_t);
+int log_riscv(FILE* fw, unsigned char*, uint32_t);
+int log_ddr(FILE* fw, unsigned char*, uint32_t);
+int log_serializer(FILE* fw, unsigned char*, uint32_t);
+int log_ro_stage(FILE* fw, unsigned char*, uint32_t);
+int log_rw_stage(FILE* fw, unsigned char*, uint32_t);
+int log_undo_log(FILE* fw, unsigned char*, uint32_t);
 void write_task_unit_log(unsigned char* log_buffer, FILE* fw, uint32_t log_size, uint32_t tile_id);
 
 void init_params();
@@ -281,8 +314,55 @@ void task_unit_stats(uint32_t tile, uint32_t);
 void serializer_stats(uint32_t tile, uint32_t);
 void cq_stats (uint32_t tile, uint32_t);
 void core_stats (uint32_t tile, uint32_t);
+#ifndef CONFIG_EMU_ONLY
 extern pci_bar_handle_t pci_bar_handle;
-void dma_write(unsigned char* write_buffer, uint32_t write_len, size_t write_addr);
+#endif
+
+// DMA engine. dma_start begins a transfer over all the device's DMA
+// channels, dma_wait blocks until its first len bytes are done, and
+// dma_finish waits for the rest and, with a report label, prints the
+// throughput. It returns the seconds the transfer took. Failed transfers
+// exit.
+typedef struct dma_job dma_job_t;
+dma_job_t* dma_start(bool write, void* buf, uint64_t len, uint64_t addr);
+void dma_wait(dma_job_t* job, uint64_t len);
+double dma_finish(dma_job_t* job, const char* report);
+void dma_write(unsigned char* write_buffer, uint64_t write_len, uint64_t write_addr);
+void dma_read(void* read_buffer, uint64_t read_len, uint64_t read_addr);
+
+// Device backends. Every OCL register access and DMA of the runtime goes
+// through device: the F1 card through the AWS SDK (device_f1.c, the
+// default), or with --device=emu an in-process emulator of the OCL register
+// map and the DDR with a functional task engine (device_emu.c). Builds with
+// make DEVICE=emu (CONFIG_EMU_ONLY) leave device_f1 out and need no SDK.
+// The hooks return 0 on success.
+typedef struct {
+    const char* name;
+    // before anything else (slot checks), and before the first access
+    int (*init)(int slot_id);
+    // app is the APP_* being run; the emulator's task engine needs it
+    // since there is no bitstream to tell
+    int (*open)(int slot_id, int pf_id, int bar_id, int app);
+    int (*peek)(uint32_t ocl_addr, uint32_t* data);
+    int (*poke)(uint32_t ocl_addr, uint32_t data);
+    // DMA channels 0 .. dma_channels()-1 can be used concurrently
+    uint32_t (*dma_channels)(void);
+    int (*dma_write)(uint32_t channel, const void* buf, uint64_t len, uint64_t addr);
+    // reads past the DDR (the debug logs) are allowed
+    int (*dma_read)(uint32_t channel, void* buf, uint64_t len, uint64_t addr);
+    // dma_write (the code and spill uploads) splits transfers into pieces
+    // of at most this many bytes; 0 for no limit
+    uint32_t max_write_size;
+} device_t;
+
+#ifndef CONFIG_EMU_ONLY
+extern const device_t device_f1;
+#endif
+extern const device_t device_emu;
+extern const device_t* device;
+
+int check_slot_config(int slot_id);
+int check_afi_ready(int slot_id);
 
 void loop_debuggin_spec(uint32_t iters);
 void loop_debuggin_nonspec(uint32_t iters);
@@ -296,6 +376,8 @@ extern uint32_t ID_SPLITTER;
 extern uint32_t ID_COALESCER;
 extern uint32_t ID_UNDO_LOG;
 extern uint32_t ID_TASK_UNIT;
+extern uint32_t ID_L2_RW;
+extern uint32_t ID_L2_RO;
 extern uint32_t ID_L2;
 extern uint32_t ID_MEM_ARB;
 extern uint32_t ID_PCI_ARB;
@@ -305,6 +387,7 @@ extern uint32_t ID_LAST;
 extern uint32_t LOG_TQ_SIZE, LOG_CQ_SIZE;
 extern uint32_t TQ_STAGES, SPILLQ_STAGES;
 extern uint32_t NO_ROLLBACK;
+extern uint32_t active_tiles;
 
 /*
  * pci_vendor_id and pci_device_id values below are Amazon's and avaliable to use for a given FPGA slot.
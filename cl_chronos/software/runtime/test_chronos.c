@@ -38,6 +38,10 @@
 
 #include "header.h"
 
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 
 
 int dma_example(int slot_i);
@@ -47,7 +51,11 @@ int dma_example(int slot_i);
 /* /aws-fpga/hdk/cl/examples/common/cl_common_defines.vh */
 
 
-pci_bar_handle_t pci_bar_handle;
+#ifndef CONFIG_EMU_ONLY
+const device_t* device = &device_f1;
+#else
+const device_t* device = &device_emu;
+#endif
 uint32_t APP_ID;
 uint32_t N_TILES;
 uint32_t N_CORES;
@@ -81,6 +89,9 @@ bool logging_on =false;
 uint32_t ddr_throttle_factor = 1;
 uint32_t logging_phase_tasks = 0x100;
 uint32_t reading_binary_file = false;
+bool use_hugepages = false;
+double run_timeout_s = 30; // for the app to complete
+char* report_file = NULL;
 
 uint16_t pci_vendor_id = 0x1D0F; /* Amazon PCI Vendor ID */
 uint16_t pci_device_id = 0xF000; /* PCI Device ID preassigned by Amazon for F1 applications */
@@ -94,16 +105,13 @@ int vled_example(int slot);
 
 /* Declating auxilary house keeping functions */
 int initialize_log(char* log_name);
-int check_afi_ready(int slot);
 
 FILE* fhex;
-int write_fd;
-int read_fd;
 
 
 void pci_peek(uint32_t tile, uint32_t comp, uint32_t addr, uint32_t* data) {
     uint32_t ocl_addr = (tile << 16) + (comp << 8) + addr;
-    int rc = fpga_pci_peek(pci_bar_handle, ocl_addr, data);
+    int rc = device->peek(ocl_addr, data);
 
     if ( (rc != 0) |
             ( 1 & ( (*data == -1) & !((comp == ID_CQ) & (addr == CQ_GVT_TS)))) ) {
@@ -113,12 +121,59 @@ void pci_peek(uint32_t tile, uint32_t comp, uint32_t addr, uint32_t* data) {
 }
 void pci_poke(uint32_t tile, uint32_t comp, uint32_t addr, uint32_t data) {
     uint32_t ocl_addr = (tile << 16) + (comp << 8) + addr;
-    int rc = fpga_pci_poke(pci_bar_handle, ocl_addr, data);
+    int rc = device->poke(ocl_addr, data);
     if (rc != 0) {
         printf("Unable to write to OCL addr=%8x, data=%d\n", ocl_addr, data);
         exit(0);
     }
 }
+// Register polls back off adaptively: the first POLL_SPINS polls go back to
+// back (a peek is a PCIe round trip already), then the sleep between them
+// doubles from 1 us up to POLL_MAX_SLEEP_US.
+#define POLL_SPINS          64
+#define POLL_MAX_SLEEP_US   1000
+
+typedef struct {
+    uint32_t n;
+    uint32_t sleep_us;
+    struct timespec start;
+} poll_t;
+
+double elapsed_s(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void poll_begin(poll_t* poll) {
+    poll->n = 0;
+    poll->sleep_us = 1;
+    clock_gettime(CLOCK_MONOTONIC, &poll->start);
+}
+
+// Waits before the next poll. Returns false once timeout_s have passed
+// since poll_begin.
+bool poll_next(poll_t* poll, double timeout_s) {
+    if (elapsed_s(&poll->start) > timeout_s) return false;
+    if (poll->n++ < POLL_SPINS) return true;
+    usleep(poll->sleep_us);
+    if (poll->sleep_us < POLL_MAX_SLEEP_US) poll->sleep_us *= 2;
+    return true;
+}
+
+// Polls (tile, comp, addr) until it reads value. Returns false on timeout.
+bool pci_poll(uint32_t tile, uint32_t comp, uint32_t addr, uint32_t value,
+        double timeout_s) {
+    poll_t poll;
+    poll_begin(&poll);
+    uint32_t data;
+    do {
+        pci_peek(tile, comp, addr, &data);
+        if (data == value) return true;
+    } while (poll_next(&poll, timeout_s));
+    return false;
+}
+
 void init_params() {
 
     pci_peek(0, ID_OCL_SLAVE, OCL_PARAM_APP_ID, &APP_ID);
@@ -168,6 +223,78 @@ void init_params() {
 
 }
 
+// Wall-clock time of each runtime step, as offsets from run_start. Steps
+// may nest or overlap (eg: SSSP verifies the results as the readback
+// arrives), so they do not add up to the total.
+#define MAX_STAGES 64
+
+typedef struct {
+    const char* name;
+    double start_s;
+    double secs;
+} stage_t;
+
+struct timespec run_start;
+stage_t stages[MAX_STAGES];
+uint32_t n_stages = 0;
+
+// filled in by test_chronos for the report
+uint64_t run_cycles = 0;
+uint32_t run_tasks = 0;
+int run_errors = -1;
+
+uint32_t stage_begin(const char* name) {
+    if (n_stages == MAX_STAGES) n_stages--; // overwrite the last one
+    stages[n_stages].name = name;
+    stages[n_stages].start_s = elapsed_s(&run_start);
+    stages[n_stages].secs = 0;
+    return n_stages++;
+}
+
+void stage_end(uint32_t s) {
+    stages[s].secs = elapsed_s(&run_start) - stages[s].start_s;
+}
+
+// Prints the steps, and writes them to report_file as JSON if one was given
+void stage_report(const char* app, const char* input, int rc) {
+    double total_s = elapsed_s(&run_start);
+    printf("Runtime steps (wall clock):\n");
+    for (uint32_t i = 0; i < n_stages; i++) {
+        printf("  %-16s at %9.3f ms  %9.3f ms\n", stages[i].name,
+                stages[i].start_s * 1e3, stages[i].secs * 1e3);
+    }
+    printf("  %-16s %25.3f ms\n", "total", total_s * 1e3);
+    if (report_file == NULL) return;
+
+    FILE* fr = fopen(report_file, "w");
+    if (fr == NULL) {
+        printf("ERROR: unable to open report file %s\n", report_file);
+        return;
+    }
+    fprintf(fr, "{\n");
+    fprintf(fr, "  \"app\": \"%s\",\n", app);
+    fprintf(fr, "  \"input\": \"");
+    for (const char* c = input; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', fr);
+        fputc(*c, fr);
+    }
+    fprintf(fr, "\",\n");
+    fprintf(fr, "  \"device\": \"%s\",\n", device->name);
+    fprintf(fr, "  \"status\": %d,\n", rc);
+    fprintf(fr, "  \"errors\": %d,\n", run_errors);
+    fprintf(fr, "  \"fpga_cycles\": %lu,\n", run_cycles);
+    fprintf(fr, "  \"tasks\": %u,\n", run_tasks);
+    fprintf(fr, "  \"total_s\": %.6f,\n", total_s);
+    fprintf(fr, "  \"stages\": [");
+    for (uint32_t i = 0; i < n_stages; i++) {
+        fprintf(fr, "%s\n    {\"name\": \"%s\", \"start_s\": %.6f, \"secs\": %.6f}",
+                i ? "," : "", stages[i].name, stages[i].start_s, stages[i].secs);
+    }
+    fprintf(fr, "\n  ]\n}\n");
+    fclose(fr);
+    printf("Wrote report to %s\n", report_file);
+}
+
 int prefix(const char* pre, char* str) {
     return strncmp(pre, str, strlen(pre)) ==0;
 }
@@ -176,28 +303,21 @@ int main(int argc, char **argv) {
     int rc;
     int slot_id;
 
-    char* usage = "Usage ./test_chronos <--options=val> app <input> <riscv_hex_file>";
+    char* usage = "Usage ./test_chronos <--options=val> app <input> <riscv_hex_file>\n"
+        "  --device=f1|emu  run on the F1 card (default) or the in-process emulator\n"
+        "  --hugepages=1  back the input image with huge pages where the kernel allows\n"
+        "  --timeout=<s>  fail if the app has not completed after s seconds (default 30)\n"
+        "  --report=<file>  write the wall-clock time of each runtime step to file (JSON)";
     if (argc <2)  {
         printf("%s\n", usage);
         exit(0);
     }
-    /* initialize the fpga_plat library */
-    rc = fpga_mgmt_init();
-    fail_on(rc, out, "Unable to initialize the fpga_mgmt library");
 
-    /* initialize the fpga_pci library so we could have access to FPGA PCIe from this applications */
-    rc = fpga_pci_init();
-    fail_on(rc, out, "Unable to initialize the fpga_pci library");
+    clock_gettime(CLOCK_MONOTONIC, &run_start);
 
     /* This demo works with single FPGA slot, we pick slot #0 as it works for both f1.2xl and f1.16xl */
-    pci_bar_handle = PCI_BAR_HANDLE_INIT;
-
     slot_id = 0;
 
-    rc = check_afi_ready(slot_id);
-    fail_on(rc, out, "AFI not ready");
-
-
     int n_options = 0;
     int cur_arg = 1;
     while( prefix("--", argv[cur_arg])){
@@ -207,20 +327,50 @@ int main(int argc, char **argv) {
         if (prefix("--n_tiles", argv[cur_arg])) active_tiles = atoi(val);
         if (prefix("--n_threads", argv[cur_arg])) active_threads = atoi(val);
         if (prefix("--logging", argv[cur_arg])) logging_on = (atoi(val)==1);
+        if (prefix("--hugepages", argv[cur_arg])) use_hugepages = (atoi(val)==1);
+        if (prefix("--timeout", argv[cur_arg])) run_timeout_s = atof(val);
+        if (prefix("--report", argv[cur_arg])) report_file = (char*) val;
         if (prefix("--rate_ctrl", argv[cur_arg])) {
             ddr_throttle_factor = atoi(val);
         }
+        if (prefix("--device", argv[cur_arg])) {
+            if (strcmp(val, "emu") == 0) device = &device_emu;
+            else if (strcmp(val, "f1") == 0) {
+#ifndef CONFIG_EMU_ONLY
+                device = &device_f1;
+#else
+                printf("ERROR: built with DEVICE=emu, without the f1 device\n");
+                exit(1);
+#endif
+            }
+            else {
+                printf("ERROR: unknown device %s (f1 or emu)\n", val);
+                exit(1);
+            }
+        }
 
         cur_arg++;
     }
 
+    printf("Device %s\n", device->name);
+    uint32_t s_init = stage_begin("device_init");
+    rc = device->init(slot_id);
+    stage_end(s_init);
+    fail_on(rc, out, "Device not ready");
+
     int app = -1; // Invalid number
     FILE* fg;
     fhex = 0;
     char* str_app = argv[cur_arg];
     if (strcmp(str_app, "dma_test") ==0) {
-        dma_example(slot_id);
-        exit(0);
+#ifndef CONFIG_EMU_ONLY
+        if (device == &device_f1) {
+            dma_example(slot_id);
+            exit(0);
+        }
+#endif
+        printf("ERROR: dma_test needs the F1 device\n");
+        exit(1);
     }
     if (strcmp(str_app, "sssp") ==0) {
         app = APP_SSSP;
@@ -260,48 +410,15 @@ int main(int argc, char **argv) {
     if (app == -1) {
         printf("Invalid app\n"); exit(0);
     }
-    test_chronos(slot_id, FPGA_APP_PF, APP_PF_BAR0, fg, app);
-    return 0;
+    rc = test_chronos(slot_id, FPGA_APP_PF, APP_PF_BAR0, fg, app);
+    stage_report(str_app, argv[cur_arg+1], rc);
+    return rc != 0;
 
 out:
     return 1;
 }
 
 
-    static int
-check_slot_config(int slot_id)
-{
-    int rc;
-    struct fpga_mgmt_image_info info = {0};
-
-    /* get local image description, contains status, vendor id, and device id */
-    rc = fpga_mgmt_describe_local_image(slot_id, &info, 0);
-    fail_on(rc, out, "Unable to get local image information. Are you running as root?");
-
-    /* check to see if the slot is ready */
-    if (info.status != FPGA_STATUS_LOADED) {
-        rc = 1;
-        fail_on(rc, out, "Slot %d is not ready", slot_id);
-    }
-
-    /* confirm that the AFI that we expect is in fact loaded */
-    if (info.spec.map[FPGA_APP_PF].vendor_id != pci_vendor_id ||
-            info.spec.map[FPGA_APP_PF].device_id != pci_device_id) {
-        rc = 1;
-        printf("The slot appears loaded, but the pci vendor or device ID doesn't "
-                "match the expected values. You may need to rescan the fpga with \n"
-                "fpga-describe-local-image -S %i -R\n"
-                "Note that rescanning can change which device file in /dev/ a FPGA will map to.\n"
-                "To remove and re-add your edma driver and reset the device file mappings, run\n"
-                "`sudo rmmod edma-drv && sudo insmod <aws-fpga>/sdk/linux_kernel_drivers/edma/edma-drv.ko`\n",
-                slot_id);
-        fail_on(rc, out, "The PCI vendor id and device of the loaded image are "
-                "not the expected values.");
-    }
-
-out:
-    return rc;
-}
     void
 rand_string(char *str, size_t size)
 {
@@ -322,33 +439,234 @@ rand_string(char *str, size_t size)
     str[size-1] = '\0';
 }
 
-void dma_write(unsigned char* write_buffer, uint32_t write_len, size_t write_addr) {
+// The input image. Binary images are mapped and DMA'd straight from the
+// page cache; the sections needed for verification are copied out on demand,
+// so the image size is only bounded by the DDR. Hex images are decoded into
+// a buffer sized to the file. Binary files that cannot be mapped are read
+// through a staging buffer instead.
+typedef struct {
+    FILE* f;              // binary image that could not be mapped, or NULL
+    unsigned char* mem;   // mapped binary or decoded hex image, or NULL
+    uint64_t map_len;     // bytes mapped at mem
+    uint64_t len;         // bytes
+    bool large;
+    // as written to the FPGA (the first words of the image)
+    uint32_t header[LARGE_HEADER_WORDS];
+} image_t;
+
+image_t image;
+
+void image_read(void* dst, uint64_t pos, uint64_t len) {
+    if (pos + len > image.len) {
+        printf("ERROR: read of %lu bytes at %lu is past the end of the image\n", len, pos);
+        exit(1);
+    }
+    if (image.mem) {
+        memcpy(dst, image.mem + pos, len);
+        return;
+    }
+    uint64_t done = 0;
+    while (done < len) {
+        ssize_t rc = pread(fileno(image.f), (unsigned char*) dst + done, len - done, pos + done);
+        if (rc <= 0) {
+            printf("ERROR: could not read the input file\n");
+            exit(1);
+        }
+        done += rc;
+    }
+}
 
-    size_t write_offset = 0;
-    int rc;
-    // After moving to v1.4, dma transfers larger than 512 B doesn't work.
-    // Not sure why this happens; but temp fix by splitting larger transfers to
-    // 512 B chunks.
-    uint32_t chunk_size = 512;
-    while (write_offset < write_len) {
-        if (write_offset != 0) {
-            //    printf("Partial write by driver, trying again with remainder of buffer (%lu bytes)\n",
-            //          write_len - write_offset);
+uint32_t hti(char c);
+
+// image.mem as len bytes of anonymous memory, from the hugetlb pool with
+// --hugepages=1 (transparent huge pages if the pool is empty)
+static void image_alloc(uint64_t len) {
+    void* p = MAP_FAILED;
+    if (use_hugepages) {
+        image.map_len = (len + (2 << 20) - 1) & ~((2ull << 20) - 1);
+        p = mmap(NULL, image.map_len, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (p == MAP_FAILED) {
+        image.map_len = len;
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            printf("ERROR: could not allocate %lu bytes for the input image\n", len);
+            exit(1);
+        }
+        if (use_hugepages) madvise(p, len, MADV_HUGEPAGE);
+    }
+    image.mem = (unsigned char*) p;
+}
+
+// The next word at *pos, as fscanf("%8x\n") reads them: up to 8 hex digits
+// after any whitespace. Returns false at the end of the words.
+static bool hex_decode_slow(const char* text, uint64_t len, uint64_t* pos, uint32_t* word) {
+    uint64_t i = *pos;
+    while (i < len && isspace((unsigned char) text[i])) i++;
+    uint32_t value = 0;
+    uint32_t n = 0;
+    while (i < len && n < 8 && isxdigit((unsigned char) text[i])) {
+        value = (value << 4) | hti(text[i]);
+        i++;
+        n++;
+    }
+    *pos = i;
+    *word = value;
+    return n > 0;
+}
+
+// Decodes a hex image into image.mem. Lines of exactly 8 digits and a
+// newline, which is all of them in the images graph_gen writes, are decoded
+// 8 digits at a time in a 64-bit register; anything else goes through
+// hex_decode_slow.
+static void image_decode_hex(const char* text, uint64_t len) {
+    // A word takes at least a digit and a separator (or is the 9th digit of
+    // a run), so there are at most len/2 + 1 of them. The pages past the
+    // words decoded are never touched.
+    image_alloc((len / 2 + 1) * 4);
+    uint32_t* words = (uint32_t*) image.mem;
+    uint64_t n_words = 0;
+    uint64_t pos = 0;
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t high = 0x8080808080808080ull;
+    while (pos < len) {
+        if (pos + 9 <= len && text[pos + 8] == '\n') {
+            uint64_t x;
+            memcpy(&x, text + pos, 8);
+            // byte-wise range checks (bit 7 of a + (0x80 - lo) is a >= lo)
+            uint64_t lower = x | (0x20 * ones);
+            uint64_t digit = (x + 0x50 * ones) & ~(x + 0x46 * ones);
+            uint64_t alpha = (lower + 0x1f * ones) & ~(lower + 0x19 * ones);
+            if (!(x & high) && ((digit | alpha) & high) == high) {
+                // nibbles: the low 4 bits, +9 for letters (bit 6)
+                uint64_t n = (x & (0x0f * ones)) + 9 * ((x >> 6) & ones);
+                // the first digit is the most significant
+                n = ((n & 0x00ff00ff00ff00ffull) << 4) | ((n >> 8) & 0x00ff00ff00ff00ffull);
+                n = (n | (n >> 8)) & 0x0000ffff0000ffffull;
+                n = (n | (n >> 16)) & 0xffffffffull;
+                words[n_words++] = __builtin_bswap32((uint32_t) n);
+                pos += 9;
+                continue;
+            }
+        }
+        uint32_t word;
+        if (!hex_decode_slow(text, len, &pos, &word)) break;
+        words[n_words++] = word;
+    }
+    image.len = n_words * 4;
+}
+// Maps a whole file read-only, or returns NULL if it cannot be mapped
+static unsigned char* map_file(FILE* f, uint64_t* len) {
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return NULL;
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (p == MAP_FAILED) return NULL;
+    *len = st.st_size;
+    return (unsigned char*) p;
+}
+
+void image_open(FILE* fg) {
+    memset(&image, 0, sizeof(image));
+    uint64_t file_len = 0;
+    unsigned char* file = map_file(fg, &file_len);
+    if (reading_binary_file) {
+        if (file) {
+            image.mem = file;
+            image.map_len = file_len;
+            image.len = file_len;
+            // read once, front to back, by the DMA
+            madvise(file, file_len, MADV_SEQUENTIAL);
+            madvise(file, file_len, MADV_WILLNEED);
+            if (use_hugepages) madvise(file, file_len, MADV_HUGEPAGE);
+        } else {
+            image.f = fg;
+            fseek (fg , 0 , SEEK_END);
+            image.len = ftell (fg);
         }
-        //rc = fpga_dma_burst_write(write_fd,
-        rc = pwrite(write_fd,
-                write_buffer + write_offset,
-                (write_len - write_offset) > chunk_size ? chunk_size: (write_len - write_offset) ,
-                write_addr + write_offset);
-        if (rc < 0) {
-            printf("call to pwrite failed.\n");
+    } else {
+        if (file == NULL) {
+            // not a regular file: read it all first
+            uint64_t capacity = 1<<20;
+            file = (unsigned char*) malloc(capacity);
+            size_t n;
+            while ((n = fread(file + file_len, 1, capacity - file_len, fg)) > 0) {
+                file_len += n;
+                if (file_len == capacity) {
+                    capacity *= 2;
+                    file = (unsigned char*) realloc(file, capacity);
+                }
+            }
+            image_decode_hex((const char*) file, file_len);
+            free(file);
+        } else {
+            image_decode_hex((const char*) file, file_len);
+            munmap(file, file_len);
         }
-        //printf("rc %d\n", rc);
-        write_offset += rc;
     }
-    rc = 0;
+    printf("File %p size %lu%s\n", fg, image.len,
+            (reading_binary_file && image.mem) ? " (mapped)" : "");
+    image_read(image.header, 0,
+            image.len < sizeof(image.header) ? image.len : sizeof(image.header));
+    image.large = (image.header[16] == LARGE_IMAGE_MAGIC) &&
+        (image.header[17] == LARGE_HEADER_WORDS);
+}
 
+void image_close() {
+    if (image.mem != NULL) munmap(image.mem, image.map_len);
+    image.mem = NULL;
 }
+
+// Header word i (section bases are 64-bit in large images)
+uint64_t image_header(uint32_t i) {
+    if (image.large && i >= 2 && i <= 8) {
+        return image.header[14 + 2*i] | (uint64_t) image.header[15 + 2*i] << 32;
+    }
+    return image.header[i];
+}
+
+// n_words words at word offset base, in a malloc'd buffer
+uint32_t* image_section(uint64_t base, uint64_t n_words) {
+    uint32_t* p = (uint32_t*) malloc(n_words * 4 + 4);
+    if (p == NULL) {
+        printf("ERROR: could not allocate %lu words to verify against\n", n_words);
+        exit(1);
+    }
+    image_read(p, base * 4, n_words * 4);
+    return p;
+}
+
+// Writes the image to DDR address 0, with the (patched) header on top.
+// Mapped and decoded images are DMA'd in place; others go through a
+// staging buffer, reading the next chunk while the last one is written.
+void image_write_fpga() {
+    uint64_t header_len = image.len < sizeof(image.header) ? image.len : sizeof(image.header);
+    dma_write((unsigned char*) image.header, header_len, 0);
+    if (image.mem) {
+        dma_finish(dma_start(true, image.mem + header_len, image.len - header_len,
+                    header_len), "Input DMA");
+        return;
+    }
+    unsigned char* chunk[2];
+    chunk[0] = (unsigned char*) malloc(IMAGE_CHUNK_SIZE);
+    chunk[1] = (unsigned char*) malloc(IMAGE_CHUNK_SIZE);
+    dma_job_t* job = NULL;
+    uint32_t c = 0;
+    for (uint64_t pos = header_len; pos < image.len; pos += IMAGE_CHUNK_SIZE) {
+        uint64_t len = image.len - pos;
+        if (len > IMAGE_CHUNK_SIZE) len = IMAGE_CHUNK_SIZE;
+        image_read(chunk[c], pos, len);
+        if (job) dma_finish(job, NULL);
+        job = dma_start(true, chunk[c], len, pos);
+        c ^= 1;
+    }
+    if (job) dma_finish(job, NULL);
+    free(chunk[0]);
+    free(chunk[1]);
+}
+
 uint32_t hti(char c) {
     if (c >= 'A' && c <= 'F')
         return c - 'A' + 10;
@@ -453,39 +771,18 @@ void load_code() {
 
 int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
     int rc;
-    unsigned char *write_buffer, *read_buffer;
+    unsigned char *read_buffer;
 
     read_buffer = NULL;
-    write_buffer = NULL;
-    write_fd = -1;
-    read_fd = -1;
-
 
-    /* make sure the AFI is loaded and ready */
-    rc = check_slot_config(slot_id);
-    if (rc >0) {
-        printf("slot config is not correct\n");
-        exit(0);
-    }
-
-    write_fd = fpga_dma_open_queue(FPGA_DMA_XDMA, slot_id,
-            /*channel*/ 1, /*is_read*/ false);
-    if(write_fd<0){
-        printf("unable to open write dma queue\n");
-        exit(0);
-    }
-    read_fd = fpga_dma_open_queue(FPGA_DMA_XDMA, slot_id,
-            /*channel*/ 0, /*is_read*/ true);
-    if(read_fd<0){
-        printf("unable to open read dma queue\n");
-        exit(0);
-    }
-    rc = fpga_pci_attach(slot_id, pf_id, bar_id, 0, &pci_bar_handle);
-    if (rc > 0) {
-        printf("Unable to attach to the AFI on slot id %d\n", slot_id);
-        exit(0);
+    uint32_t s = stage_begin("open");
+    rc = device->open(slot_id, pf_id, bar_id, app);
+    if (rc != 0) {
+        printf("Unable to open the %s device on slot id %d\n", device->name, slot_id);
+        return 1;
     }
     init_params();
+    stage_end(s);
 
 
     // Change here if you want to reduce the system size
@@ -501,33 +798,18 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
 
     // Stage 1: Read input file and transfer to the FPGA
     printf("File %p\n", fg);
-    write_buffer = (unsigned char *)malloc(1600*1024*1024);
-    uint32_t* headers = (uint32_t*) write_buffer;
-    long lSize;
-    if (reading_binary_file) {
-       fseek (fg , 0 , SEEK_END);
-       lSize = ftell (fg);
-       printf("File %p size %ld\n", fg, lSize);
-       rewind (fg);
-       fread( (void*) write_buffer, 1, lSize, fg);
-       for (int i=0;i<16;i++) {
-            printf("headers %d %x \n", i, headers[i]);
-       }
-    } else {
-        uint32_t line;
-        int ret;
-        int n = 0;
-        while ( (ret = fscanf(fg,"%8x\n", &line)) != EOF) {
-            //line = n;
-            write_buffer[n ] = line & 0xff;
-            write_buffer[n +1] = (line >>8) & 0xff;
-            write_buffer[n +2] = (line >>16) & 0xff;
-            write_buffer[n +3] = (line >>24) & 0xff;
-            if (n<64) headers[n/4] = line;
-            n+=4;
-        }
-        printf("File Len %d\n", n);
-        lSize = n;
+    s = stage_begin("file_read");
+    image_open(fg);
+    stage_end(s);
+    // headers are poked into the cores; only the color patch below is also
+    // written to memory
+    uint32_t headers[LARGE_HEADER_WORDS];
+    memcpy(headers, image.header, sizeof(headers));
+    for (int i=0;i<16;i++) {
+         printf("headers %d %x \n", i, headers[i]);
+    }
+    if (image.large) {
+        printf("Large image, %lu bytes\n", image.len);
     }
     if (app == APP_MAXFLOW) {
         uint32_t log_gr_interval = headers[10];
@@ -549,7 +831,7 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
     }
     if (app == APP_COLOR) {
         headers[9] = 96;
-        write_buffer[9*4] = headers[9];
+        image.header[9] = headers[9];
     }
     if (app == APP_DES) {
         headers[13] = 1;
@@ -558,47 +840,60 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
         uint32_t base_latlon = headers[6];
         uint32_t destNode = headers[8];
         // copy dest lat lon
-        uint32_t dest_lat_addr = (base_latlon ) + destNode *2;
-        headers[11] =  ((uint32_t *) write_buffer)[dest_lat_addr]  ;
-        headers[12] =  ((uint32_t *) write_buffer)[dest_lat_addr + 1]  ;
+        uint64_t dest_lat_addr = (base_latlon ) + destNode *2ull;
+        image_read(&headers[11], dest_lat_addr*4, 8);
         headers[13] = 3;
-        printf("dest lat %d %x\n", dest_lat_addr, headers[11]);
+        printf("dest lat %lu %x\n", dest_lat_addr, headers[11]);
     }
     if (app == APP_SILO) {
         //headers[31] = 1;
     }
     uint32_t numV = headers[1];
-    uint32_t numE = headers[2];;
+    uint64_t numE = image_header(2);
+    // the first section, which holds the results for every app
+    uint64_t results_addr = 4 * (image.large ? LARGE_HEADER_WORDS : IMAGE_HEADER_WORDS);
+
+    // The spill areas go at ADDR_BASE_SPILL, or above the image if it
+    // reaches that far
+    uint64_t spill_base = ADDR_BASE_SPILL;
+    if (image.len > spill_base) {
+        spill_base = (image.len + (1<<30) - 1) & ~((1ull<<30) - 1);
+    }
+    uint64_t spill_end = spill_base + (uint64_t) N_TILES * TOTAL_SPILL_ALLOCATION;
+    if (spill_end > FPGA_DDR_SIZE) {
+        printf("ERROR: image of %lu bytes and spill areas do not fit in DDR\n", image.len);
+        exit(1);
+    }
+    if (fhex && spill_end > RISCV_CODE_BASE) {
+        printf("ERROR: image of %lu bytes overlaps the riscv code at %x\n",
+                image.len, RISCV_CODE_BASE);
+        exit(1);
+    }
 
 
     uint32_t startCycle, endCycle;
 
-    int file_len = lSize;
     read_buffer = (unsigned char *)malloc(headers[1]*4);
     pci_peek(0, ID_OCL_SLAVE, OCL_CUR_CYCLE_LSB, &startCycle);
-    rc =fpga_dma_burst_write(write_fd, write_buffer, file_len, 0);
+    s = stage_begin("input_dma");
+    image_write_fpga();
+    stage_end(s);
     pci_peek(0, ID_OCL_SLAVE, OCL_CUR_CYCLE_LSB, &endCycle);
     printf("Write input data: cycles from %d %d\n", startCycle, endCycle);
     rc = 0;
 
-    uint32_t* csr_offset = (uint32_t *) (write_buffer + headers[3]*4);
-    uint32_t* csr_neighbors = (uint32_t *) (write_buffer + headers[4]*4);
-    uint32_t* csr_ref_color = (uint32_t *) (write_buffer + headers[6]*4);
-
-    if(rc!=0){
-        printf("unable to write_dma\n");
-        exit(0);
-    }
-
 
     if (fhex) {
         // If running on risc-v cores
+        s = stage_begin("code_load");
         load_code();
+        stage_end(s);
     }
     printf("Loading code... Success\n");
 
 
     // Stage 2: Intialize Task-spilling data structures
+    s = stage_begin("spill_init");
     unsigned char* spill_area = (unsigned char*) malloc(TOTAL_SPILL_ALLOCATION);
     for (int i=0;i<4;i++) spill_area[STACK_PTR_ADDR_OFFSET +i] = 0;
     for (int i=0;i< (1<<LOG_SPLITTER_STACK_SIZE) ; i++) {
@@ -612,15 +907,16 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
     for (int i=0;i<N_TILES;i++) {
         dma_write(spill_area,
                 SCRATCHPAD_END_OFFSET,
-                ADDR_BASE_SPILL + i*TOTAL_SPILL_ALLOCATION);
+                spill_base + i*TOTAL_SPILL_ALLOCATION);
     }
+    stage_end(s);
     uint64_t cycles;
     int num_errors = 0;
 
-    uint32_t ocl_data = 0;
 
 
     // Stage 3: Global Initialization
+    s = stage_begin("ocl_config");
 
     // for debug logs (if enabled in config)
     FILE* fwtu = fopen("task_unit_log", "w");
@@ -637,8 +933,6 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
     FILE* fwrv_0 = fopen("riscv_log_0", "w");
     unsigned char* log_buffer = (unsigned char *)malloc(20000*64);
 
-    sleep(1);
-
 
     // OCL Initialization
 
@@ -666,7 +960,7 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
     assert(spill_size < (1<<SPILLQ_STAGES) );
     assert(tied_cap < (1<<LOG_TQ_SIZE) );
     assert(clean_threshold < (1<<TQ_STAGES) );
-    printf("Spill Alloc %08x %08x\n",ADDR_BASE_SPILL, TOTAL_SPILL_ALLOCATION);
+    printf("Spill Alloc %08lx %08x\n", spill_base, TOTAL_SPILL_ALLOCATION);
 
     //pci_poke(N_TILES, ID_GLOBAL, MEM_XBAR_NUM_CTRL, 4);
     if (ddr_throttle_factor > 1) {
@@ -696,13 +990,13 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
 
         // Spilling config
         pci_poke(i, ID_COAL_AND_SPLITTER, SPILL_ADDR_STACK_PTR ,
-                (ADDR_BASE_SPILL + i*TOTAL_SPILL_ALLOCATION) >> 6 );
+                (spill_base + i*TOTAL_SPILL_ALLOCATION) >> 6 );
         pci_poke(i, ID_COAL_AND_SPLITTER, SPILL_BASE_STACK ,
-                (ADDR_BASE_SPILL + i*TOTAL_SPILL_ALLOCATION + STACK_BASE_OFFSET) >> 6 );
+                (spill_base + i*TOTAL_SPILL_ALLOCATION + STACK_BASE_OFFSET) >> 6 );
         pci_poke(i, ID_COAL_AND_SPLITTER, SPILL_BASE_SCRATCHPAD ,
-                (ADDR_BASE_SPILL + i*TOTAL_SPILL_ALLOCATION + SCRATCHPAD_BASE_OFFSET) >> 6 );
+                (spill_base + i*TOTAL_SPILL_ALLOCATION + SCRATCHPAD_BASE_OFFSET) >> 6 );
         pci_poke(i, ID_COAL_AND_SPLITTER, SPILL_BASE_TASKS ,
-                (ADDR_BASE_SPILL + i*TOTAL_SPILL_ALLOCATION + SPILL_TASK_BASE_OFFSET) >> 6 );
+                (spill_base + i*TOTAL_SPILL_ALLOCATION + SPILL_TASK_BASE_OFFSET) >> 6 );
 
         pci_poke(i, ID_TSB, TSB_LOG_N_TILES        , active_tiles );
         pci_poke(i, ID_SERIALIZER, SERIALIZER_N_MAX_RUNNING_TASKS , max_threads );
@@ -742,7 +1036,6 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
         }
         pci_poke(i, ID_OCL_SLAVE, OCL_ACCESS_MEM_SET_MSB, 0 );
     }
-    usleep(20);
     pci_peek(0, ID_OCL_SLAVE, OCL_CUR_CYCLE_LSB, &startCycle);
     pci_peek(0, ID_OCL_SLAVE, OCL_CUR_CYCLE_LSB, &endCycle);
     printf("PCI latency %d cycles\n", endCycle - startCycle);
@@ -751,7 +1044,10 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
 
     if (endCycle == startCycle) return -1; // OCL_BUS is broken -> abort!!
 
+    stage_end(s);
+
     // Stage 4 : Application-specific initialization
+    s = stage_begin("initial_enqueue");
 
     pci_poke(0, ID_OCL_SLAVE, OCL_TASK_ENQ_TTYPE, 0 );
     pci_poke(0, ID_OCL_SLAVE, OCL_TASK_ENQ_ARG_WORD, 0 );
@@ -763,8 +1059,9 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
             for (int i=0;i<N_TILES;i++) {
                 pci_poke(i, 0, OCL_TASK_ENQ_TTYPE,  1);
             }
+            uint32_t* initlist = image_section(headers[7], headers[11]);
             for (int i=0;i<headers[11];i++) { // numI
-                unsigned char* ref_ptr = write_buffer + (headers[7] +i)*4;
+                unsigned char* ref_ptr = (unsigned char*) (initlist + i);
                 //printf("%d\n", *(ref_ptr+1));
                 uint32_t enq_object = (*(ref_ptr + 3)<<24)+
                     (*(ref_ptr + 2)<<16) +
@@ -778,6 +1075,7 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
 
                 printf("Enquing initial task %d\n", enq_object);
             }
+            free(initlist);
             break;
         case APP_SSSP:
             printf("APP_SSSP\n");
@@ -833,15 +1131,16 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
             break;
 
     }
+    stage_end(s);
     printf("Starting Applicaton\n");
 
     // Stage 5: Start Application
+    s = stage_begin("start");
 
     for (int i=0;i<N_TILES;i++) {
         // Number of remaining dequues
         pci_poke(i, ID_ALL_APP_CORES, CORE_N_DEQUEUES ,0xfffffff);
     }
-    usleep(2);
     pci_peek(0, ID_OCL_SLAVE, OCL_CUR_CYCLE_LSB, &startCycle);
     pci_peek(0, ID_OCL_SLAVE, OCL_CUR_CYCLE_LSB, &endCycle);
     printf("PCI latency %d cycles\n", endCycle - startCycle);
@@ -872,22 +1171,23 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
         pci_poke(i, ID_TASK_UNIT, TASK_UNIT_START, 1);
         pci_poke(i, ID_ALL_CORES, CORE_START, core_mask);
     }
-
-    usleep(2);
+    stage_end(s);
 
     printf("Waiting until app completes\n");
 
     // Stage 6: Wait until Application completes
+    s = stage_begin("wait");
 
-    ocl_data = 0;
    uint32_t* results;
+   dma_job_t* readback;
 
     int iters = 0;
 
-   time_t t1,t2;
-   t1 = time(NULL);
+   poll_t poll;
+   poll_begin(&poll);
+   bool completed = false;
+   uint32_t gvt;
    while(true) {
-       uint32_t gvt;
        if (NO_ROLLBACK) {
            pci_peek(0, ID_OCL_SLAVE, OCL_DONE, (uint32_t*) &gvt);
            //loop_debuggin_no_rollback(iters);
@@ -914,28 +1214,31 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
                    if (gvt != -1) done=false;
                }
            }
-           if (done) break;
+           if (done) {
+               completed = true;
+               break;
+           }
        }
        if (logging_on) {
 
-           log_ddr(pci_bar_handle, read_fd, fwddr, log_buffer, (N_TILES << 8) | ID_GLOBAL);
-           //log_axi(pci_bar_handle, read_fd, fwrw, log_buffer, ID_UNDO_LOG+1);
-           //log_axi(pci_bar_handle, read_fd, fwro, log_buffer, 1<<8 | ID_UNDO_LOG+1);
-           log_task_unit(pci_bar_handle, read_fd, fwtu, log_buffer, ID_TASK_UNIT);
+           log_ddr(fwddr, log_buffer, (N_TILES << 8) | ID_GLOBAL);
+           //log_axi(fwrw, log_buffer, ID_UNDO_LOG+1);
+           //log_axi(fwro, log_buffer, 1<<8 | ID_UNDO_LOG+1);
+           log_task_unit(fwtu, log_buffer, ID_TASK_UNIT);
            if (APP_ID == RISCV_ID) {
-              log_riscv(pci_bar_handle, read_fd, fwrv_0, log_buffer, 16);
+              log_riscv(fwrv_0, log_buffer, 16);
            } else if (USING_PIPELINED_TEMPLATE) {
-              log_ro_stage(pci_bar_handle, read_fd, fwro, log_buffer, ID_RO_STAGE);
-              log_rw_stage(pci_bar_handle, read_fd, fwrw, log_buffer, ID_RW_READ) ;
+              log_ro_stage(fwro, log_buffer, ID_RO_STAGE);
+              log_rw_stage(fwrw, log_buffer, ID_RW_READ) ;
            }
 
-           //log_cache(pci_bar_handle, read_fd, fwl2, log_buffer, ID_L2_RW);
-           //log_cache(pci_bar_handle, read_fd, fwl2ro, log_buffer, ID_L2_RO);
-           log_cq(pci_bar_handle, read_fd, fwcq, log_buffer, ID_CQ);
-           //log_coalescer(pci_bar_handle, read_fd, fwcoal, log_buffer, ID_COALESCER);
-           //log_splitter(pci_bar_handle, read_fd, fwsp, log_buffer, ID_SPLITTER);
-           log_serializer(pci_bar_handle, read_fd, fwser, log_buffer, ID_SERIALIZER);
-           //log_undo_log(pci_bar_handle, read_fd, fwundo, log_buffer, ID_UNDO_LOG);
+           //log_cache(fwl2, log_buffer, ID_L2_RW);
+           //log_cache(fwl2ro, log_buffer, ID_L2_RO);
+           log_cq(fwcq, log_buffer, ID_CQ);
+           //log_coalescer(fwcoal, log_buffer, ID_COALESCER);
+           //log_splitter(fwsp, log_buffer, ID_SPLITTER);
+           log_serializer(fwser, log_buffer, ID_SERIALIZER);
+           //log_undo_log(fwundo, log_buffer, ID_UNDO_LOG);
            fflush(fwtu); fflush(fwro); fflush(fwcq); fflush(fwl2); fflush(fwrv_0);
            fflush(fwl2ro); fflush(fwcoal); fflush(fwsp);
            usleep(200);
@@ -945,38 +1248,53 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
            loop_debuggin_spec(iters);
        }
        //loop_debuggin_no_rollback(iters);
-       usleep(1000);
        iters++;
-       t2 = time(NULL);
-       double time_s = (double)(t2-t1);
-       if (time_s > 30) exit(0);
-
+       if (!poll_next(&poll, run_timeout_s)) break;
    }
-       double time_s = (double) (t2-t1) ;
+   double time_s = elapsed_s(&poll.start);
+   stage_end(s);
    printf("time_s %f\n", time_s);
    // disable new dequeues from cores; for accurate counting of no tasks stalls
    pci_poke(0, ID_ALL_APP_CORES, CORE_N_DEQUEUES ,0x0);
    for (int i=0;i<N_TILES;i++) {
        pci_poke(i, ID_ALL_CORES, CORE_START, 0);
    }
-   usleep(2800);
-   usleep(300000);
+   if (!completed) {
+       printf("ERROR: the app did not complete in %.1f s (gvt %x)\n",
+               run_timeout_s, gvt);
+       return 1;
+   }
+   // let the tasks in flight drain: until no tile dequeues any more
+   s = stage_begin("drain");
+   uint32_t n_deq = 0;
+   poll_begin(&poll);
+   do {
+       uint32_t last = n_deq;
+       n_deq = 0;
+       for (int i=0;i<N_TILES;i++) {
+           uint32_t n;
+           pci_peek(i, ID_TASK_UNIT, TASK_UNIT_STAT_N_DEQ_TASK, &n);
+           n_deq += n;
+       }
+       if (poll.n > 0 && n_deq == last) break;
+   } while (poll_next(&poll, 1));
+   stage_end(s);
    if (logging_on) {
-       log_ddr(pci_bar_handle, read_fd, fwddr, log_buffer,
+       log_ddr(fwddr, log_buffer,
                    (N_TILES << 8) | ID_GLOBAL);
-       log_task_unit(pci_bar_handle, read_fd, fwtu, log_buffer, ID_TASK_UNIT);
-       //log_ro_stage(pci_bar_handle, read_fd, fwro, log_buffer, ID_RO_STAGE);
-       //log_rw_stage(pci_bar_handle, read_fd, fwrw, log_buffer, ID_RW_READ);
+       log_task_unit(fwtu, log_buffer, ID_TASK_UNIT);
+       //log_ro_stage(fwro, log_buffer, ID_RO_STAGE);
+       //log_rw_stage(fwrw, log_buffer, ID_RW_READ);
        if (APP_ID == RISCV_ID) {
-          log_riscv(pci_bar_handle, read_fd, fwrv_0, log_buffer, 16);
+          log_riscv(fwrv_0, log_buffer, 16);
        } else if (USING_PIPELINED_TEMPLATE) {
-          log_ro_stage(pci_bar_handle, read_fd, fwro, log_buffer, ID_RO_STAGE);
-          log_rw_stage(pci_bar_handle, read_fd, fwrw, log_buffer, ID_RW_READ) ;
+          log_ro_stage(fwro, log_buffer, ID_RO_STAGE);
+          log_rw_stage(fwrw, log_buffer, ID_RW_READ) ;
        }
-       log_cache(pci_bar_handle, read_fd, fwl2, log_buffer, ID_L2_RW);
-       log_cache(pci_bar_handle, read_fd, fwl2ro, log_buffer, ID_L2_RO);
-       log_cq(pci_bar_handle, read_fd, fwcq, log_buffer, ID_CQ);
-       log_serializer(pci_bar_handle, read_fd, fwser, log_buffer, ID_SERIALIZER);
+       log_cache(fwl2, log_buffer, ID_L2_RW);
+       log_cache(fwl2ro, log_buffer, ID_L2_RO);
+       log_cq(fwcq, log_buffer, ID_CQ);
+       log_serializer(fwser, log_buffer, ID_SERIALIZER);
 
        fflush(fwl2); fflush(fwl2ro); fflush(fwrw); fflush(fwro); fflush(fwser);
    }
@@ -992,15 +1310,8 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
        }
    }
 
-   printf("Completed, flushing cache..\n");
-   for (int i=0;i<N_TILES;i++) {
-      pci_poke(i, ID_L2_RW, L2_FLUSH , 1 );
-      usleep(100000);
-      pci_poke(i, ID_L2_RO, L2_FLUSH , 1 );
-      usleep(100000);
-   }
-
    // Stage 7: Application completed. Read counters for analysis.
+   s = stage_begin("stats");
 
    if (!NO_ROLLBACK) {
        cq_stats(0, cycles);
@@ -1058,7 +1369,17 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
            sum_l2_evictions += l2_evictions;
        }
    }
-   printf("Task Unit Ops %d, num_edges %d\n", task_unit_ops, numE);
+
+   // All the caches flush in parallel, while the rest of the stats are
+   // printed. They start after their counters are read since the flush
+   // write-backs count as evictions. L2_FLUSH reads 1 until it is done.
+   printf("Completed, flushing cache..\n");
+   uint32_t s_flush = stage_begin("flush");
+   for (int i=0;i<N_TILES;i++) {
+      pci_poke(i, ID_L2_RW, L2_FLUSH , 1 );
+      pci_poke(i, ID_L2_RO, L2_FLUSH , 1 );
+   }
+   printf("Task Unit Ops %d, num_edges %lu\n", task_unit_ops, numE);
 
 
    double time_ms = (cycles + 0.0) * 8/1e6;
@@ -1086,25 +1407,25 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
            (sum_l2_read_hit + sum_l2_read_miss + sum_l2_write_miss + sum_l2_write_hit+0.0)/
              total_tasks);
    printf("Task Unit contention %5.2f%%\n", task_unit_contention);
+   stage_end(s);
+   run_cycles = cycles;
+   run_tasks = total_tasks;
 
 
     // Stage 8: application specific verification
 
-   printf("Flush completed, reading results..\n");
-   ocl_data = 1;
-   uint32_t iter=0;
-   while(ocl_data==1) {
-       if (iter++ > 10) {
-           printf("Flush did not complete.. Reading anyway\n");
-           break;
-       }
-       for (int i=0;i<N_TILES;i++) {
-           pci_peek(i, ID_L2_RW, L2_FLUSH, &ocl_data);
-           if (ocl_data == 1) break;
-           usleep(1000);
-       }
+   bool flushed = true;
+   for (int i=0;i<N_TILES;i++) {
+       flushed &= pci_poll(i, ID_L2_RW, L2_FLUSH, 0, 1);
+       flushed &= pci_poll(i, ID_L2_RO, L2_FLUSH, 0, 1);
+   }
+   stage_end(s_flush);
+   if (flushed) {
+       printf("Flush completed, reading results..\n");
+   } else {
+       printf("Flush did not complete.. Reading anyway\n");
    }
-       log_ddr(pci_bar_handle, read_fd, fwddr, log_buffer,
+       log_ddr(fwddr, log_buffer,
                    (N_TILES << 8) | ID_GLOBAL);
 
 
@@ -1115,14 +1436,17 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
 
    FILE* mf_state = fopen("maxflow_state", "w");
    FILE* fastar = fopen("astar_verif", "w");
+   // readback is timed to its last byte, inside verify
+   s = stage_begin("verify");
+   uint32_t s_readback = stage_begin("readback");
    switch (app) {
        case APP_DES:
            results = (uint32_t*) malloc(4*(numV+16));
-           for (int i=0;i<numV/16 +1;i++){
-               fpga_dma_burst_read(read_fd, (uint8_t*) (results + i*16), 16*4, 64 + i*64);
-           }
+           readback = dma_start(false, results, (numV/16 + 1) * 64ull, results_addr);
+           uint32_t* des_ref = image_section(headers[6], headers[12]);
+           stages[s_readback].secs = dma_finish(readback, "Readback");
            for (int i=0;i<headers[12];i++) {  // numOutputs
-               unsigned char* ref_ptr = write_buffer + (headers[6] +i)*4;
+               unsigned char* ref_ptr = (unsigned char*) (des_ref + i);
                //printf("%d\n", *(ref_ptr+1));
                uint32_t ref_data = (*(ref_ptr + 3)<<24)+
                    (*(ref_ptr + 2)<<16) +
@@ -1153,16 +1477,17 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
                       );
            }
            fclose(fdes);
+           free(des_ref);
            break;
        case APP_SSSP:
        case APP_ASTAR:
            results = (uint32_t*) malloc(4*(numV+16));
-           for (int i=0;i<numV/16 +1;i++){
-               fpga_dma_burst_read(read_fd, (uint8_t*) (results + i*16), 16*4, 64 + i*64);
-           }
+           // verified as it arrives
+           readback = dma_start(false, results, (numV/16 + 1) * 64ull, results_addr);
+           uint32_t* dist_ref = (app != APP_ASTAR) ?
+               image_section(image_header(6), numV) : image_section(headers[9], numV);
            for (int i=0;i<numV;i++) {
-               int ref_ptr_loc = (app != APP_ASTAR) ? 6 : 9;
-               unsigned char* ref_ptr = write_buffer + (headers[ref_ptr_loc] +i)*4;
+               unsigned char* ref_ptr = (unsigned char*) (dist_ref + i);
                //printf("%d\n", *(ref_ptr+1));
                uint32_t ref_dist = (*(ref_ptr + 3)<<24)+
                    (*(ref_ptr + 2)<<16) +
@@ -1171,13 +1496,14 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
                //printf("%d %d\n", i ,numV);
                if ((app==APP_ASTAR) && (ref_dist == -1)) continue;
 
-               uint64_t addr = 64 + i * 4;
+               uint64_t addr = results_addr + i * 4ull;
                if ((addr & 0xffffffff) ==0) {
                    uint32_t msb = addr >> 32;
                    printf("setting msb %d\n", msb);
                    pci_poke(0, ID_OCL_SLAVE, OCL_ACCESS_MEM_SET_MSB        , msb );
                }
                uint32_t act_dist;
+               dma_wait(readback, (i + 1) * 4ull);
                act_dist = results[i];
                bool error;
                if (app == APP_ASTAR)
@@ -1210,11 +1536,13 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
                    }
                }
            }
+           stages[s_readback].secs = dma_finish(readback, "Readback");
            printf("Total Errors %d / %d\n", num_errors, ref_count);
            if (num_errors > 0) {
                printf("Earliest Fail %d (%x) / %d\n",
                        astar_low_fail_node, astar_low_fail_node, astar_low_fail_ref);
            }
+           free(dist_ref);
            if (app == APP_SSSP) {
                /*
                 FILE* fs = fopen("sssp_verif", "w");
@@ -1234,12 +1562,16 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
            break;
        case APP_COLOR:
            results = (uint32_t*) malloc(16*(numV+100));
-           for (int i=0;i<numV/16 + 1;i++){
-               fpga_dma_burst_read(read_fd, (uint8_t*) (results + i*16*4),
-                       16*16, 64 + i*16*16);
-           }
+           readback = dma_start(false, results, (numV/16 + 1) * 256ull, results_addr);
            color_node_prop_t* c_nodes =
-               (color_node_prop_t *) (results);// (write_buffer + headers[5]*4);
+               (color_node_prop_t *) (results);
+           // --varint-edges lists are delta coded and eo_begin is a byte
+           // offset into them: only the colors are checked then
+           bool varint_edges = (image.header[10] == EDGE_FORMAT_VARINT);
+           uint32_t* csr_neighbors = varint_edges ? NULL :
+               image_section(image_header(4), numE);
+           uint32_t* csr_ref_color = image_section(image_header(6), numV);
+           stages[s_readback].secs = dma_finish(readback, "Readback");
            // verification
 
            FILE* fc = fopen("color_verif", "w");
@@ -1260,7 +1592,7 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
                         csr_ref_color[i]);
                bool error = (i_color != csr_ref_color[i]);
                uint32_t join_cnt = 0;
-               for (int j=eo_begin;j<eo_end;j++) {
+               for (int j=eo_begin;j<eo_end && !varint_edges;j++) {
                     uint32_t n = csr_neighbors[j];
                     uint32_t n_deg = c_nodes[n].degree;
                     uint32_t n_color = c_nodes[n].color;
@@ -1278,17 +1610,18 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
 
            }
            printf("Total Errors %d / %d\n", num_errors, numV);
+           free(csr_neighbors);
+           free(csr_ref_color);
            break;
       case APP_MAXFLOW:
            results = (uint32_t*) malloc(64*(numV+100));
-           for (int i=0;i<numV/16 + 1;i++){
-               fpga_dma_burst_read(read_fd, (uint8_t*) (results + i*16*16),
-                       16*64, 64 + i*64*16);
-           }
+           readback = dma_start(false, results, (numV/16 + 1) * 1024ull, results_addr);
+           uint32_t* csr_offset = image_section(headers[3], numV + 1);
            maxflow_edge_prop_t* edges =
-               (maxflow_edge_prop_t *) (write_buffer + headers[4]*4);
+               (maxflow_edge_prop_t *) image_section(headers[4], numE * 2);
+           stages[s_readback].secs = dma_finish(readback, "Readback");
            maxflow_node_prop_t* nodes =
-               (maxflow_node_prop_t *) (results);// (write_buffer + headers[5]*4);
+               (maxflow_node_prop_t *) (results);
            for (int i=0;i <numV;i++) {
                fprintf(mf_state, "node:%3d excess:%3d height:%3d %s\n",
                        i, nodes[i].excess, nodes[i].height,
@@ -1315,7 +1648,19 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
 
            }
            printf("node:%3d excess:%3d height:%3d\n", headers[9], nodes[headers[9]].excess, nodes[headers[9]].height);
+           // ground truth: {max flow, sink excess}. (All 1s in inputs
+           // generated before graph_gen computed it.)
+           uint32_t* ref_flow = image_section(headers[6], 2);
+           if (ref_flow[0] != 0xFFFFFFFF) {
+               bool error = (nodes[headers[9]].excess != ref_flow[1]);
+               if (error) num_errors++;
+               printf("max flow:%d, ref:%d, %s\n", nodes[headers[9]].excess,
+                       ref_flow[0], error ? "FAIL" : "MATCH");
+           }
            fflush(mf_state);
+           free(csr_offset);
+           free(edges);
+           free(ref_flow);
            break;
       case APP_SILO:
            printf("Reading silo_ref\n");
@@ -1327,11 +1672,11 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
            uint32_t* ref = (uint32_t *) malloc(lSizeRef);
            fread( (void*) ref, 1, lSizeRef, fref);
 
-           results = (uint32_t*) malloc(lSizeRef + 100);
-           for (int i=0;i<lSizeRef/1024 + 1;i++){
-               fpga_dma_burst_read(read_fd, (uint8_t*) (results + i*16*16),
-                       16*64, i*64*16);
-           }
+           results = (uint32_t*) malloc(lSizeRef + 1024);
+           stages[s_readback].start_s = elapsed_s(&run_start);
+           stages[s_readback].secs = dma_finish(
+                   dma_start(false, results, (lSizeRef/1024 + 1) * 1024ull, 0),
+                   "Readback");
            for (int i=0;i<lSizeRef/4;i++) {
 
                 if (results[i] != ref[i]){
@@ -1346,10 +1691,10 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
            break;
 
    }
+   stage_end(s);
+   run_errors = num_errors;
 
-   if (write_buffer != NULL) {
-       free(write_buffer);
-   }
+   image_close();
    if (read_buffer != NULL) {
        free(read_buffer);
    }
@@ -1357,6 +1702,7 @@ int test_chronos(int slot_id, int pf_id, int bar_id, FILE* fg, int app) {
 }
 
 
+#ifndef CONFIG_EMU_ONLY
 int dma_example(int slot_id) {
     // Small example to test DMA
     int write_fd, read_fd, rc;
@@ -1435,6 +1781,7 @@ out:
     /* if there is an error code, exit with status 1 */
     return (rc != 0 ? 1 : 0);
 }
+#endif
 
 void loop_debuggin_no_rollback(uint32_t iters){
 
@@ -29,13 +29,23 @@ uint32_t last_gvt_tb[] = {0, 0, 0, 0};
 
 uint32_t arid_cycle[65536] = {0};
 
-int log_task_unit(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID_TASK_UNIT) {
+// Reads len bytes of a debug log at addr through the device, in the
+// pread-style loops below: returns the number of bytes read
+static int log_read(unsigned char* buf, uint32_t len, uint64_t addr) {
+   if (device->dma_read(0, buf, len, addr) != 0) {
+      printf("ERROR: could not read %u bytes of log at %lx\n", len, addr);
+      exit(1);
+   }
+   return len;
+}
+
+int log_task_unit(FILE* fw, unsigned char* log_buffer, uint32_t ID_TASK_UNIT) {
 
    uint32_t log_size;
    uint32_t gvt;
    uint32_t ID_CQ = ID_TASK_UNIT + 5; // Hack
-   fpga_pci_peek(pci_bar_handle,  (ID_TASK_UNIT << 8) + (DEBUG_CAPACITY), &log_size );
-   fpga_pci_peek(pci_bar_handle,  (ID_CQ << 8) + (CQ_GVT_TS), &gvt );
+   device->peek((ID_TASK_UNIT << 8) + (DEBUG_CAPACITY), &log_size );
+   device->peek((ID_CQ << 8) + (CQ_GVT_TS), &gvt );
    printf("Task unit log size %d gvt %d\n", log_size, gvt);
    if (log_size > 17000) return 1;
    // if (log_size > 100) log_size -= 100;
@@ -47,7 +57,7 @@ int log_task_unit(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned ch
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID_TASK_UNIT << 20);
    while (read_offset < read_len) {
-      rc = pread(fd,
+      rc = log_read(
             log_buffer,// + read_offset,
             // keep Tx size under 64*64 to prevent shell timeouts
             (read_len - read_offset) > 3200 ? 3200 : (read_len-read_offset),
@@ -257,12 +267,12 @@ void write_task_unit_log(unsigned char* log_buffer, FILE* fw, uint32_t log_size,
    }
 
 }
-int log_undo_log(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID) {
+int log_undo_log(FILE* fw, unsigned char* log_buffer, uint32_t ID) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (ID << 8) + (DEBUG_CAPACITY), &log_size );
-   fpga_pci_peek(pci_bar_handle,  (ID << 8) + (CQ_GVT_TS), &gvt );
+   device->peek((ID << 8) + (DEBUG_CAPACITY), &log_size );
+   device->peek((ID << 8) + (CQ_GVT_TS), &gvt );
    printf("Undo log size %d gvt %d\n", log_size, gvt);
    if (log_size > 17000) return 1;
    // if (log_size > 100) log_size -= 100;
@@ -274,7 +284,7 @@ int log_undo_log(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned cha
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID << 20);
    while (read_offset < read_len) {
-       rc = pread(fd,
+       rc = log_read(
                log_buffer,// + read_offset,
                // keep Tx size under 64*64 to prevent shell timeouts
                (read_len - read_offset) > 3200 ? 3200 : (read_len-read_offset),
@@ -360,10 +370,10 @@ int log_undo_log(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned cha
    return 0;
 }
 
-int log_cache(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID_L2) {
+int log_cache(FILE* fw, unsigned char* log_buffer, uint32_t ID_L2) {
 
    uint32_t log_size;
-   fpga_pci_peek(pci_bar_handle, (ID_L2 << 8) + (DEBUG_CAPACITY), &log_size );
+   device->peek((ID_L2 << 8) + (DEBUG_CAPACITY), &log_size );
    printf("Cache log size %d\n", log_size);
    if (log_size > 17000) {
        if (log_size <34000) log_size -= 16384;
@@ -375,7 +385,7 @@ int log_cache(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID_L2 << 20);
    while (read_offset < read_len) {
-      rc = pread(fd,
+      rc = log_read(
             log_buffer,// + read_offset,
             (read_len - read_offset) > 512 ? 512 :(read_len - read_offset),
             cl_addr);
@@ -470,10 +480,10 @@ int log_cache(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*
 last_coal_id =-1;
 coal_id_seq =0;
 
-int log_splitter(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID_SPLITTER) {
+int log_splitter(FILE* fw, unsigned char* log_buffer, uint32_t ID_SPLITTER) {
 
     uint32_t log_size;
-    fpga_pci_peek(pci_bar_handle, (ID_SPLITTER << 8) + (DEBUG_CAPACITY), &log_size );
+    device->peek((ID_SPLITTER << 8) + (DEBUG_CAPACITY), &log_size );
     printf("Splitter log size %d\n", log_size);
     if (log_size > 17000) return 1;
 
@@ -483,7 +493,7 @@ int log_splitter(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned cha
     unsigned int rc;
     uint64_t cl_addr = (1L<<36) + (ID_SPLITTER << 20);
     while (read_offset < read_len) {
-        rc = pread(fd,
+        rc = log_read(
                 log_buffer,// + read_offset,
                 (read_len - read_offset) > 512 ? 512 : (read_len-read_offset),
                 cl_addr);
@@ -532,10 +542,10 @@ int log_splitter(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned cha
     return 0;
 }
 
-int log_coalescer(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID_COALESCER) {
+int log_coalescer(FILE* fw, unsigned char* log_buffer, uint32_t ID_COALESCER) {
 
     uint32_t log_size;
-    fpga_pci_peek(pci_bar_handle, (ID_COALESCER << 8) + (DEBUG_CAPACITY), &log_size );
+    device->peek((ID_COALESCER << 8) + (DEBUG_CAPACITY), &log_size );
     printf("coalescer log size %d\n", log_size);
     if (log_size > 17000) return 1;
 
@@ -544,7 +554,7 @@ int log_coalescer(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned ch
     unsigned int rc;
     uint64_t cl_addr = (1L<<36) + (ID_COALESCER << 20);
     while (read_offset < read_len) {
-        rc = pread(fd,
+        rc = log_read(
                 log_buffer,// + read_offset,
                 (read_len - read_offset) > 512 ? 512 : (read_len-read_offset),
                 cl_addr);
@@ -607,12 +617,12 @@ int log_coalescer(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned ch
     return 0;
 }
 
-int log_cq(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID_CQ) {
+int log_cq(FILE* fw, unsigned char* log_buffer, uint32_t ID_CQ) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (ID_CQ << 8) + (DEBUG_CAPACITY), &log_size );
-   fpga_pci_peek(pci_bar_handle,  (ID_CQ << 8) + (CQ_GVT_TS), &gvt );
+   device->peek((ID_CQ << 8) + (DEBUG_CAPACITY), &log_size );
+   device->peek((ID_CQ << 8) + (CQ_GVT_TS), &gvt );
    printf("CQ log size %d gvt %d\n", log_size, gvt);
    if (log_size > 17000) {
        if (log_size <34000) {
@@ -630,7 +640,7 @@ int log_cq(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID_CQ << 20);
    while (read_offset < read_len) {
-      rc = pread(fd,
+      rc = log_read(
             log_buffer + read_offset,
             // keep Tx size under 64*64 to prevent shell timeouts
             (read_len - read_offset) > 512 ? 512 : (read_len-read_offset),
@@ -755,11 +765,11 @@ int log_cq(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log
 }
 
 uint32_t last_awid=0;
-int log_ddr(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID) {
+int log_ddr(FILE* fw, unsigned char* log_buffer, uint32_t ID) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (N_TILES << 16) | (ID_GLOBAL << 8) | (DEBUG_CAPACITY), &log_size );
+   device->peek((N_TILES << 16) | (ID_GLOBAL << 8) | (DEBUG_CAPACITY), &log_size );
    printf("DDR log size %d gvt %d\n", log_size, 0);
    fprintf(fw, "DDR log size %d gvt %d\n", log_size, 0);
    if (log_size > 17000) return 1;
@@ -772,7 +782,7 @@ int log_ddr(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* lo
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID << 20);
    while (read_offset < read_len) {
-       rc = pread(fd,
+       rc = log_read(
                log_buffer,// + read_offset,
                // keep Tx size under 64*64 to prevent shell timeouts
                (read_len - read_offset) > 512 ? 512 : (read_len-read_offset),
@@ -953,11 +963,11 @@ int log_ddr(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* lo
    return 0;
 }
 
-int log_axi(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID) {
+int log_axi(FILE* fw, unsigned char* log_buffer, uint32_t ID) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (ID << 8) | (DEBUG_CAPACITY), &log_size );
+   device->peek((ID << 8) | (DEBUG_CAPACITY), &log_size );
    printf("AXI log size %d gvt %d\n", log_size, 0);
    fprintf(fw, "AXI log size %d gvt %d\n", log_size, 0);
    if (log_size > 17000) return 1;
@@ -970,7 +980,7 @@ int log_axi(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* lo
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID << 20);
    while (read_offset < read_len) {
-       rc = pread(fd,
+       rc = log_read(
                log_buffer,// + read_offset,
                // keep Tx size under 64*64 to prevent shell timeouts
                (read_len - read_offset) > 512 ? 512 : (read_len-read_offset),
@@ -1140,12 +1150,12 @@ int log_axi(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* lo
    return 0;
 }
 
-int log_rw_stage(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID) {
+int log_rw_stage(FILE* fw, unsigned char* log_buffer, uint32_t ID) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (ID << 8) + (DEBUG_CAPACITY), &log_size );
-   //fpga_pci_peek(pci_bar_handle,  (ID << 8) + (CQ_GVT_TS), &gvt );
+   device->peek((ID << 8) + (DEBUG_CAPACITY), &log_size );
+   //device->peek((ID << 8) + (CQ_GVT_TS), &gvt );
    printf("RW Stage log size %d \n", log_size);
    if (log_size > 17000) return 1;
    // if (log_size > 100) log_size -= 100;
@@ -1157,7 +1167,7 @@ int log_rw_stage(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned cha
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID << 20);
    while (read_offset < read_len) {
-       rc = pread(fd,
+       rc = log_read(
                log_buffer,// + read_offset,
                // keep Tx size under 64*64 to prevent shell timeouts
                (read_len - read_offset) > 3200 ? 3200 : (read_len-read_offset),
@@ -1260,12 +1270,12 @@ int log_rw_stage(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned cha
 }
 
 
-int log_ro_stage(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID) {
+int log_ro_stage(FILE* fw, unsigned char* log_buffer, uint32_t ID) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (ID << 8) + (DEBUG_CAPACITY), &log_size );
-   //fpga_pci_peek(pci_bar_handle,  (ID << 8) + (CQ_GVT_TS), &gvt );
+   device->peek((ID << 8) + (DEBUG_CAPACITY), &log_size );
+   //device->peek((ID << 8) + (CQ_GVT_TS), &gvt );
    printf("RO Stage log size %d \n", log_size);
    if (log_size > 17000) return 1;
    // if (log_size > 100) log_size -= 100;
@@ -1277,7 +1287,7 @@ int log_ro_stage(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned cha
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID << 20);
    while (read_offset < read_len) {
-       rc = pread(fd,
+       rc = log_read(
                log_buffer,// + read_offset,
                // keep Tx size under 64*64 to prevent shell timeouts
                (read_len - read_offset) > 3200 ? 3200 : (read_len-read_offset),
@@ -1401,12 +1411,12 @@ int log_ro_stage(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned cha
    return 0;
 }
 
-int log_serializer(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID) {
+int log_serializer(FILE* fw, unsigned char* log_buffer, uint32_t ID) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (ID << 8) + (DEBUG_CAPACITY), &log_size );
-   //fpga_pci_peek(pci_bar_handle,  (ID << 8) + (CQ_GVT_TS), &gvt );
+   device->peek((ID << 8) + (DEBUG_CAPACITY), &log_size );
+   //device->peek((ID << 8) + (CQ_GVT_TS), &gvt );
    printf("Serializer log size %d \n", log_size);
    if (log_size > 17000) return 1;
    // if (log_size > 100) log_size -= 100;
@@ -1418,7 +1428,7 @@ int log_serializer(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned c
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID << 20);
    while (read_offset < read_len) {
-       rc = pread(fd,
+       rc = log_read(
                log_buffer,// + read_offset,
                // keep Tx size under 64*64 to prevent shell timeouts
                (read_len - read_offset) > 3200 ? 3200 : (read_len-read_offset),
@@ -1503,12 +1513,12 @@ int log_serializer(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned c
    return 0;
 }
 
-int log_riscv(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID_CORE) {
+int log_riscv(FILE* fw, unsigned char* log_buffer, uint32_t ID_CORE) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (ID_CORE << 8) + (DEBUG_CAPACITY), &log_size );
-   fpga_pci_peek(pci_bar_handle,  (ID_CORE << 8) + (CQ_GVT_TS), &gvt );
+   device->peek((ID_CORE << 8) + (DEBUG_CAPACITY), &log_size );
+   device->peek((ID_CORE << 8) + (CQ_GVT_TS), &gvt );
    printf("Risc log size %d gvt %d\n", log_size, gvt);
    if (log_size > 17000) return 1;
    // if (log_size > 100) log_size -= 100;
@@ -1520,7 +1530,7 @@ int log_riscv(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char*
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID_CORE << 20);
    while (read_offset < read_len) {
-      rc = pread(fd,
+      rc = log_read(
             log_buffer,// + read_offset,
             // keep Tx size under 64*64 to prevent shell timeouts
             (read_len - read_offset) > 3200 ? 3200 : (read_len-read_offset),
@@ -1946,11 +1956,11 @@ void core_stats(uint32_t tile, uint32_t tot_cycles) {
     */
 }
 
-int log_pci(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* log_buffer, uint32_t ID) {
+int log_pci(FILE* fw, unsigned char* log_buffer, uint32_t ID) {
 
    uint32_t log_size;
    uint32_t gvt;
-   fpga_pci_peek(pci_bar_handle,  (ID << 8) + (DEBUG_CAPACITY), &log_size );
+   device->peek((ID << 8) + (DEBUG_CAPACITY), &log_size );
    printf("PCI log size %d %x \n", log_size, ID);
    if (log_size > 17000) return 1;
    // if (log_size > 100) log_size -= 100;
@@ -1962,7 +1972,7 @@ int log_pci(pci_bar_handle_t pci_bar_handle, int fd, FILE* fw, unsigned char* lo
    unsigned int rc;
    uint64_t cl_addr = (1L<<36) + (ID << 20);
    while (read_offset < read_len) {
-       rc = pread(fd,
+       rc = log_read(
                log_buffer,// + read_offset,
                // keep Tx size under 64*64 to prevent shell timeouts
                (read_len - read_offset) > 3200 ? 3200 : (read_len-read_offset),
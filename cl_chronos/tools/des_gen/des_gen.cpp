@@ -0,0 +1,302 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compiles a netlist into the des app's memory image (the layout
+// des_format.py produced), with ground truth from the reference simulator.
+//
+// Header (in words):
+//  1 numV, 2 numE, 3 BASE_EDGE_OFFSET, 4 BASE_NEIGHBORS, 5 BASE_DIST,
+//  6 BASE_GROUND_TRUTH, 7 BASE_INITLIST_VID, 8 BASE_INITLIST_EDGE_OFFSET,
+//  9 BASE_INITLIST, 10 BASE_END, 11 numI, 12 numO
+// gate_state = out[25:24] in0[23:22] in1[21:20] type[19:16] delay[15:0],
+//   initially out = X and both inputs 0
+// neighbor = dest << 1 | port
+// initlist entry = value << 24 | time
+// ground truth = vid << 16 | value, per output
+
+#include "des_gen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+bool write_hex = false;
+bool levelize = false;
+bool seq_ts = true;
+
+inline uint32_t size_of_field(uint32_t items) {
+   return (items + 15) / 16 * 16;
+}
+
+std::vector<uint32_t> Compile(const Netlist& net) {
+   uint32_t numV = net.gates.size();
+   uint32_t numI = net.numI;
+   uint32_t numO = net.outputs.size();
+
+   // fanout lists, in order of the sinks
+   std::vector<uint32_t> offset(numV + 1, 0);
+   for (const Gate& g : net.gates) {
+      for (int p = 0; p < 2; p++) {
+         if (g.in[p] != NO_NET) offset[g.in[p] + 1]++;
+      }
+   }
+   uint32_t max_fanout = 0;
+   for (uint32_t i = 0; i < numV; i++) {
+      max_fanout = std::max(max_fanout, offset[i+1]);
+      offset[i+1] += offset[i];
+   }
+   uint32_t numE = offset[numV];
+   std::vector<uint32_t> neighbors(numE);
+   std::vector<uint32_t> cursor(offset.begin(), offset.end() - 1);
+   for (uint32_t i = 0; i < numV; i++) {
+      for (uint32_t p = 0; p < 2; p++) {
+         uint32_t src = net.gates[i].in[p];
+         if (src != NO_NET) neighbors[cursor[src]++] = i << 1 | p;
+      }
+   }
+   uint32_t numInit = 0;
+   for (auto& il : net.initlist) numInit += il.size();
+
+   uint32_t SIZE_DIST = size_of_field(numV);
+   uint32_t SIZE_EDGE_OFFSET = size_of_field(numV + 1);
+   uint32_t SIZE_NEIGHBORS = size_of_field(numE);
+   uint32_t SIZE_INITLIST_EDGEOFFSET = size_of_field(numI + 1);
+   uint32_t SIZE_INITLIST = size_of_field(numInit);
+   uint32_t SIZE_GROUND_TRUTH = size_of_field(numO);
+
+   uint32_t BASE_DIST = 16;
+   uint32_t BASE_EDGE_OFFSET = BASE_DIST + SIZE_DIST;
+   uint32_t BASE_NEIGHBORS = BASE_EDGE_OFFSET + SIZE_EDGE_OFFSET;
+   uint32_t BASE_INITLIST_VID = BASE_NEIGHBORS + SIZE_NEIGHBORS;
+   uint32_t BASE_INITLIST_EDGE_OFFSET = BASE_INITLIST_VID + SIZE_INITLIST_EDGEOFFSET;
+   uint32_t BASE_INITLIST = BASE_INITLIST_EDGE_OFFSET + SIZE_INITLIST_EDGEOFFSET;
+   uint32_t BASE_GROUND_TRUTH = BASE_INITLIST + SIZE_INITLIST;
+   uint32_t BASE_END = BASE_GROUND_TRUTH + SIZE_GROUND_TRUTH;
+
+   std::vector<uint32_t> data(BASE_END, 0);
+   data[0] = MAGIC_OP;
+   data[1] = numV;
+   data[2] = numE;
+   data[3] = BASE_EDGE_OFFSET;
+   data[4] = BASE_NEIGHBORS;
+   data[5] = BASE_DIST;
+   data[6] = BASE_GROUND_TRUTH;
+   data[7] = BASE_INITLIST_VID;
+   data[8] = BASE_INITLIST_EDGE_OFFSET;
+   data[9] = BASE_INITLIST;
+   data[10] = BASE_END;
+   data[11] = numI;
+   data[12] = numO;
+
+   for (uint32_t i = 0; i < numV; i++) {
+      const Gate& g = net.gates[i];
+      data[BASE_DIST + i] = LOGIC_X << 24 | g.type << 16 | g.delay;
+      data[BASE_EDGE_OFFSET + i] = offset[i];
+   }
+   data[BASE_EDGE_OFFSET + numV] = numE;
+   for (uint32_t i = 0; i < numE; i++) data[BASE_NEIGHBORS + i] = neighbors[i];
+
+   uint32_t n = 0;
+   for (uint32_t vid = 0; vid < numI; vid++) {
+      data[BASE_INITLIST_VID + vid] = vid;
+      data[BASE_INITLIST_EDGE_OFFSET + vid] = n;
+      for (const InitEvent& e : net.initlist[vid]) {
+         if (e.time > 0xffffff || e.val > LOGIC_Z) {
+            printf("ERROR: initlist event (%u, %u) of %s out of range\n",
+                  e.time, e.val, net.gates[vid].name.c_str());
+            exit(1);
+         }
+         data[BASE_INITLIST + n++] = e.val << 24 | e.time;
+      }
+   }
+   data[BASE_INITLIST_EDGE_OFFSET + numI] = n;
+
+   printf("numV %u numE %u numI %u numO %u\n", numV, numE, numI, numO);
+   printf("Initlist size %u, max fanout %u\n", numInit, max_fanout);
+   for (int i = 0; i < 13; i++) printf("header %d: %d\n", i, data[i]);
+   return data;
+}
+
+// Ground truth: the outputs' values after simulation. Once a gate's 6-bit
+// sequence number wraps, the riscv app's timestamps no longer order its
+// events, and the outputs depend on how Chronos orders equal timestamps;
+// such a circuit has no ground truth, so no image is written.
+void FillGroundTruth(const Netlist& net, std::vector<uint32_t>& data) {
+   SimStats stats;
+   std::vector<uint32_t> state = Simulate(data.data(), seq_ts, &stats);
+   printf("Simulated %lu events (max pending %lu), last event at time %u\n",
+         stats.events, stats.max_pending, stats.last_time);
+   if (stats.seq_wraps) {
+      printf("ERROR: sequence numbers wrapped %lu times (a gate saw 64 or more events),\n"
+            "       so the riscv app's outputs are not defined. Use fewer input\n"
+            "       events, or --plain-ts for des_core\n",
+            stats.seq_wraps);
+      exit(1);
+   }
+
+   uint32_t count[4] = {0, 0, 0, 0};
+   uint32_t mismatches = 0;
+   for (uint32_t i = 0; i < net.outputs.size(); i++) {
+      uint32_t vid = net.outputs[i];
+      uint32_t val = (state[vid] >> 24) & 0x3;
+      data[data[6] + i] = vid << 16 | val;
+      count[val]++;
+      if (net.outvalues[i] >= 0 && (uint32_t) net.outvalues[i] != val) {
+         if (mismatches++ < 10) {
+            printf("WARNING: output %s is %u, netlist outvalues say %d\n",
+                  net.gates[vid].name.c_str(), val, net.outvalues[i]);
+         }
+      }
+   }
+   printf("Outputs: %u zeros, %u ones, %u X, %u Z; %u differ from outvalues\n",
+         count[0], count[1], count[2], count[3], mismatches);
+}
+
+// Output vids must fit in 16 bits of their ground truth word. Moves the
+// outputs right after the inputs if they do not, and (--levelize) sorts
+// the other gates by level (level is only filled in with --levelize).
+void Reorder(Netlist& net, const std::vector<uint32_t>& level) {
+   uint32_t n = net.gates.size();
+   bool outputs_first = false;
+   for (uint32_t o : net.outputs) outputs_first |= (o > 0xffff);
+   if (!outputs_first && !levelize) return;
+
+   std::vector<uint32_t> order;
+   std::vector<bool> placed(n, false);
+   for (uint32_t i = 0; i < net.numI; i++) {
+      order.push_back(i);
+      placed[i] = true;
+   }
+   if (outputs_first) {
+      for (uint32_t o : net.outputs) {
+         if (!placed[o]) order.push_back(o);
+         placed[o] = true;
+      }
+      if (order.size() > 0x10000) {
+         printf("ERROR: %lu inputs and outputs do not fit 16-bit ground truth ids\n",
+               order.size());
+         exit(1);
+      }
+   }
+   uint64_t rest = order.size();
+   for (uint32_t i = 0; i < n; i++) {
+      if (!placed[i]) order.push_back(i);
+   }
+   if (levelize) {
+      std::stable_sort(order.begin() + rest, order.end(),
+            [&](uint32_t a, uint32_t b) { return level[a] < level[b]; });
+   }
+   RenumberNetlist(net, order);
+   printf("Renumbered gates (%s%s)\n", outputs_first ? "outputs first" : "",
+         levelize ? (outputs_first ? ", by level" : "by level") : "");
+}
+
+void WriteImage(const char* file, const std::vector<uint32_t>& data) {
+   FILE* fp = fopen(file, write_hex ? "w" : "wb");
+   if (!fp) {
+      printf("ERROR: Could not open output file %s\n", file);
+      exit(1);
+   }
+   if (write_hex) {
+      for (uint32_t w : data) fprintf(fp, "%08x\n", w);
+   } else {
+      fwrite(data.data(), sizeof(uint32_t), data.size(), fp);
+   }
+   fclose(fp);
+}
+
+int prefix(const char* pre, const char* str) {
+   return strncmp(pre, str, strlen(pre)) == 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+   int cur_arg = 1;
+   while (cur_arg < argc && prefix("--", argv[cur_arg])) {
+      const char* val = strstr(argv[cur_arg], "=");
+      val = val ? val+1 : "";
+      if (prefix("--hex", argv[cur_arg])) write_hex = true;
+      if (prefix("--levelize", argv[cur_arg])) levelize = true;
+      if (prefix("--plain-ts", argv[cur_arg])) seq_ts = false;
+      if (prefix("--seed", argv[cur_arg])) synth_seed = strtoull(val, NULL, 0);
+      cur_arg++;
+   }
+   argv += cur_arg - 1;
+   argc -= cur_arg - 1;
+
+   if (argc < 3) {
+      printf("Usage: des_gen <--hex> <--levelize> <--plain-ts> <--seed=S> type=<net,adder,multiplier> type_args\n");
+      printf("  net <file.net>                  writes <file.net>.csr\n");
+      printf("  adder <bits> <vectors>          writes adder_<bits>.net and .net.csr\n");
+      printf("  multiplier <bits> <vectors>     writes multiplier_<bits>.net and .net.csr\n");
+      printf("  --hex       text image, one word per line (default: binary)\n");
+      printf("  --levelize  number the gates by level (inputs stay first); the\n");
+      printf("              circuit must then have no loops\n");
+      printf("  --plain-ts  simulate with ts = time (des_core) instead of the\n");
+      printf("              riscv app's time << 8 | seq, which allows at most 63\n");
+      printf("              events per gate (eg: multiplier 8 2, multiplier 16 1)\n");
+      exit(0);
+   }
+
+   Netlist net;
+   char net_file[256];
+   if (strcmp(argv[1], "net") == 0) {
+      snprintf(net_file, sizeof(net_file), "%s", argv[2]);
+      ParseNetlist(net_file, net);
+   } else if (strcmp(argv[1], "adder") == 0 || strcmp(argv[1], "multiplier") == 0) {
+      uint32_t bits = atoi(argv[2]);
+      uint32_t n_vectors = (argc > 3) ? atoi(argv[3]) : 4;
+      if (n_vectors == 0) n_vectors = 1;
+      if (argv[1][0] == 'a') SynthAdder(net, bits, n_vectors);
+      else SynthMultiplier(net, bits, n_vectors);
+      snprintf(net_file, sizeof(net_file), "%s_%u.net", argv[1], bits);
+      WriteNetlist(net_file, net);
+   } else {
+      printf("ERROR: Unknown type %s\n", argv[1]);
+      exit(1);
+   }
+
+   std::vector<uint32_t> level;
+   if (levelize) {
+      level = Levelize(net);
+      uint32_t depth = 0;
+      for (uint32_t l : level) depth = std::max(depth, l);
+      printf("Levelized: depth %u\n", depth);
+   } else {
+      CheckZeroDelayLoops(net);
+   }
+   Reorder(net, level);
+
+   std::vector<uint32_t> data = Compile(net);
+   FillGroundTruth(net, data);
+
+   char out_file[300];
+   snprintf(out_file, sizeof(out_file), "%s.csr", net_file);
+   WriteImage(out_file, data);
+   printf("Wrote %s (%lu words)\n", out_file, data.size());
+   return 0;
+}
@@ -0,0 +1,104 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DES_GEN_H
+#define DES_GEN_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define MAGIC_OP 0xdead
+
+// gate types, as encoded in gate_state[19:16]
+#define BUF  0
+#define INV 1
+#define NAND2 2
+#define NOR2 3
+#define AND2 4
+#define OR2 5
+#define XOR2 6
+#define XNOR2 7
+
+#define LOGIC_0 0
+#define LOGIC_1 1
+#define LOGIC_X 2
+#define LOGIC_Z 3
+
+const uint32_t NO_NET = ~0u;
+
+struct Gate {
+   std::string name; // of the net it drives
+   uint32_t type;
+   uint32_t delay;
+   uint32_t in[2];   // driving gates; NO_NET if unused (inputs, buf/inv)
+};
+
+struct InitEvent {
+   uint32_t time;
+   uint32_t val;
+};
+
+// A circuit in the netlist format of the DES benchmark (see netlist.cpp).
+// gates[0..numI) are the primary inputs, modelled as zero-delay buffers.
+struct Netlist {
+   std::vector<Gate> gates;
+   uint32_t numI;
+   std::vector<uint32_t> outputs;
+   std::vector<std::vector<InitEvent>> initlist; // per input
+   std::vector<int> outvalues; // per output; -1 if not given
+   uint32_t finish;
+};
+
+// netlist.cpp
+void ParseNetlist(const char* file, Netlist& net);
+void WriteNetlist(const char* file, const Netlist& net);
+// Level of every gate (inputs are 0); exits on a combinational loop
+std::vector<uint32_t> Levelize(const Netlist& net);
+// Exits on a loop of zero-delay gates, which would never settle. Loops
+// through a delay (latches, flip-flops) are fine for the simulator.
+void CheckZeroDelayLoops(const Netlist& net);
+// Renumbers the gates as order[i] -> i; inputs must stay in place
+void RenumberNetlist(Netlist& net, const std::vector<uint32_t>& order);
+
+// des_synth.cpp
+// Scaled test circuits with random input vectors and known outputs
+extern uint64_t synth_seed;
+void SynthAdder(Netlist& net, uint32_t bits, uint32_t n_vectors);
+void SynthMultiplier(Netlist& net, uint32_t bits, uint32_t n_vectors);
+
+// des_sim.cpp
+// Runs the des app's tasks to completion on a copy of the image's gate
+// state and returns the final gate_state words. seq_ts selects the riscv
+// app's sequence-number timestamps (otherwise ts = time, as in des_core).
+struct SimStats {
+   uint64_t events;
+   uint64_t max_pending;
+   uint32_t last_time;
+   uint64_t seq_wraps; // gates past 63 events: the order of their outputs
+                       // is no longer the order of the events
+};
+uint32_t eval_gate(uint32_t in0, uint32_t in1, uint32_t gate_type);
+std::vector<uint32_t> Simulate(const uint32_t* image, bool seq_ts, SimStats* stats);
+
+#endif
@@ -0,0 +1,171 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Reference simulator for the des app.
+//
+// This is a sequential run of riscv_code/des/main.c on the compiled image:
+// the same gate_state encoding, eval_gate and timestamps, with the task
+// queue replaced by a heap ordered by (ts, enqueue order). Tasks with equal
+// timestamps may run in any order on Chronos; the final gate outputs do not
+// depend on it, as long as no gate's sequence number wraps (seq_wraps).
+
+#include "des_gen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <queue>
+
+namespace {
+
+struct Event {
+   uint32_t ts;
+   uint64_t order;
+   uint32_t comp;
+   uint32_t port;
+   uint32_t val;
+};
+
+struct EventLater {
+   bool operator()(const Event& a, const Event& b) const {
+      return (a.ts > b.ts) || (a.ts == b.ts && a.order > b.order);
+   }
+};
+
+} // namespace
+
+uint32_t eval_gate(uint32_t in0, uint32_t in1, uint32_t gate_type) {
+   if (gate_type == BUF) {
+      return in0;
+   } else if (gate_type == INV) {
+      if (in0 == LOGIC_0) return LOGIC_1;
+      else if (in0 == LOGIC_1) return LOGIC_0;
+      else return in0;
+   } else if (gate_type == NAND2) {
+      if ( (in0 == LOGIC_1) & (in1 == LOGIC_1)) return LOGIC_0;
+      else if ( (in0 == LOGIC_0) | (in1 == LOGIC_0)) return LOGIC_1;
+      else return LOGIC_X;
+   } else if (gate_type == NOR2) {
+      if ( (in0 == LOGIC_1) | (in1 == LOGIC_1)) return LOGIC_0;
+      else if ( (in0 == LOGIC_0) & (in1 == LOGIC_0)) return LOGIC_1;
+      else return LOGIC_X;
+   } else if (gate_type == AND2) {
+      if ( (in0 == LOGIC_1) & (in1 == LOGIC_1)) return LOGIC_1;
+      else if ( (in0 == LOGIC_0) | (in1 == LOGIC_0)) return LOGIC_0;
+      else return LOGIC_X;
+   } else if (gate_type == OR2) {
+      if ( (in0 == LOGIC_1) | (in1 == LOGIC_1)) return LOGIC_1;
+      else if ( (in0 == LOGIC_0) & (in1 == LOGIC_0)) return LOGIC_0;
+      else return LOGIC_X;
+   } else if (gate_type == XOR2) {
+      if ( (in0 == LOGIC_1) & (in1 == LOGIC_1)) return LOGIC_0;
+      else if ( (in0 == LOGIC_1) & (in1 == LOGIC_0)) return LOGIC_1;
+      else if ( (in0 == LOGIC_0) & (in1 == LOGIC_1)) return LOGIC_1;
+      else if ( (in0 == LOGIC_0) & (in1 == LOGIC_0)) return LOGIC_0;
+      else return LOGIC_X;
+   } else if (gate_type == XNOR2) {
+      if ( (in0 == LOGIC_1) & (in1 == LOGIC_1)) return LOGIC_1;
+      else if ( (in0 == LOGIC_1) & (in1 == LOGIC_0)) return LOGIC_0;
+      else if ( (in0 == LOGIC_0) & (in1 == LOGIC_1)) return LOGIC_0;
+      else if ( (in0 == LOGIC_0) & (in1 == LOGIC_0)) return LOGIC_1;
+      else return LOGIC_X;
+   }
+   return LOGIC_X;
+}
+
+std::vector<uint32_t> Simulate(const uint32_t* data, bool seq_ts, SimStats* stats) {
+   uint32_t numV = data[1];
+   const uint32_t* edge_offset = data + data[3];
+   const uint32_t* edge_neighbors = data + data[4];
+   const uint32_t* init_vid = data + data[7];
+   const uint32_t* init_offset = data + data[8];
+   const uint32_t* init_events = data + data[9];
+   uint32_t numI = data[11];
+   std::vector<uint32_t> gate_state(data + data[5], data + data[5] + numV);
+
+   std::priority_queue<Event, std::vector<Event>, EventLater> pq;
+   uint64_t order = 0;
+   stats->events = 0;
+   stats->max_pending = 0;
+   stats->last_time = 0;
+   stats->seq_wraps = 0;
+
+   // enqueuer_task
+   for (uint32_t i = 0; i < numI; i++) {
+      uint32_t comp = init_vid[i];
+      for (uint32_t e = init_offset[comp]; e < init_offset[comp+1]; e++) {
+         uint32_t next_event = init_events[e];
+         uint32_t ts = seq_ts ? (next_event & 0xffffff) << 8 : (next_event & 0xffffff);
+         Event ev = {ts, order++, comp, 0, (next_event >> 24) & 0x3};
+         pq.push(ev);
+      }
+   }
+
+   // des_task
+   while (!pq.empty()) {
+      stats->max_pending = std::max(stats->max_pending, (uint64_t) pq.size());
+      Event ev = pq.top();
+      pq.pop();
+      stats->events++;
+      uint32_t ts = ev.ts;
+      uint32_t comp = ev.comp;
+      stats->last_time = seq_ts ? ts >> 8 : ts;
+
+      uint32_t state = gate_state[comp];
+      uint32_t delay = state & 0xffff;
+      uint32_t gate_type = (state >> 16) & 0x7;
+      uint32_t input_1 = (state >> 20) & 0x3;
+      uint32_t input_0 = (state >> 22) & 0x3;
+      uint32_t cur_out = (state >> 24) & 0x3;
+      if (ev.port == 0) input_0 = ev.val;
+      if (ev.port == 1) input_1 = ev.val;
+      uint32_t new_out = eval_gate(input_0, input_1, gate_type);
+      gate_state[comp] = (new_out << 24)
+         | (input_0 << 22)
+         | (input_1 << 20)
+         | (gate_type << 16)
+         | (delay );
+      uint32_t new_ts = ts + delay;
+      if (seq_ts) {
+         uint32_t seq = (state >> 26);
+         seq = seq + 1;
+         if ((seq < (ts & 0x3f)) & (delay == 0)) {
+            seq = ts & 0x3f;
+         }
+         // seq wraps at 6 bits in gate_state, but not in the timestamp
+         if (seq == 64) stats->seq_wraps++;
+         gate_state[comp] |= (seq << 26);
+         new_ts = ((ts >> 8) + delay) << 8;
+         new_ts |= seq;
+      }
+
+      if (cur_out != new_out) {
+         for (uint32_t i = edge_offset[comp]; i < edge_offset[comp+1]; i++) {
+            Event out = {new_ts, order++, edge_neighbors[i] >> 1,
+               edge_neighbors[i] & 1, new_out};
+            pq.push(out);
+         }
+      }
+   }
+   return gate_state;
+}
@@ -0,0 +1,215 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Synthetic circuits of any size:
+//  adder      - <bits>-bit ripple-carry adder, outputs s0.. and cout
+//  multiplier - <bits> x <bits> array multiplier: an and2 per partial
+//               product bit, summed row by row with ripple-carry adders,
+//               outputs p0..p(2*bits-1)
+// The inputs a0.., b0.. take <vectors> random values, one every period,
+// which is longer than the critical path so each vector settles. The
+// expected outputs of the last vector are computed arithmetically and
+// written as outvalues, which checks the simulator end to end.
+
+#include "des_gen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+
+uint64_t synth_seed = 0;
+
+namespace {
+
+const uint32_t GATE_DELAY[] = {1, 1, 2, 2, 3, 3, 4, 4};
+const uint32_t MAX_GATE_DELAY = 4;
+
+typedef std::vector<uint8_t> Bits; // little-endian
+
+uint64_t splitmix64(uint64_t& x) {
+   uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+   return z ^ (z >> 31);
+}
+
+class Builder {
+   Netlist& net;
+
+  public:
+   Builder(Netlist& net) : net(net) {
+      net.gates.clear();
+      net.outputs.clear();
+      net.numI = 0;
+   }
+
+   uint32_t input(const std::string& name) {
+      Gate g = {name, BUF, 0, {NO_NET, NO_NET}};
+      net.gates.push_back(g);
+      return net.numI++;
+   }
+
+   uint32_t gate(uint32_t type, uint32_t a, uint32_t b = NO_NET) {
+      uint32_t id = net.gates.size();
+      Gate g = {"n" + std::to_string(id), type, GATE_DELAY[type], {a, b}};
+      net.gates.push_back(g);
+      return id;
+   }
+
+   void output(uint32_t id, const std::string& name) {
+      if (id < net.numI) id = gate(BUF, id);
+      net.gates[id].name = name;
+      net.outputs.push_back(id);
+   }
+
+   void full_add(uint32_t a, uint32_t b, uint32_t c, uint32_t* s, uint32_t* cout) {
+      uint32_t t = gate(XOR2, a, b);
+      *s = gate(XOR2, t, c);
+      *cout = gate(OR2, gate(AND2, a, b), gate(AND2, t, c));
+   }
+
+   void half_add(uint32_t a, uint32_t b, uint32_t* s, uint32_t* cout) {
+      *s = gate(XOR2, a, b);
+      *cout = gate(AND2, a, b);
+   }
+};
+
+Bits add(const Bits& a, const Bits& b) {
+   Bits s(a.size() + 1, 0);
+   uint32_t c = 0;
+   for (uint32_t i = 0; i < a.size(); i++) {
+      uint32_t t = a[i] + b[i] + c;
+      s[i] = t & 1;
+      c = t >> 1;
+   }
+   s[a.size()] = c;
+   return s;
+}
+
+Bits multiply(const Bits& a, const Bits& b) {
+   uint32_t n = a.size();
+   std::vector<uint32_t> col(2 * n + 1, 0);
+   for (uint32_t i = 0; i < n; i++) {
+      for (uint32_t j = 0; j < n; j++) col[i+j] += a[j] & b[i];
+   }
+   Bits p(2 * n, 0);
+   uint32_t c = 0;
+   for (uint32_t k = 0; k < 2 * n; k++) {
+      uint32_t t = col[k] + c;
+      p[k] = t & 1;
+      c = t >> 1;
+   }
+   return p;
+}
+
+// Drives a and b with n_vectors random values and records the expected
+// outputs of the last one.
+void ApplyVectors(Netlist& net, uint32_t bits, uint32_t n_vectors,
+      Bits (*expected)(const Bits&, const Bits&)) {
+   std::vector<uint32_t> level = Levelize(net);
+   uint32_t depth = 0;
+   for (uint32_t l : level) depth = std::max(depth, l);
+   uint32_t period = (depth + 1) * MAX_GATE_DELAY;
+
+   uint64_t rng = synth_seed;
+   net.initlist.assign(net.numI, std::vector<InitEvent>());
+   Bits a(bits), b(bits);
+   for (uint32_t v = 0; v < n_vectors; v++) {
+      for (uint32_t i = 0; i < bits; i++) {
+         a[i] = splitmix64(rng) & 1;
+         b[i] = splitmix64(rng) & 1;
+         InitEvent ea = {v * period, a[i]};
+         InitEvent eb = {v * period, b[i]};
+         net.initlist[i].push_back(ea);
+         net.initlist[bits + i].push_back(eb);
+      }
+   }
+   net.finish = n_vectors * period;
+   if (net.finish >= (1u << 24)) {
+      printf("ERROR: %u vectors of period %u do not fit in 24-bit event times\n",
+            n_vectors, period);
+      exit(1);
+   }
+
+   Bits out = expected(a, b);
+   net.outvalues.assign(net.outputs.size(), -1);
+   for (uint32_t i = 0; i < net.outputs.size(); i++) net.outvalues[i] = out[i];
+   printf("Synthesized %lu gates, depth %u, %u vectors of %u time units\n",
+         net.gates.size(), depth, n_vectors, period);
+}
+
+void check_bits(uint32_t bits, uint32_t min_bits) {
+   if (bits < min_bits) {
+      printf("ERROR: need at least %u bits\n", min_bits);
+      exit(1);
+   }
+}
+
+} // namespace
+
+void SynthAdder(Netlist& net, uint32_t bits, uint32_t n_vectors) {
+   check_bits(bits, 1);
+   Builder b(net);
+   std::vector<uint32_t> x(bits), y(bits);
+   for (uint32_t i = 0; i < bits; i++) x[i] = b.input("a" + std::to_string(i));
+   for (uint32_t i = 0; i < bits; i++) y[i] = b.input("b" + std::to_string(i));
+   std::vector<uint32_t> s(bits);
+   uint32_t c;
+   b.half_add(x[0], y[0], &s[0], &c);
+   for (uint32_t i = 1; i < bits; i++) b.full_add(x[i], y[i], c, &s[i], &c);
+   for (uint32_t i = 0; i < bits; i++) b.output(s[i], "s" + std::to_string(i));
+   b.output(c, "cout");
+   ApplyVectors(net, bits, n_vectors, add);
+}
+
+void SynthMultiplier(Netlist& net, uint32_t bits, uint32_t n_vectors) {
+   check_bits(bits, 2);
+   Builder b(net);
+   std::vector<uint32_t> x(bits), y(bits);
+   for (uint32_t i = 0; i < bits; i++) x[i] = b.input("a" + std::to_string(i));
+   for (uint32_t i = 0; i < bits; i++) y[i] = b.input("b" + std::to_string(i));
+
+   // acc[k] is the running sum bit of weight 2^k (NO_NET if none yet)
+   std::vector<uint32_t> acc(2 * bits, NO_NET);
+   for (uint32_t j = 0; j < bits; j++) acc[j] = b.gate(AND2, x[j], y[0]);
+   for (uint32_t i = 1; i < bits; i++) {
+      uint32_t c = NO_NET;
+      for (uint32_t j = 0; j < bits; j++) {
+         uint32_t k = i + j;
+         uint32_t pp = b.gate(AND2, x[j], y[i]);
+         if (acc[k] == NO_NET && c == NO_NET) {
+            acc[k] = pp;
+         } else if (acc[k] == NO_NET) {
+            b.half_add(pp, c, &acc[k], &c);
+         } else if (c == NO_NET) {
+            b.half_add(pp, acc[k], &acc[k], &c);
+         } else {
+            b.full_add(pp, acc[k], c, &acc[k], &c);
+         }
+      }
+      acc[i + bits] = c;
+   }
+   for (uint32_t k = 0; k < 2 * bits; k++) b.output(acc[k], "p" + std::to_string(k));
+   ApplyVectors(net, bits, n_vectors, multiply);
+}
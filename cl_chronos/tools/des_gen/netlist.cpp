@@ -0,0 +1,353 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Netlist files, eg:
+//
+//   finish 100000
+//   inputs a, b end
+//   outputs s end
+//   outvalues s 1 end
+//   initlist a 0,0 50,1 end
+//   initlist b 0,1 end
+//   netlist
+//   xor2(s, a, b)#5
+//   end
+//
+// After dropping every line that contains '//' and treating '#,=()' as
+// white space, the file is a stream of tokens: section keywords, then
+// names and numbers up to 'end'. initlist entries are (time, value) pairs;
+// gates are '<type> <out> <in0> [<in1>] <delay>'. Ids are handed out to
+// the inputs in order, then to the gates in the order they are defined,
+// as des_format.py did, but gates may be used before they are defined.
+
+#include "des_gen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+const char* GATE_NAMES[] = {"buf", "inv", "nand2", "nor2", "and2", "or2",
+   "xor2", "xnor2"};
+
+int gate_type(const std::string& s) {
+   for (int i = 0; i < 8; i++) {
+      if (s == GATE_NAMES[i]) return i;
+   }
+   return -1;
+}
+
+uint32_t to_uint(const std::string& s) {
+   char* end;
+   unsigned long v = strtoul(s.c_str(), &end, 10);
+   if (s.empty() || *end) {
+      printf("ERROR: expected a number, got '%s'\n", s.c_str());
+      exit(1);
+   }
+   return v;
+}
+
+} // namespace
+
+void ParseNetlist(const char* file, Netlist& net) {
+   std::ifstream f(file);
+   if (!f.is_open()) {
+      printf("ERROR: Could not open input file %s\n", file);
+      exit(1);
+   }
+   std::vector<std::string> tokens;
+   std::string line;
+   while (std::getline(f, line)) {
+      if (line.find("//") != std::string::npos) continue;
+      for (char& c : line) {
+         if (strchr("#,=()", c)) c = ' ';
+      }
+      std::istringstream ss(line);
+      std::string tok;
+      while (ss >> tok) tokens.push_back(tok);
+   }
+
+   auto token = [&](uint64_t t) -> const std::string& {
+      if (t >= tokens.size()) {
+         printf("ERROR: %s ends inside a section (missing 'end')\n", file);
+         exit(1);
+      }
+      return tokens[t];
+   };
+
+   // Names are resolved once everything is read
+   std::vector<std::string> inputs, outputs;
+   std::vector<std::pair<std::string, std::vector<InitEvent>>> initlists;
+   std::vector<std::pair<std::string, int>> outvalues;
+   struct GateDef {
+      Gate g;
+      std::string in[2];
+   };
+   std::vector<GateDef> defs;
+   net.finish = 0;
+
+   uint64_t t = 0;
+   while (t < tokens.size()) {
+      const std::string& tok = tokens[t++];
+      if (tok == "inputs") {
+         while (token(t) != "end") inputs.push_back(tokens[t++]);
+         t++;
+      } else if (tok == "outputs") {
+         while (token(t) != "end") outputs.push_back(tokens[t++]);
+         t++;
+      } else if (tok == "finish") {
+         net.finish = to_uint(token(t++));
+      } else if (tok == "initlist") {
+         initlists.emplace_back(token(t++), std::vector<InitEvent>());
+         while (token(t) != "end") {
+            InitEvent e = {to_uint(tokens[t]), to_uint(token(t+1))};
+            initlists.back().second.push_back(e);
+            t += 2;
+         }
+         t++;
+      } else if (tok == "outvalues") {
+         while (token(t) != "end") {
+            outvalues.emplace_back(tokens[t], to_uint(token(t+1)));
+            t += 2;
+         }
+         t++;
+      } else if (tok == "netlist") {
+         while (token(t) != "end") {
+            GateDef d;
+            int type = gate_type(tokens[t]);
+            if (type < 0) {
+               printf("ERROR: unknown gate type '%s'\n", tokens[t].c_str());
+               exit(1);
+            }
+            bool single_input = (type == BUF || type == INV);
+            d.g.type = type;
+            d.g.name = token(t+1);
+            d.in[0] = token(t+2);
+            if (!single_input) d.in[1] = token(t+3);
+            uint32_t n = single_input ? 4 : 5;
+            d.g.delay = to_uint(token(t + n - 1));
+            if (d.g.delay > 0xffff) {
+               printf("ERROR: gate %s delay %u does not fit in 16 bits\n",
+                     d.g.name.c_str(), d.g.delay);
+               exit(1);
+            }
+            defs.push_back(d);
+            t += n;
+         }
+         t++;
+      }
+   }
+
+   std::unordered_map<std::string, uint32_t> ids;
+   auto define = [&](const Gate& g) {
+      if (!ids.emplace(g.name, net.gates.size()).second) {
+         printf("ERROR: net %s is driven twice\n", g.name.c_str());
+         exit(1);
+      }
+      net.gates.push_back(g);
+   };
+   auto lookup = [&](const std::string& name) -> uint32_t {
+      auto it = ids.find(name);
+      if (it == ids.end()) {
+         printf("ERROR: net %s is never driven\n", name.c_str());
+         exit(1);
+      }
+      return it->second;
+   };
+
+   net.gates.clear();
+   for (const std::string& in : inputs) {
+      Gate g = {in, BUF, 0, {NO_NET, NO_NET}};
+      define(g);
+   }
+   net.numI = inputs.size();
+   for (const GateDef& d : defs) define(d.g);
+   for (uint32_t i = 0; i < defs.size(); i++) {
+      Gate& g = net.gates[net.numI + i];
+      for (int p = 0; p < 2; p++) {
+         if (!defs[i].in[p].empty()) g.in[p] = lookup(defs[i].in[p]);
+      }
+   }
+
+   net.outputs.clear();
+   for (const std::string& o : outputs) net.outputs.push_back(lookup(o));
+   net.outvalues.assign(net.outputs.size(), -1);
+   for (auto& ov : outvalues) {
+      uint32_t id = lookup(ov.first);
+      for (uint32_t i = 0; i < net.outputs.size(); i++) {
+         if (net.outputs[i] == id) net.outvalues[i] = ov.second;
+      }
+   }
+   net.initlist.assign(net.numI, std::vector<InitEvent>());
+   for (auto& il : initlists) {
+      uint32_t id = lookup(il.first);
+      if (id >= net.numI) {
+         printf("ERROR: initlist for %s, which is not an input\n", il.first.c_str());
+         exit(1);
+      }
+      net.initlist[id] = il.second;
+   }
+}
+
+void WriteNetlist(const char* file, const Netlist& net) {
+   FILE* fp = fopen(file, "w");
+   if (!fp) {
+      printf("ERROR: Could not open output file %s\n", file);
+      exit(1);
+   }
+   auto name = [&](uint32_t id) { return net.gates[id].name.c_str(); };
+   fprintf(fp, "finish %u\n", net.finish);
+   fprintf(fp, "inputs");
+   for (uint32_t i = 0; i < net.numI; i++) fprintf(fp, "%s %s", i ? "," : "", name(i));
+   fprintf(fp, " end\n");
+   fprintf(fp, "outputs");
+   for (uint32_t i = 0; i < net.outputs.size(); i++) {
+      fprintf(fp, "%s %s", i ? "," : "", name(net.outputs[i]));
+   }
+   fprintf(fp, " end\n");
+   bool has_outvalues = false;
+   for (int v : net.outvalues) has_outvalues |= (v >= 0);
+   if (has_outvalues) {
+      fprintf(fp, "outvalues");
+      bool first = true;
+      for (uint32_t i = 0; i < net.outputs.size(); i++) {
+         if (net.outvalues[i] < 0) continue;
+         fprintf(fp, "%s %s %d", first ? "" : ",", name(net.outputs[i]),
+               net.outvalues[i]);
+         first = false;
+      }
+      fprintf(fp, " end\n");
+   }
+   for (uint32_t i = 0; i < net.numI; i++) {
+      fprintf(fp, "initlist %s", name(i));
+      for (const InitEvent& e : net.initlist[i]) fprintf(fp, " %u,%u", e.time, e.val);
+      fprintf(fp, " end\n");
+   }
+   fprintf(fp, "netlist\n");
+   for (uint32_t i = net.numI; i < net.gates.size(); i++) {
+      const Gate& g = net.gates[i];
+      if (g.in[1] == NO_NET) {
+         fprintf(fp, "%s(%s, %s)#%u\n", GATE_NAMES[g.type], g.name.c_str(),
+               name(g.in[0]), g.delay);
+      } else {
+         fprintf(fp, "%s(%s, %s, %s)#%u\n", GATE_NAMES[g.type], g.name.c_str(),
+               name(g.in[0]), name(g.in[1]), g.delay);
+      }
+   }
+   fprintf(fp, "end\n");
+   fclose(fp);
+}
+
+namespace {
+
+// Levels of the gates over the edges out of the gates that pass keep(src).
+// Returns a gate on a loop of such edges, or NO_NET.
+template <typename F>
+uint32_t LevelGates(const Netlist& net, F keep, std::vector<uint32_t>& level) {
+   uint32_t n = net.gates.size();
+   std::vector<uint32_t> pending(n, 0), fanout_offset(n + 1, 0), fanout;
+   for (const Gate& g : net.gates) {
+      for (int p = 0; p < 2; p++) {
+         if (g.in[p] != NO_NET && keep(g.in[p])) fanout_offset[g.in[p] + 1]++;
+      }
+   }
+   for (uint32_t i = 0; i < n; i++) fanout_offset[i+1] += fanout_offset[i];
+   fanout.resize(fanout_offset[n]);
+   std::vector<uint32_t> cursor(fanout_offset.begin(), fanout_offset.end() - 1);
+   for (uint32_t i = 0; i < n; i++) {
+      for (int p = 0; p < 2; p++) {
+         uint32_t src = net.gates[i].in[p];
+         if (src == NO_NET || !keep(src)) continue;
+         fanout[cursor[src]++] = i;
+         pending[i]++;
+      }
+   }
+
+   level.assign(n, 0);
+   std::vector<uint32_t> queue;
+   for (uint32_t i = 0; i < n; i++) {
+      if (pending[i] == 0) queue.push_back(i);
+   }
+   for (uint64_t head = 0; head < queue.size(); head++) {
+      uint32_t u = queue[head];
+      for (uint32_t e = fanout_offset[u]; e < fanout_offset[u+1]; e++) {
+         uint32_t v = fanout[e];
+         level[v] = std::max(level[v], level[u] + 1);
+         if (--pending[v] == 0) queue.push_back(v);
+      }
+   }
+   if (queue.size() != n) {
+      for (uint32_t i = 0; i < n; i++) {
+         if (pending[i]) return i;
+      }
+   }
+   return NO_NET;
+}
+
+} // namespace
+
+std::vector<uint32_t> Levelize(const Netlist& net) {
+   std::vector<uint32_t> level;
+   uint32_t loop = LevelGates(net, [](uint32_t) { return true; }, level);
+   if (loop != NO_NET) {
+      printf("ERROR: combinational loop through %s\n", net.gates[loop].name.c_str());
+      exit(1);
+   }
+   return level;
+}
+
+void CheckZeroDelayLoops(const Netlist& net) {
+   std::vector<uint32_t> level;
+   uint32_t loop = LevelGates(net,
+         [&](uint32_t src) { return net.gates[src].delay == 0; }, level);
+   if (loop != NO_NET) {
+      printf("ERROR: zero-delay loop through %s\n", net.gates[loop].name.c_str());
+      exit(1);
+   }
+}
+
+void RenumberNetlist(Netlist& net, const std::vector<uint32_t>& order) {
+   uint32_t n = net.gates.size();
+   std::vector<uint32_t> new_id(n);
+   for (uint32_t i = 0; i < n; i++) new_id[order[i]] = i;
+   for (uint32_t i = 0; i < net.numI; i++) {
+      if (new_id[i] != i) {
+         printf("ERROR: inputs must keep their ids\n");
+         exit(1);
+      }
+   }
+   std::vector<Gate> gates(n);
+   for (uint32_t i = 0; i < n; i++) {
+      gates[i] = net.gates[order[i]];
+      for (int p = 0; p < 2; p++) {
+         if (gates[i].in[p] != NO_NET) gates[i].in[p] = new_id[gates[i].in[p]];
+      }
+   }
+   net.gates.swap(gates);
+   for (uint32_t& o : net.outputs) o = new_id[o];
+}
@@ -0,0 +1,318 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// A* reference for the astar app.
+//
+// The astar cores (design/apps/astar) enqueue each neighbor c of a visited
+// vertex v with
+//    ts = max(ts(v), g(v) + w(v,c) + h(c)),  h = astar_dist(c, dest)
+// and a vertex keeps the ts of the first task that visits it. Task ts never
+// decrease in commit order, so this is the ts a vertex is first popped with
+// in a best-first search. The search here keeps one heap entry per vertex
+// (an indexed binary heap with decrease-key) instead of one per task, and
+// stops at dest, as the terminate task does.
+//
+// Ground truth is the ts of every vertex closed with a smaller ts than dest,
+// and of dest and its ancestors (which commit before it). Other vertices
+// that tie with dest may or may not be visited by the hardware, so they are
+// left at ~0 along with the unvisited ones (the runtime skips those). Ties
+// are common: astar_dist overestimates, so ts tends to stay flat along the
+// path.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <queue>
+
+uint32_t* csr_latlon;
+
+namespace {
+
+const double EarthRadius_m = 6371000.0;
+// fp_t = ap_fixed<32,3>: 29 fraction bits
+const double FP_FACTOR = (double) (1 << 29);
+
+const uint32_t UNSEEN = ~0u;
+const uint32_t CLOSED = ~0u - 1;
+
+// ap_fixed from double truncates towards -inf
+inline uint32_t to_fixed(double rad) {
+   return (uint32_t) (int32_t) floor(rad * FP_FACTOR);
+}
+
+inline double from_fixed(uint32_t raw) {
+   return (int32_t) raw / FP_FACTOR;
+}
+
+// astar_dist in hls/astar/astar.cpp, on the same fixed-point inputs. The
+// differences wrap at +-4 like the ap_fixed ones; the sin/cos/sqrt are
+// exact here rather than CORDIC, which the runtime's tolerance absorbs.
+inline uint32_t astar_dist(const uint32_t* src, const uint32_t* dst) {
+   double xdiff = from_fixed(src[0] - dst[0]);
+   double ydiff = from_fixed(src[1] - dst[1]);
+   double latS = sin(xdiff);
+   double lonS = sin(ydiff);
+   double a = latS * latS
+      + lonS * lonS * cos(from_fixed(src[0])) * cos(from_fixed(dst[0]));
+   return (uint32_t) (2 * sqrt(a) * EarthRadius_m);
+}
+
+// Per-thread search state, reset through the touched list so a batch of
+// short searches does not pay O(numV) each.
+struct Search {
+   std::vector<uint32_t> ts;
+   std::vector<uint32_t> g;
+   std::vector<uint32_t> parent;
+   std::vector<uint32_t> pos; // index in heap, UNSEEN or CLOSED
+   std::vector<uint32_t> heap;
+   std::vector<uint32_t> touched;
+
+   Search() : ts(numV), g(numV), parent(numV), pos(numV, UNSEEN) {}
+
+   // (ts, g) order; a lower g on equal ts leaves more slack to the children
+   bool less(uint32_t a, uint32_t b) const {
+      return ts[a] < ts[b] || (ts[a] == ts[b] && g[a] < g[b]);
+   }
+
+   void place(uint32_t i, uint32_t v) {
+      heap[i] = v;
+      pos[v] = i;
+   }
+
+   void sift_up(uint32_t i) {
+      uint32_t v = heap[i];
+      while (i > 0) {
+         uint32_t p = (i - 1) / 2;
+         if (!less(v, heap[p])) break;
+         place(i, heap[p]);
+         i = p;
+      }
+      place(i, v);
+   }
+
+   void sift_down(uint32_t i) {
+      uint32_t v = heap[i];
+      uint32_t n = heap.size();
+      while (true) {
+         uint32_t c = 2 * i + 1;
+         if (c >= n) break;
+         if (c + 1 < n && less(heap[c+1], heap[c])) c++;
+         if (!less(heap[c], v)) break;
+         place(i, heap[c]);
+         i = c;
+      }
+      place(i, v);
+   }
+
+   uint32_t pop() {
+      uint32_t v = heap[0];
+      uint32_t last = heap.back();
+      heap.pop_back();
+      if (!heap.empty()) {
+         heap[0] = last;
+         sift_down(0);
+      }
+      pos[v] = CLOSED;
+      return v;
+   }
+
+   // Inserts v or lowers its key
+   void update(uint32_t v, uint32_t new_ts, uint32_t new_g, uint32_t p) {
+      if (pos[v] == UNSEEN) {
+         touched.push_back(v);
+         ts[v] = new_ts;
+         g[v] = new_g;
+         parent[v] = p;
+         heap.push_back(v);
+         sift_up(heap.size() - 1);
+      } else if (new_ts < ts[v] || (new_ts == ts[v] && new_g < g[v])) {
+         ts[v] = new_ts;
+         g[v] = new_g;
+         parent[v] = p;
+         sift_up(pos[v]);
+      }
+   }
+
+   void run(AstarQuery& q) {
+      const uint32_t* target = csr_latlon + 2 * (uint64_t) q.dest;
+      q.closed.clear();
+      q.dist = ~0;
+      q.max_heap = 0;
+      // the runtime enqueues a queue task for start with ts 0 and g 0, so
+      // start is visited at its own astar_dist
+      update(q.start, astar_dist(csr_latlon + 2 * (uint64_t) q.start, target),
+            0, q.start);
+      while (!heap.empty()) {
+         q.max_heap = std::max(q.max_heap, (uint32_t) heap.size());
+         uint32_t v = pop();
+         q.closed.push_back(std::make_pair(v, ts[v]));
+         if (v == q.dest) {
+            q.dist = g[v];
+            break;
+         }
+         for (uint64_t e = csr_offset[v]; e < csr_offset[v+1]; e++) {
+            uint32_t c = csr_neighbors[e].n;
+            if (pos[c] == CLOSED) continue;
+            uint32_t c_g = g[v] + csr_neighbors[e].d_cm;
+            uint32_t c_f = c_g + astar_dist(csr_latlon + 2 * (uint64_t) c, target);
+            update(c, std::max(ts[v], c_f), c_g, v);
+         }
+      }
+      if (q.dist != (uint32_t) ~0) {
+         // drop the vertices that tie with dest, except its ancestors
+         uint32_t dest_ts = q.closed.back().second;
+         std::vector<uint32_t> path(1, q.dest);
+         while (path.back() != q.start) path.push_back(parent[path.back()]);
+         std::sort(path.begin(), path.end());
+         uint64_t n = 0;
+         for (auto& vt : q.closed) {
+            if (vt.second < dest_ts ||
+                  std::binary_search(path.begin(), path.end(), vt.first)) {
+               q.closed[n++] = vt;
+            }
+         }
+         q.closed.resize(n);
+      }
+
+      for (uint32_t v : touched) pos[v] = UNSEEN;
+      touched.clear();
+      heap.clear();
+   }
+};
+
+} // namespace
+
+namespace {
+
+// visit_vertex and queue_vertex tasks of design/apps/astar
+struct AstarTask {
+   uint32_t ts;
+   bool visit;
+   uint32_t vid;
+   uint32_t g;
+};
+
+struct AstarTaskAfter {
+   bool operator()(const AstarTask& a, const AstarTask& b) const {
+      return a.ts > b.ts;
+   }
+};
+
+} // namespace
+
+// A visit task of an unvisited vertex marks it and enqueues a queue task per
+// edge, at its own ts; each of those computes the neighbor's ts and enqueues
+// its visit. Visiting dest ends the search (the terminate tasks).
+void ProfileAstarTasks(const AstarQuery& q) {
+   double t_start = wall_time();
+   const uint32_t* target = csr_latlon + 2 * (uint64_t) q.dest;
+   std::vector<bool> visited(numV, false);
+   std::priority_queue<AstarTask, std::vector<AstarTask>, AstarTaskAfter> pq;
+   pq.push(AstarTask{0, false, q.start, 0});
+   while (!pq.empty()) {
+      AstarTask task = pq.top();
+      pq.pop();
+      uint32_t v = task.vid;
+      if (!task.visit) {
+         uint32_t c_f = task.g + astar_dist(csr_latlon + 2 * (uint64_t) v, target);
+         pq.push(AstarTask{std::max(task.ts, c_f), true, v, task.g});
+         ProfileTask(task.ts, 1, true, pq.size());
+         continue;
+      }
+      if (visited[v]) {
+         ProfileTask(task.ts, 0, false, pq.size());
+         continue;
+      }
+      visited[v] = true;
+      if (v == q.dest) {
+         ProfileTask(task.ts, 0, true, pq.size());
+         break;
+      }
+      for (uint64_t e = csr_offset[v]; e < csr_offset[v+1]; e++) {
+         pq.push(AstarTask{task.ts, false, csr_neighbors[e].n,
+               task.g + csr_neighbors[e].d_cm});
+      }
+      ProfileTask(task.ts, csr_offset[v+1] - csr_offset[v], true, pq.size());
+   }
+   printf("Profiled astar tasks %u -> %u in %.3f s\n", q.start, q.dest,
+         wall_time() - t_start);
+}
+
+void PickAstarQueries(uint32_t n, std::vector<AstarQuery>& queries) {
+   uint64_t x = gen_seed + queries.size();
+   auto pick = [&]() -> uint32_t {
+      // splitmix64
+      for (uint32_t tries = 0; tries < 1000; tries++) {
+         uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+         z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+         z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+         uint32_t v = (z ^ (z >> 31)) % numV;
+         if (csr_offset[v+1] > csr_offset[v]) return v;
+      }
+      printf("ERROR: could not find vertices with edges for astar pairs\n");
+      exit(1);
+   };
+   for (uint32_t i = 0; i < n; i++) {
+      AstarQuery q = AstarQuery();
+      q.start = pick();
+      do q.dest = pick(); while (q.dest == q.start && numV > 1);
+      queries.push_back(q);
+   }
+}
+
+void ComputeAstarReference(std::vector<AstarQuery>& queries) {
+   double t_start = wall_time();
+   if (!csr_latlon) {
+      csr_latlon = (uint32_t*) malloc(sizeof(uint32_t) * 2 * (uint64_t) numV);
+      parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+         for (uint64_t i = lo; i < hi; i++) {
+            csr_latlon[2*i] = to_fixed(vertex_lat[i]);
+            csr_latlon[2*i+1] = to_fixed(vertex_lon[i]);
+         }
+      });
+   }
+
+   // Queries are independent; each thread reuses one search state
+   std::vector<Search*> searches(n_threads, NULL);
+   parallel_tasks(queries.size(), [&](uint32_t t, uint32_t i) {
+      if (!searches[t]) searches[t] = new Search();
+      searches[t]->run(queries[i]);
+   });
+   for (Search* s : searches) delete s;
+
+   for (const AstarQuery& q : queries) {
+      if (q.dist == (uint32_t) ~0) {
+         printf("WARNING: %u is not reachable from %u\n", q.dest, q.start);
+      }
+      printf("A* %u -> %u: dist %u, ts %u, visited %lu, max heap %u\n",
+            q.start, q.dest, q.dist,
+            q.closed.empty() ? 0 : q.closed.back().second,
+            q.closed.size(), q.max_heap);
+   }
+   printf("A* reference: %lu queries in %.3f s\n", queries.size(),
+         wall_time() - t_start);
+}
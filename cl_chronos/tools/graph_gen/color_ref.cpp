@@ -0,0 +1,280 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Color ground truth (csr_dist) for the color image.
+//
+// The color app is a greedy coloring in priority order: by decreasing
+// degree, ties broken by increasing id. A vertex takes the lowest color not
+// used by its higher-priority neighbors, which only pass their color down
+// to lower-priority ones.
+//
+// The app's timestamps cap the degree at 255, ts = (255-min(deg,255)) << 24
+// | vid << 1, while a vertex notifies the neighbors of lower full degree
+// (design/apps/color, riscv_code/color-varint). So a neighbor u counts for
+// v only if it comes first in both orders, which disagree among vertices
+// of degree 255 or more: one of higher degree but higher id sends its color
+// after v has taken one, and one of lower degree does not send it at all.
+//
+// Since a vertex's color depends only on its higher-priority neighbors, it
+// can be colored as soon as they all are (Jones-Plassmann), in any order,
+// and the result is the same as the serial greedy pass. Each vertex counts
+// its pending higher-priority neighbors; the vertices whose count drops to
+// zero form the next round. Large rounds are colored by all threads; small
+// ones are drained by a single thread, which keeps going until the ready
+// set is large again, so long dependency chains do not cost a barrier per
+// vertex.
+//
+// A vertex of degree d needs at most d+1 colors, so the set of forbidden
+// colors is a bitmap of d+1 bits and the number of colors is unbounded.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <queue>
+
+namespace {
+
+// below this many ready vertices a round is colored serially
+const uint64_t PARALLEL_ROUND = 4096;
+// colors that fit in the app's 32-bit neighbor-color bitmap
+const uint32_t HW_COLORS = 32;
+
+inline uint32_t degree(uint32_t v) {
+   return csr_offset[v+1] - csr_offset[v];
+}
+
+// true if u is colored before v, and v sees its color
+inline bool before(uint32_t u, uint32_t v) {
+   uint32_t du = degree(u), dv = degree(v);
+   uint32_t tu = std::min(du, 255u), tv = std::min(dv, 255u);
+   bool ts_first = (tu > tv) || (tu == tv && u < v);
+   bool notifies = (du > dv) || (du == dv && u < v);
+   return ts_first && notifies;
+}
+
+// Lowest color not taken by a higher-priority neighbor of v. bits must hold
+// at least degree(v)/64 + 1 words.
+uint32_t greedy_color(uint32_t v, uint64_t* bits) {
+   uint32_t deg = degree(v);
+   uint32_t n_words = deg / 64 + 1;
+   memset(bits, 0, n_words * sizeof(uint64_t));
+   for (uint64_t e = csr_offset[v]; e < csr_offset[v+1]; e++) {
+      uint32_t u = csr_neighbors[e].n;
+      if (!before(u, v)) continue;
+      uint32_t c = csr_dist[u];
+      if (c <= deg) bits[c >> 6] |= 1ull << (c & 63);
+   }
+   for (uint32_t w = 0; w < n_words; w++) {
+      if (~bits[w]) return w * 64 + __builtin_ctzll(~bits[w]);
+   }
+   return deg; // unreachable: d neighbors can not take d+1 colors
+}
+
+} // namespace
+
+void ComputeColorReference() {
+   printf("Compute Reference (greedy coloring, %d threads)\n", n_threads);
+   double t_start = wall_time();
+
+   std::vector<uint32_t> pending(numV);
+   std::vector<std::vector<uint32_t>> next(n_threads);
+   std::vector<uint32_t> max_degree(n_threads, 0);
+   parallel_for(0, numV, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      for (uint32_t v = lo; v < hi; v++) {
+         uint32_t n = 0;
+         for (uint64_t e = csr_offset[v]; e < csr_offset[v+1]; e++) {
+            n += before(csr_neighbors[e].n, v);
+         }
+         pending[v] = n;
+         if (n == 0) next[t].push_back(v);
+         max_degree[t] = std::max(max_degree[t], degree(v));
+      }
+   });
+   uint32_t bitmap_words =
+      *std::max_element(max_degree.begin(), max_degree.end()) / 64 + 1;
+   std::vector<uint32_t> frontier;
+   for (auto& n : next) {
+      frontier.insert(frontier.end(), n.begin(), n.end());
+      n.clear();
+   }
+
+   uint64_t rounds = 0, serial_rounds = 0;
+   Barrier barrier(n_threads);
+   parallel_run([&](uint32_t t) {
+      std::vector<uint64_t> bits(bitmap_words);
+      while (true) {
+         // everyone reads the size before thread 0 may change the frontier
+         uint64_t n = frontier.size();
+         barrier.wait();
+         if (n == 0) break;
+         if (n < PARALLEL_ROUND) {
+            if (t == 0) {
+               // The other threads are waiting, so the counters need no
+               // atomics here.
+               uint64_t head = 0;
+               while (head < frontier.size() &&
+                     frontier.size() - head < PARALLEL_ROUND) {
+                  uint32_t v = frontier[head++];
+                  csr_dist[v] = greedy_color(v, bits.data());
+                  for (uint64_t e = csr_offset[v]; e < csr_offset[v+1]; e++) {
+                     uint32_t u = csr_neighbors[e].n;
+                     if (before(v, u) && --pending[u] == 0) frontier.push_back(u);
+                  }
+               }
+               frontier.erase(frontier.begin(), frontier.begin() + head);
+               serial_rounds++;
+            }
+         } else {
+            std::vector<uint32_t>& my = next[t];
+            for (uint64_t i = n * t / n_threads; i < n * (t+1) / n_threads; i++) {
+               uint32_t v = frontier[i];
+               csr_dist[v] = greedy_color(v, bits.data());
+               for (uint64_t e = csr_offset[v]; e < csr_offset[v+1]; e++) {
+                  uint32_t u = csr_neighbors[e].n;
+                  if (before(v, u) &&
+                        __atomic_sub_fetch(&pending[u], 1, __ATOMIC_RELAXED) == 0) {
+                     my.push_back(u);
+                  }
+               }
+            }
+            barrier.wait();
+            if (t == 0) {
+               frontier.clear();
+               for (auto& nt : next) {
+                  frontier.insert(frontier.end(), nt.begin(), nt.end());
+                  nt.clear();
+               }
+               rounds++;
+            }
+         }
+         barrier.wait();
+      }
+   });
+   double t_ref = wall_time() - t_start;
+
+   std::vector<uint32_t> max_color(n_threads, 0);
+   std::vector<uint64_t> over_hw(n_threads, 0), uncolored(n_threads, 0);
+   parallel_for(0, numV, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) {
+         if (csr_dist[v] == ~0u) {
+            uncolored[t]++;
+            continue;
+         }
+         max_color[t] = std::max(max_color[t], csr_dist[v]);
+         if (csr_dist[v] >= HW_COLORS) over_hw[t]++;
+      }
+   });
+   uint32_t n_colors = *std::max_element(max_color.begin(), max_color.end()) + 1;
+   uint64_t n_over = 0, n_uncolored = 0;
+   for (uint32_t t = 0; t < n_threads; t++) {
+      n_over += over_hw[t];
+      n_uncolored += uncolored[t];
+   }
+   if (n_uncolored) {
+      printf("ERROR: %lu vertices left uncolored\n", n_uncolored);
+      exit(1);
+   }
+
+   printf("Time taken :%f msec\n", t_ref * 1000);
+   printf("Colors %u (%lu parallel rounds, %lu serial drains)\n",
+         n_colors, rounds, serial_rounds);
+   if (n_over) {
+      printf("WARNING: %lu vertices have colors >= %u, beyond the app's neighbor-color bitmap\n",
+            n_over, HW_COLORS);
+   }
+}
+
+namespace {
+
+// Task types of riscv_code/color
+enum ColorTaskType { ENQUEUER, CALC_COLOR, NOTIFY_NEIGHBORS, RECEIVE_COLOR };
+
+struct ColorTask {
+   uint32_t ts;
+   uint32_t type;
+   uint32_t vid;
+   uint64_t arg; // enq_start of ENQUEUER and NOTIFY_NEIGHBORS
+};
+
+struct ColorTaskAfter {
+   bool operator()(const ColorTask& a, const ColorTask& b) const {
+      return a.ts > b.ts;
+   }
+};
+
+} // namespace
+
+void ProfileColorTasks() {
+   double t_start = wall_time();
+   std::priority_queue<ColorTask, std::vector<ColorTask>, ColorTaskAfter> pq;
+   // the runtime enqueues the first enqueuer
+   pq.push(ColorTask{0, ENQUEUER, 0, 0});
+   while (!pq.empty()) {
+      ColorTask task = pq.top();
+      pq.pop();
+      uint64_t before_size = pq.size();
+      switch (task.type) {
+         case ENQUEUER:
+            for (uint64_t v = task.arg; v < numV; v++) {
+               if (v == task.arg + 7) {
+                  pq.push(ColorTask{0, ENQUEUER, 0, v});
+                  break;
+               }
+               uint32_t deg = std::min(degree(v), 255u);
+               pq.push(ColorTask{(255 - deg) << 24 | (uint32_t) v << 1,
+                     CALC_COLOR, (uint32_t) v, 0});
+            }
+            break;
+         case CALC_COLOR:
+            pq.push(ColorTask{task.ts, NOTIFY_NEIGHBORS, task.vid, 0});
+            break;
+         case NOTIFY_NEIGHBORS: {
+            uint32_t v = task.vid;
+            uint64_t begin = csr_offset[v] + task.arg;
+            uint64_t end = csr_offset[v+1];
+            // as in the app, degree is what is left of the list
+            uint64_t deg = end - begin;
+            if (end > begin + 6) {
+               pq.push(ColorTask{task.ts, NOTIFY_NEIGHBORS, v, task.arg + 6});
+               end = begin + 6;
+            }
+            for (uint64_t e = begin; e < end; e++) {
+               uint32_t n = csr_neighbors[e].n;
+               uint64_t n_deg = degree(n);
+               if (n_deg < deg || (n_deg == deg && n > v)) {
+                  pq.push(ColorTask{task.ts, RECEIVE_COLOR, n, 0});
+               }
+            }
+            break;
+         }
+         case RECEIVE_COLOR:
+            break;
+      }
+      ProfileTask(task.ts, pq.size() - before_size, true, pq.size());
+   }
+   printf("Profiled color tasks in %.3f s\n", wall_time() - t_start);
+}
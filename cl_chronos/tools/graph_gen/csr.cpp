@@ -0,0 +1,290 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// CSR construction straight from an EdgeSource.
+//
+// Pass 1 reads every chunk and counts out-degrees, a prefix sum turns the
+// counts into csr_offset, and pass 2 reads the chunks again and scatters
+// each edge into its slot. Both passes bump per-vertex counters atomically,
+// so the slots within an adjacency list are filled in a thread-dependent
+// order; sorting each list afterwards makes the output deterministic.
+//
+// Note that the lists come out sorted by (neighbor, weight), not in input
+// order as the old per-vertex builder left them. Images of the same graph
+// therefore differ from the ones written before this builder in the
+// neighbor section (and in the per-edge data that follows it), though the
+// graphs, offsets and ground truth are the same.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+const uint32_t EDGE_LIST_CHUNK = 1 << 20;
+
+template <typename T>
+inline T fetch_inc(T* p) {
+   return __atomic_fetch_add(p, 1, __ATOMIC_RELAXED);
+}
+
+inline bool adj_less(const Adj& a, const Adj& b) {
+   return (a.n < b.n) || (a.n == b.n && a.d_cm < b.d_cm);
+}
+
+inline void check_edge(const Edge& e) {
+   if (e.src >= numV || e.dst >= numV) {
+      printf("ERROR: edge %u -> %u out of range (%u nodes)\n",
+            e.src, e.dst, numV);
+      exit(1);
+   }
+}
+
+// Parallel edges (and an edge together with the reverse of an antiparallel
+// one) end up next to each other after sorting; fold them into one residual
+// edge. Lists only ever shrink, so this compacts in place.
+void MergeParallelEdges() {
+   std::vector<uint64_t> dups(n_threads, 0);
+   parallel_for(0, numV, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) {
+         for (uint64_t i = csr_offset[v] + 1; i < csr_offset[v+1]; i++) {
+            if (csr_neighbors[i].n == csr_neighbors[i-1].n) dups[t]++;
+         }
+      }
+   });
+   uint64_t n_dups = 0;
+   for (uint64_t d : dups) n_dups += d;
+   if (n_dups == 0) return;
+
+   uint64_t out = 0;
+   uint64_t begin = csr_offset[0];
+   for (uint32_t v = 0; v < numV; v++) {
+      uint64_t end = csr_offset[v+1];
+      csr_offset[v] = out;
+      for (uint64_t i = begin; i < end; i++) {
+         if (out > csr_offset[v] && csr_neighbors[out-1].n == csr_neighbors[i].n) {
+            csr_neighbors[out-1].d_cm += csr_neighbors[i].d_cm;
+         } else {
+            csr_neighbors[out++] = csr_neighbors[i];
+         }
+      }
+      begin = end;
+   }
+   csr_offset[numV] = out;
+   numE = out;
+   csr_neighbors = (Adj*) realloc(csr_neighbors, sizeof(Adj) * numE);
+   printf("Merged %lu parallel edges\n", n_dups);
+}
+
+} // namespace
+
+// index of an edge u->v is the position of v->u within v's list
+void ComputeReverseIndex() {
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint32_t u = lo; u < hi; u++) {
+         for (uint64_t i = csr_offset[u]; i < csr_offset[u+1]; i++) {
+            uint32_t v = csr_neighbors[i].n;
+            Adj* begin = csr_neighbors + csr_offset[v];
+            Adj* end = csr_neighbors + csr_offset[v+1];
+            Adj* r = std::lower_bound(begin, end, u,
+                  [](const Adj& a, uint32_t n) { return a.n < n; });
+            csr_neighbors[i].index = r - begin;
+         }
+      }
+   });
+}
+
+uint32_t EdgeListSource::NumChunks() const {
+   return (edges.size() + EDGE_LIST_CHUNK - 1) / EDGE_LIST_CHUNK;
+}
+
+void EdgeListSource::ReadChunk(uint32_t chunk, const EdgeSink& sink) const {
+   uint64_t lo = (uint64_t) chunk * EDGE_LIST_CHUNK;
+   uint64_t hi = std::min(lo + EDGE_LIST_CHUNK, (uint64_t) edges.size());
+   sink(edges.data() + lo, hi - lo);
+}
+
+void BuildCSR(const EdgeSource& edges, bool residual) {
+   double t_start = wall_time();
+   uint32_t n_chunks = edges.NumChunks();
+
+   // Pass 1: degrees
+   csr_offset = (uint64_t*) calloc(numV + 1, sizeof(uint64_t));
+   parallel_tasks(n_chunks, [&](uint32_t, uint32_t c) {
+      edges.ReadChunk(c, [&](const Edge* e, uint32_t n) {
+         for (uint32_t i = 0; i < n; i++) {
+            check_edge(e[i]);
+            fetch_inc(&csr_offset[e[i].src]);
+            if (residual) fetch_inc(&csr_offset[e[i].dst]);
+         }
+      });
+   });
+   numE = parallel_prefix_sum(csr_offset, numV);
+
+   // Pass 2: scatter
+   csr_neighbors = (Adj*) malloc(sizeof(Adj) * numE);
+   uint64_t* cursor = (uint64_t*) malloc(sizeof(uint64_t) * numV);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) cursor[v] = csr_offset[v];
+   });
+   parallel_tasks(n_chunks, [&](uint32_t, uint32_t c) {
+      edges.ReadChunk(c, [&](const Edge* e, uint32_t n) {
+         for (uint32_t i = 0; i < n; i++) {
+            Adj a = {e[i].dst, e[i].w, 0};
+            csr_neighbors[fetch_inc(&cursor[e[i].src])] = a;
+            if (residual) {
+               Adj r = {e[i].src, 0, 0};
+               csr_neighbors[fetch_inc(&cursor[e[i].dst])] = r;
+            }
+         }
+      });
+   });
+   free(cursor);
+
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) {
+         std::sort(csr_neighbors + csr_offset[v],
+               csr_neighbors + csr_offset[v+1], adj_less);
+      }
+   });
+
+   if (residual) {
+      MergeParallelEdges();
+      ComputeReverseIndex();
+   }
+
+   csr_dist = (uint32_t*) malloc(sizeof(uint32_t) * numV);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) csr_dist[v] = ~0;
+   });
+
+   printf("Read %d nodes, %lu adjacencies\n", numV, numE);
+   printf("Built CSR in %.3f s (%d threads)\n", wall_time() - t_start, n_threads);
+}
+
+void PermuteCSR(const uint32_t* new_id, bool residual) {
+   uint64_t* offset = (uint64_t*) malloc(sizeof(uint64_t) * (numV+1));
+   Adj* neighbors = (Adj*) malloc(sizeof(Adj) * numE);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) {
+         offset[new_id[v]] = csr_offset[v+1] - csr_offset[v];
+      }
+   });
+   parallel_prefix_sum(offset, numV);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) {
+         Adj* out = neighbors + offset[new_id[v]];
+         uint64_t deg = csr_offset[v+1] - csr_offset[v];
+         for (uint64_t i = 0; i < deg; i++) {
+            out[i] = csr_neighbors[csr_offset[v] + i];
+            out[i].n = new_id[out[i].n];
+         }
+         std::sort(out, out + deg, adj_less);
+      }
+   });
+   FreeCSRArray(csr_offset);
+   FreeCSRArray(csr_neighbors);
+   csr_offset = offset;
+   csr_neighbors = neighbors;
+   if (residual) ComputeReverseIndex();
+
+   if (vertex_lat) {
+      double* lat = (double*) malloc(sizeof(double) * numV);
+      double* lon = (double*) malloc(sizeof(double) * numV);
+      parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+         for (uint64_t v = lo; v < hi; v++) {
+            lat[new_id[v]] = vertex_lat[v];
+            lon[new_id[v]] = vertex_lon[v];
+         }
+      });
+      free(vertex_lat);
+      free(vertex_lon);
+      vertex_lat = lat;
+      vertex_lon = lon;
+   }
+
+   startNode = new_id[startNode];
+   if (endNode < numV) endNode = new_id[endNode];
+}
+
+// Symmetrization for color: every edge u->v becomes u-v in both lists, with
+// duplicates removed. Both directions are packed as (src << bits | dst)
+// keys, radix sorted, and deduplicated; the sorted keys are then the
+// adjacency lists in order.
+void makeUndirectional() {
+   double t_start = wall_time();
+   uint32_t bits = 1;
+   while (bits < 32 && (1ull << bits) < numV) bits++;
+   uint64_t mask = (1ull << bits) - 1;
+   uint64_t n_keys = 2 * (uint64_t) numE;
+
+   uint64_t* keys = (uint64_t*) malloc(sizeof(uint64_t) * n_keys);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t u = lo; u < hi; u++) {
+         for (uint64_t i = csr_offset[u]; i < csr_offset[u+1]; i++) {
+            uint64_t v = csr_neighbors[i].n;
+            keys[2*(uint64_t)i] = u << bits | v;
+            keys[2*(uint64_t)i+1] = v << bits | u;
+         }
+      }
+   });
+   FreeCSRArray(csr_neighbors);
+   uint64_t* tmp = (uint64_t*) malloc(sizeof(uint64_t) * n_keys);
+   parallel_radix_sort(keys, tmp, n_keys, 2 * bits);
+
+   // Compact the unique keys into tmp
+   std::vector<uint64_t> n_unique(n_threads + 1, 0);
+   auto is_unique = [&](uint64_t i) { return i == 0 || keys[i] != keys[i-1]; };
+   parallel_for(0, n_keys, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      for (uint64_t i = lo; i < hi; i++) n_unique[t+1] += is_unique(i);
+   });
+   for (uint32_t t = 0; t < n_threads; t++) n_unique[t+1] += n_unique[t];
+   uint64_t total = n_unique[n_threads];
+   parallel_for(0, n_keys, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      uint64_t out = n_unique[t];
+      for (uint64_t i = lo; i < hi; i++) {
+         if (is_unique(i)) tmp[out++] = keys[i];
+      }
+   });
+   free(keys);
+
+   // csr_offset[u] is the first key with src >= u
+   numE = total;
+   csr_neighbors = (Adj*) malloc(sizeof(Adj) * numE);
+   parallel_for(0, numE, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t i = lo; i < hi; i++) {
+         Adj a = {(uint32_t) (tmp[i] & mask), 0, 0};
+         csr_neighbors[i] = a;
+         uint64_t src = tmp[i] >> bits;
+         uint64_t prev = (i == 0) ? 0 : (tmp[i-1] >> bits) + 1;
+         for (uint64_t u = prev; u <= src; u++) csr_offset[u] = i;
+      }
+   });
+   uint64_t last = numE ? (tmp[numE-1] >> bits) + 1 : 0;
+   for (uint64_t u = last; u <= numV; u++) csr_offset[u] = numE;
+   free(tmp);
+
+   printf("Undirected: %lu adjacencies in %.3f s\n", numE, wall_time() - t_start);
+}
@@ -0,0 +1,315 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Out-of-core CSR construction (--mem-limit), for edge lists that do not fit
+// in host memory along with their CSR.
+//
+// Pass 1 reads the EdgeSource once. Each thread collects edges in a buffer
+// of its share of half the limit; a full buffer is sorted by (src, dst, w)
+// and appended to a scratch file as a run, together with where each of the
+// MERGE_PARTS vertex ranges starts in it. Degrees are counted on the way, so
+// csr_offset is known once the input has been read.
+//
+// Pass 2 k-way merges the runs, one vertex range per task, into
+// csr_neighbors. This is a shared mapping of a second scratch file rather
+// than malloc'd memory: it is written sequentially, and the kernel writes
+// back and drops its pages as needed, so the references and the image
+// writers read it like the in-memory CSR. Only csr_offset, csr_dist and the
+// per-vertex state of the references stay resident.
+//
+// For color the runs hold both directions of every edge and the merge drops
+// duplicates, which is what makeUndirectional does in memory; the vertex
+// ranges are then compacted. Scratch files are unlinked as soon as they are
+// created, so nothing is left behind if graph_gen is killed.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <queue>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+uint64_t mem_limit = 0;
+const char* scratch_dir = ".";
+
+namespace {
+
+const uint32_t MERGE_PARTS = 256;
+// smallest run and merge buffers, in edges
+const uint64_t MIN_BUFFER = 1 << 12;
+
+struct Run {
+   uint64_t pos; // first edge in the run file
+   uint64_t n;
+   uint64_t part[MERGE_PARTS + 1]; // start of each vertex range in the run
+};
+
+inline bool edge_less(const Edge& a, const Edge& b) {
+   if (a.src != b.src) return a.src < b.src;
+   if (a.dst != b.dst) return a.dst < b.dst;
+   return a.w < b.w;
+}
+
+inline uint32_t part_begin(uint32_t p) {
+   return (uint64_t) numV * p / MERGE_PARTS;
+}
+
+int ScratchFile(const char* what) {
+   std::string name = std::string(scratch_dir) + "/graph_gen_" + what + "_XXXXXX";
+   int fd = mkstemp(&name[0]);
+   if (fd < 0) {
+      printf("ERROR: Could not create a scratch file in %s\n", scratch_dir);
+      exit(1);
+   }
+   unlink(name.c_str());
+   return fd;
+}
+
+void WriteAll(int fd, const void* buf, uint64_t size, uint64_t pos) {
+   const char* p = (const char*) buf;
+   while (size > 0) {
+      ssize_t n = pwrite(fd, p, size, pos);
+      if (n <= 0) {
+         printf("ERROR: Could not write %lu bytes to the scratch file in %s\n",
+               size, scratch_dir);
+         exit(1);
+      }
+      p += n;
+      pos += n;
+      size -= n;
+   }
+}
+
+void ReadAll(int fd, void* buf, uint64_t size, uint64_t pos) {
+   char* p = (char*) buf;
+   while (size > 0) {
+      ssize_t n = pread(fd, p, size, pos);
+      if (n <= 0) {
+         printf("ERROR: Could not read the scratch file\n");
+         exit(1);
+      }
+      p += n;
+      pos += n;
+      size -= n;
+   }
+}
+
+// Sorted runs, appended concurrently to one scratch file
+class RunWriter {
+   int fd;
+   std::mutex m;
+   uint64_t end;
+  public:
+   std::vector<Run> runs;
+
+   RunWriter() : fd(ScratchFile("runs")), end(0) {}
+   ~RunWriter() { close(fd); }
+   int file() const { return fd; }
+   uint64_t size() const { return end; }
+
+   void Flush(std::vector<Edge>& buf) {
+      if (buf.empty()) return;
+      std::sort(buf.begin(), buf.end(), edge_less);
+      Run r;
+      r.n = buf.size();
+      for (uint32_t p = 0; p <= MERGE_PARTS; p++) {
+         Edge key = {p == MERGE_PARTS ? numV : part_begin(p), 0, 0};
+         r.part[p] = std::lower_bound(buf.begin(), buf.end(), key, edge_less)
+            - buf.begin();
+      }
+      {
+         std::lock_guard<std::mutex> lock(m);
+         r.pos = end;
+         end += r.n;
+         runs.push_back(r);
+      }
+      WriteAll(fd, buf.data(), r.n * sizeof(Edge), r.pos * sizeof(Edge));
+      buf.clear();
+   }
+};
+
+// One run's slice of a vertex range, read through a buffer
+struct RunReader {
+   int fd;
+   uint64_t next; // next edge to read from the file
+   uint64_t end;
+   std::vector<Edge> buf;
+   uint32_t cur;
+
+   bool Refill() {
+      uint64_t n = std::min((uint64_t) buf.capacity(), end - next);
+      if (n == 0) return false;
+      buf.resize(n);
+      ReadAll(fd, buf.data(), n * sizeof(Edge), next * sizeof(Edge));
+      next += n;
+      cur = 0;
+      return true;
+   }
+   const Edge& Head() const { return buf[cur]; }
+   bool Advance() { return ++cur < buf.size() || Refill(); }
+};
+
+} // namespace
+
+void BuildCSRExternal(const EdgeSource& edges, bool undirected) {
+   double t_start = wall_time();
+   uint32_t n_chunks = edges.NumChunks();
+
+   // csr_offset and csr_dist are the resident part of the CSR
+   uint64_t resident = (sizeof(uint64_t) + sizeof(uint32_t)) * ((uint64_t) numV + 1);
+   if (mem_limit < resident + 2 * n_threads * MIN_BUFFER * sizeof(Edge)) {
+      printf("ERROR: --mem-limit=%lu is too small for %u nodes on %u threads\n",
+            mem_limit, numV, n_threads);
+      exit(1);
+   }
+   uint64_t budget = (mem_limit - resident) / 2;
+
+   // Pass 1: sorted runs and degrees
+   csr_offset = (uint64_t*) calloc(numV + 1, sizeof(uint64_t));
+   uint64_t run_edges = budget / sizeof(Edge) / n_threads;
+   std::vector<std::vector<Edge>> bufs(n_threads);
+   RunWriter writer;
+   parallel_tasks(n_chunks, [&](uint32_t t, uint32_t c) {
+      std::vector<Edge>& buf = bufs[t];
+      if (buf.capacity() == 0) buf.reserve(run_edges);
+      edges.ReadChunk(c, [&](const Edge* e, uint32_t n) {
+         for (uint32_t i = 0; i < n; i++) {
+            if (e[i].src >= numV || e[i].dst >= numV) {
+               printf("ERROR: edge %u -> %u out of range (%u nodes)\n",
+                     e[i].src, e[i].dst, numV);
+               exit(1);
+            }
+            if (undirected) {
+               Edge a = {e[i].src, e[i].dst, 0};
+               Edge b = {e[i].dst, e[i].src, 0};
+               buf.push_back(a);
+               if (buf.size() == run_edges) writer.Flush(buf);
+               buf.push_back(b);
+               __atomic_fetch_add(&csr_offset[a.src], 1, __ATOMIC_RELAXED);
+               __atomic_fetch_add(&csr_offset[b.src], 1, __ATOMIC_RELAXED);
+            } else {
+               buf.push_back(e[i]);
+               __atomic_fetch_add(&csr_offset[e[i].src], 1, __ATOMIC_RELAXED);
+            }
+            if (buf.size() == run_edges) writer.Flush(buf);
+         }
+      });
+   });
+   parallel_tasks(n_threads, [&](uint32_t, uint32_t t) {
+      writer.Flush(bufs[t]);
+      std::vector<Edge>().swap(bufs[t]);
+   });
+   uint64_t n_adj = writer.size();
+   numE = parallel_prefix_sum(csr_offset, numV);
+   uint32_t n_runs = writer.runs.size();
+   printf("Wrote %u sorted runs (%.1f MB) in %.3f s\n", n_runs,
+         n_adj * sizeof(Edge) / 1e6, wall_time() - t_start);
+
+   // The CSR is a shared mapping of a (sparse) scratch file of the
+   // pre-merge size
+   int csr_fd = ScratchFile("csr");
+   uint64_t csr_size = std::max(n_adj, (uint64_t) 1) * sizeof(Adj);
+   if (ftruncate(csr_fd, csr_size) != 0) {
+      printf("ERROR: Could not resize the scratch CSR in %s to %lu bytes\n",
+            scratch_dir, csr_size);
+      exit(1);
+   }
+   csr_neighbors = (Adj*) mmap(NULL, csr_size, PROT_READ | PROT_WRITE,
+         MAP_SHARED, csr_fd, 0);
+   close(csr_fd);
+   if (csr_neighbors == MAP_FAILED) {
+      printf("ERROR: Could not mmap the scratch CSR\n");
+      exit(1);
+   }
+
+   // Pass 2: merge each vertex range. Without duplicates (undirected only)
+   // the merged edges land exactly at csr_offset.
+   double t_merge = wall_time();
+   uint64_t merge_edges = std::max(MIN_BUFFER,
+         budget / sizeof(Edge) / n_threads / std::max(n_runs, 1u));
+   uint64_t* degree = undirected ? (uint64_t*) calloc(numV, sizeof(uint64_t)) : NULL;
+   std::vector<uint64_t> part_end(MERGE_PARTS);
+   parallel_tasks(MERGE_PARTS, [&](uint32_t, uint32_t p) {
+      std::vector<RunReader> readers(n_runs);
+      auto greater = [&](uint32_t a, uint32_t b) {
+         return edge_less(readers[b].Head(), readers[a].Head());
+      };
+      std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(greater)> heap(greater);
+      for (uint32_t r = 0; r < n_runs; r++) {
+         RunReader& rd = readers[r];
+         rd.fd = writer.file();
+         rd.next = writer.runs[r].pos + writer.runs[r].part[p];
+         rd.end = writer.runs[r].pos + writer.runs[r].part[p+1];
+         rd.buf.reserve(std::min(merge_edges, rd.end - rd.next));
+         if (rd.Refill()) heap.push(r);
+      }
+      uint64_t out = csr_offset[part_begin(p)];
+      Edge last = {~0u, ~0u, 0};
+      while (!heap.empty()) {
+         uint32_t r = heap.top();
+         heap.pop();
+         Edge e = readers[r].Head();
+         if (readers[r].Advance()) heap.push(r);
+         if (undirected) {
+            if (e.src == last.src && e.dst == last.dst) continue;
+            degree[e.src]++;
+            last = e;
+         }
+         Adj a = {e.dst, e.w, 0};
+         csr_neighbors[out++] = a;
+      }
+      part_end[p] = out;
+   });
+
+   if (undirected) {
+      // Slide each range down over the duplicates it dropped, in order
+      uint64_t* old_offset = csr_offset;
+      csr_offset = degree;
+      csr_offset = (uint64_t*) realloc(csr_offset, sizeof(uint64_t) * (numV + 1));
+      numE = parallel_prefix_sum(csr_offset, numV);
+      for (uint32_t p = 0; p < MERGE_PARTS; p++) {
+         uint64_t from = old_offset[part_begin(p)];
+         uint64_t to = csr_offset[part_begin(p)];
+         if (from != to) {
+            memmove(csr_neighbors + to, csr_neighbors + from,
+                  (part_end[p] - from) * sizeof(Adj));
+         }
+      }
+      free(old_offset);
+   }
+   printf("Merged %u runs in %.3f s\n", n_runs, wall_time() - t_merge);
+
+   csr_dist = (uint32_t*) malloc(sizeof(uint32_t) * numV);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) csr_dist[v] = ~0;
+   });
+
+   printf("Read %d nodes, %lu adjacencies\n", numV, numE);
+   printf("Built CSR out of core in %.3f s (%d threads, %.1f MB memory limit)\n",
+         wall_time() - t_start, n_threads, mem_limit / 1e6);
+}
@@ -0,0 +1,311 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Edge-list readers, picked by file extension:
+//  .mtx   - Matrix Market coordinate format. numV is max(rows, cols) from the
+//           size line and ids are 1-based; symmetric matrices give both
+//           directions of every off-diagonal entry.
+//  .bel   - raw binary, little-endian uint32 (src, dst) pairs
+//  .bwel  - raw binary, uint32 (src, dst, weight) triples
+//  other  - SNAP-style text, one 'src dst [weight]' per line. Lines that do
+//           not start with a digit ('#' comments, an 'EdgeArray' header)
+//           are skipped.
+// Missing weights are 1; Matrix Market real values are rounded.
+//
+// Like the .gr reader the file is mmap'd and split into chunks that are
+// parsed in parallel, and edges are only produced when BuildCSR reads the
+// source. The vertex count of SNAP and binary inputs comes from a first
+// pass, and the ids that actually occur are compacted to 0..numV-1 in
+// increasing order (a 1-based list just shifts down by one). The id map is a
+// bitmap with a per-word rank, about 1.5 bits per possible id.
+
+#include "graph_gen.h"
+#include "parallel.h"
+#include "text_util.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace {
+
+const uint64_t EL_CHUNK_SIZE = 8 << 20;
+const uint32_t EL_BATCH = 4096;
+// bitmap for ids below this is at most 4 GB
+const uint64_t MAX_SPARSE_ID = 1ull << 35;
+
+enum Format { EL_TEXT, EL_MTX, EL_BINARY };
+
+struct ELChunk {
+   const char* begin;
+   const char* end;
+   uint64_t n_edges;
+   uint64_t max_id;
+};
+
+inline bool ends_with(const char* s, const char* suffix) {
+   size_t n = strlen(s), m = strlen(suffix);
+   return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+class EdgeListFile : public EdgeSource {
+  public:
+   MappedFile file;
+   Format format;
+   uint32_t record_words; // binary: 2 or 3
+   bool mtx_real;
+   bool mtx_symmetric;
+   std::vector<ELChunk> chunks;
+
+   // Compaction map; empty if ids are used as they are
+   std::vector<uint64_t> used;
+   std::vector<uint32_t> used_rank; // set bits in used[0..i)
+
+   // Calls fn(src, dst, w) for every entry in the chunk, with ids as in the
+   // file (0-based for .mtx)
+   template <typename F>
+   void ForEachEntry(const ELChunk& c, F fn) const {
+      if (format == EL_BINARY) {
+         const uint32_t* r = (const uint32_t*) c.begin;
+         const uint32_t* end = (const uint32_t*) c.end;
+         for (; r + record_words <= end; r += record_words) {
+            fn(r[0], r[1], (record_words == 3) ? r[2] : 1);
+         }
+         return;
+      }
+      const char* p = c.begin;
+      while (p < c.end) {
+         const char* eol = next_line(p, c.end);
+         const char* q = skip_blanks(p, eol);
+         if (q < eol && is_digit(*q)) {
+            uint64_t src, dst;
+            q = parse_uint64(q, eol, &src);
+            q = parse_uint64(q, eol, &dst);
+            uint32_t w = 1;
+            q = skip_blanks(q, eol);
+            if (q < eol && (is_digit(*q) || *q == '-' || *q == '.')) {
+               if (mtx_real) {
+                  double v;
+                  parse_double(q, eol, &v);
+                  w = (uint32_t) lround(fabs(v));
+               } else {
+                  parse_uint(q, eol, &w);
+               }
+            }
+            if (format == EL_MTX) {
+               if (src == 0 || dst == 0) {
+                  printf("ERROR: Matrix Market entry %lu %lu is not 1-based\n",
+                        src, dst);
+                  exit(1);
+               }
+               src--;
+               dst--;
+               fn(src, dst, w);
+               if (mtx_symmetric && src != dst) fn(dst, src, w);
+            } else {
+               fn(src, dst, w);
+            }
+         }
+         p = eol;
+      }
+   }
+
+   inline uint32_t Map(uint64_t id) const {
+      if (used.empty()) return id;
+      uint64_t word = id >> 6;
+      uint64_t below = used[word] & ((1ull << (id & 63)) - 1);
+      return used_rank[word] + __builtin_popcountll(below);
+   }
+
+   uint32_t NumChunks() const { return chunks.size(); }
+   uint64_t InputBytes() const { return file.size; }
+
+   void ReadChunk(uint32_t i, const EdgeSink& sink) const {
+      Edge batch[EL_BATCH];
+      uint32_t n = 0;
+      ForEachEntry(chunks[i], [&](uint64_t src, uint64_t dst, uint32_t w) {
+         batch[n].src = Map(src);
+         batch[n].dst = Map(dst);
+         batch[n].w = w;
+         if (++n == EL_BATCH) {
+            sink(batch, n);
+            n = 0;
+         }
+      });
+      if (n) sink(batch, n);
+   }
+
+   // Splits [begin, end) into chunks; text chunks start at line boundaries,
+   // binary ones at record boundaries.
+   void Split(const char* begin, const char* end) {
+      uint64_t size = end - begin;
+      uint64_t step = EL_CHUNK_SIZE;
+      if (format == EL_BINARY) step -= step % (4 * record_words);
+      uint32_t n_chunks = std::max<uint64_t>(1, (size + step - 1) / step);
+      chunks.resize(n_chunks);
+      for (uint32_t i = 0; i < n_chunks; i++) {
+         ELChunk& c = chunks[i];
+         memset(&c, 0, sizeof(ELChunk));
+         if (i == 0) c.begin = begin;
+         else if (format == EL_BINARY) c.begin = begin + i * step;
+         else c.begin = next_line(begin + i * step - 1, end);
+         if (i > 0) chunks[i-1].end = c.begin;
+      }
+      chunks[n_chunks-1].end = end;
+   }
+
+   // '%%MatrixMarket matrix coordinate <field> <symmetry>', '%' comments,
+   // then 'rows cols nnz'. Returns the start of the entries.
+   const char* ReadMtxHeader(const char* file_name) {
+      const char* p = file.data;
+      const char* end = file.data + file.size;
+      const char* eol = next_line(p, end);
+      std::string banner(p, eol - p);
+      for (char& ch : banner) ch = tolower(ch);
+      if (banner.compare(0, 14, "%%matrixmarket") != 0 ||
+            banner.find("coordinate") == std::string::npos) {
+         printf("ERROR: %s is not a Matrix Market coordinate file\n", file_name);
+         exit(1);
+      }
+      if (banner.find("complex") != std::string::npos) {
+         printf("ERROR: complex Matrix Market files are not supported\n");
+         exit(1);
+      }
+      mtx_real = banner.find("real") != std::string::npos;
+      mtx_symmetric = banner.find("general") == std::string::npos;
+      p = eol;
+      while (p < end && p[0] == '%') p = next_line(p, end);
+      uint32_t rows, cols;
+      uint64_t nnz;
+      eol = next_line(p, end);
+      p = parse_uint(p, eol, &rows);
+      p = parse_uint(p, eol, &cols);
+      parse_uint64(p, eol, &nnz);
+      numV = std::max(rows, cols);
+      printf("Matrix Market: %u x %u, %lu entries%s\n", rows, cols, nnz,
+            mtx_symmetric ? " (symmetric)" : "");
+      return eol;
+   }
+
+   // Marks the ids that occur and ranks them
+   void Compact(uint64_t max_id) {
+      if (max_id >= MAX_SPARSE_ID) {
+         printf("ERROR: vertex id %lu too large\n", max_id);
+         exit(1);
+      }
+      uint64_t n_words = max_id / 64 + 1;
+      used.assign(n_words, 0);
+      uint64_t* bits = used.data();
+      parallel_tasks(chunks.size(), [&](uint32_t, uint32_t i) {
+         ForEachEntry(chunks[i], [&](uint64_t src, uint64_t dst, uint32_t) {
+            __atomic_fetch_or(&bits[src >> 6], 1ull << (src & 63), __ATOMIC_RELAXED);
+            __atomic_fetch_or(&bits[dst >> 6], 1ull << (dst & 63), __ATOMIC_RELAXED);
+         });
+      });
+      std::vector<uint64_t> rank(n_words + 1);
+      parallel_for(0, n_words, [&](uint32_t, uint64_t lo, uint64_t hi) {
+         for (uint64_t w = lo; w < hi; w++) rank[w] = __builtin_popcountll(bits[w]);
+      });
+      uint64_t n = parallel_prefix_sum(rank.data(), n_words);
+      if (n >= (1ull << 32)) {
+         printf("ERROR: %lu vertices do not fit in 32-bit ids\n", n);
+         exit(1);
+      }
+      numV = n;
+      if (numV == max_id + 1) {
+         // already dense
+         used.clear();
+         return;
+      }
+      used_rank.resize(n_words);
+      parallel_for(0, n_words, [&](uint32_t, uint64_t lo, uint64_t hi) {
+         for (uint64_t w = lo; w < hi; w++) used_rank[w] = rank[w];
+      });
+   }
+};
+
+} // namespace
+
+EdgeSource* LoadGraphEdgeList(const char* file) {
+   EdgeListFile* src = new EdgeListFile();
+   double t_start = wall_time();
+   src->file.open(file);
+   src->record_words = 2;
+   src->mtx_real = false;
+   src->mtx_symmetric = false;
+   const char* begin = src->file.data;
+   const char* end = src->file.data + src->file.size;
+   if (ends_with(file, ".mtx")) {
+      src->format = EL_MTX;
+      begin = src->ReadMtxHeader(file);
+   } else if (ends_with(file, ".bel") || ends_with(file, ".bwel")) {
+      src->format = EL_BINARY;
+      src->record_words = ends_with(file, ".bwel") ? 3 : 2;
+      if (src->file.size % (4 * src->record_words)) {
+         printf("ERROR: %s is not a whole number of %u-byte records\n",
+               file, 4 * src->record_words);
+         exit(1);
+      }
+   } else {
+      src->format = EL_TEXT;
+   }
+   src->Split(begin, end);
+
+   std::vector<ELChunk>& chunks = src->chunks;
+   parallel_tasks(chunks.size(), [&](uint32_t, uint32_t i) {
+      ELChunk& c = chunks[i];
+      src->ForEachEntry(c, [&](uint64_t s, uint64_t d, uint32_t) {
+         c.n_edges++;
+         c.max_id = std::max(c.max_id, std::max(s, d));
+      });
+   });
+   uint64_t n_edges = 0, max_id = 0;
+   for (const ELChunk& c : chunks) {
+      n_edges += c.n_edges;
+      max_id = std::max(max_id, c.max_id);
+   }
+   if (n_edges == 0) {
+      printf("ERROR: No edges in %s\n", file);
+      exit(1);
+   }
+
+   if (src->format == EL_MTX) {
+      if (max_id >= numV) {
+         printf("ERROR: entry index %lu beyond the %u x %u size line\n",
+               max_id + 1, numV, numV);
+         exit(1);
+      }
+   } else {
+      src->Compact(max_id);
+   }
+   numE = n_edges;
+
+   double t = wall_time() - t_start;
+   printf("Edge list: %lu edges, %d nodes (max id %lu)\n", n_edges, numV, max_id);
+   printf("Scanned %.1f MB in %.3f s (%.1f MB/s, %d threads)\n",
+         src->file.size / 1e6, t, src->file.size / 1e6 / t, n_threads);
+   return src;
+}
@@ -0,0 +1,408 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Synthetic graph generators.
+//
+// Random numbers come from a counter-based generator: rng(stream, i) is a
+// hash of (gen_seed, stream, i), so every edge is a pure function of its
+// index. Chunks can then be generated by any thread, any number of times,
+// and the graph only depends on the seed.
+//  rmat    - R-MAT / Kronecker (Graph500 parameters), vertex ids scrambled
+//  rgg     - 2D random geometric graph in the unit square (road-like)
+//  chunglu - Chung-Lu graph with power-law expected degrees
+//  grid    - (flow) r x c layers, each node linked to k random nodes of the
+//            next row
+//  genrmf  - (flow) Goldfarb-Grigoriadis RMF networks: b frames of a x a
+//            grids, consecutive frames joined by a random permutation
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+uint64_t gen_seed = 1;
+
+namespace {
+
+const uint64_t GEN_CHUNK = 1 << 20;
+const uint32_t GEN_BATCH = 4096;
+const uint32_t MAX_WEIGHT = 255;
+
+enum { STREAM_RMAT, STREAM_WEIGHT, STREAM_POINT, STREAM_CHUNGLU,
+   STREAM_FLOW_GRID, STREAM_GENRMF };
+
+inline uint64_t mix64(uint64_t x) {
+   // splitmix64 finalizer
+   x ^= x >> 30;
+   x *= 0xbf58476d1ce4e5b9ull;
+   x ^= x >> 27;
+   x *= 0x94d049bb133111ebull;
+   x ^= x >> 31;
+   return x;
+}
+
+inline uint64_t rng(uint64_t stream, uint64_t i) {
+   return mix64(mix64(gen_seed * 0x9e3779b97f4a7c15ull + stream) + i);
+}
+
+// uniform in [0, 1)
+inline double rng_double(uint64_t stream, uint64_t i) {
+   return (rng(stream, i) >> 11) * (1.0 / (1ull << 53));
+}
+
+inline uint32_t rng_weight(uint64_t i) {
+   return 1 + rng(STREAM_WEIGHT, i) % MAX_WEIGHT;
+}
+
+// Batches edges from a generator loop into sink calls
+class Emitter {
+   const EdgeSink& sink;
+   Edge batch[GEN_BATCH];
+   uint32_t n;
+  public:
+   explicit Emitter(const EdgeSink& sink) : sink(sink), n(0) {}
+   ~Emitter() { if (n) sink(batch, n); }
+   void emit(uint32_t src, uint32_t dst, uint32_t w) {
+      batch[n].src = src;
+      batch[n].dst = dst;
+      batch[n].w = w;
+      if (++n == GEN_BATCH) {
+         sink(batch, n);
+         n = 0;
+      }
+   }
+};
+
+class RMATSource : public EdgeSource {
+   uint32_t scale;
+   uint64_t n_edges;
+   uint64_t mask;
+
+   // A bijection on [0, 2^scale), so that hubs are not all at low ids
+   uint64_t scramble(uint64_t x) const {
+      x = (x * 0x9e3779b1ull) & mask;
+      x ^= x >> (scale / 2 + 1);
+      x = (x * 0x85ebca6bull) & mask;
+      x ^= x >> (scale / 3 + 1);
+      return x;
+   }
+
+  public:
+   RMATSource(uint32_t scale, uint64_t n_edges) :
+      scale(scale), n_edges(n_edges), mask((1ull << scale) - 1) {}
+
+   uint32_t NumChunks() const { return (n_edges + GEN_CHUNK - 1) / GEN_CHUNK; }
+
+   void ReadChunk(uint32_t c, const EdgeSink& sink) const {
+      // Graph500 quadrant probabilities
+      const uint32_t A = 0.57 * 65536, B = 0.19 * 65536, C = 0.19 * 65536;
+      Emitter out(sink);
+      uint64_t end = std::min(n_edges, (c + 1) * GEN_CHUNK);
+      for (uint64_t i = c * GEN_CHUNK; i < end; i++) {
+         uint64_t src = 0, dst = 0, bits = 0;
+         for (uint32_t l = 0; l < scale; l++) {
+            // 16 random bits per level, 4 levels per draw
+            if (l % 4 == 0) bits = rng(STREAM_RMAT, i * 8 + l / 4);
+            uint32_t r = bits & 0xffff;
+            bits >>= 16;
+            uint32_t s = (r >= A + B);
+            uint32_t d = (r >= A && r < A + B) || (r >= A + B + C);
+            src = src << 1 | s;
+            dst = dst << 1 | d;
+         }
+         out.emit(scramble(src), scramble(dst), rng_weight(i));
+      }
+   }
+};
+
+// Points are bucketed into square cells of side >= radius and numbered in
+// cell order, so that nearby points get nearby ids. A chunk is one row of
+// cells; each point is compared against the points of its 3x3 cell block.
+class RGGSource : public EdgeSource {
+   uint32_t n;
+   double radius;
+   uint32_t g; // cells per side
+   std::vector<double> x, y;
+   std::vector<uint32_t> cell_start;
+
+   uint32_t cell(double px, double py) const {
+      uint32_t cx = std::min((uint32_t) (px * g), g - 1);
+      uint32_t cy = std::min((uint32_t) (py * g), g - 1);
+      return cy * g + cx;
+   }
+
+  public:
+   RGGSource(uint32_t n, double degree) : n(n) {
+      radius = sqrt(degree / (M_PI * n));
+      g = std::max(1.0, std::min(floor(1 / radius), sqrt((double) n)));
+      std::vector<double> px(n), py(n);
+      std::vector<uint32_t> c(n);
+      parallel_for(0, n, [&](uint32_t, uint64_t lo, uint64_t hi) {
+         for (uint64_t i = lo; i < hi; i++) {
+            px[i] = rng_double(STREAM_POINT, 2*i);
+            py[i] = rng_double(STREAM_POINT, 2*i + 1);
+            c[i] = cell(px[i], py[i]);
+         }
+      });
+      cell_start.assign((uint64_t) g * g + 1, 0);
+      for (uint32_t i = 0; i < n; i++) cell_start[c[i]]++;
+      parallel_prefix_sum(cell_start.data(), (uint64_t) g * g);
+      std::vector<uint32_t> cursor(cell_start.begin(), cell_start.end() - 1);
+      x.resize(n);
+      y.resize(n);
+      for (uint32_t i = 0; i < n; i++) {
+         uint32_t id = cursor[c[i]]++;
+         x[id] = px[i];
+         y[id] = py[i];
+      }
+   }
+
+   uint32_t NumChunks() const { return g; }
+
+   void ReadChunk(uint32_t row, const EdgeSink& sink) const {
+      Emitter out(sink);
+      double r2 = radius * radius;
+      for (uint32_t cx = 0; cx < g; cx++) {
+         for (uint32_t u = cell_start[row*g + cx]; u < cell_start[row*g + cx + 1]; u++) {
+            for (uint32_t ny = (row ? row - 1 : 0); ny <= std::min(row + 1, g - 1); ny++) {
+               for (uint32_t nx = (cx ? cx - 1 : 0); nx <= std::min(cx + 1, g - 1); nx++) {
+                  for (uint32_t v = cell_start[ny*g + nx]; v < cell_start[ny*g + nx + 1]; v++) {
+                     double dx = x[u] - x[v], dy = y[u] - y[v];
+                     double d2 = dx*dx + dy*dy;
+                     if (v == u || d2 > r2) continue;
+                     // weight proportional to length, in [1, MAX_WEIGHT]
+                     out.emit(u, v, 1 + (uint32_t) (sqrt(d2) / radius * (MAX_WEIGHT - 1)));
+                  }
+               }
+            }
+         }
+      }
+   }
+};
+
+// Both endpoints of every edge are drawn with probability proportional to
+// the vertex weight (i+1)^(-1/(gamma-1)), which gives a power-law degree
+// distribution with exponent gamma and vertex 0 as the largest hub.
+class ChungLuSource : public EdgeSource {
+   uint64_t n_edges;
+   std::vector<double> cdf;
+
+   uint32_t sample(uint64_t i) const {
+      double r = rng_double(STREAM_CHUNGLU, i) * cdf.back();
+      uint64_t v = std::upper_bound(cdf.begin(), cdf.end(), r) - cdf.begin();
+      return std::min(v, (uint64_t) cdf.size() - 1) - 1;
+   }
+
+  public:
+   ChungLuSource(uint32_t n, uint64_t n_edges, double gamma) : n_edges(n_edges) {
+      cdf.resize((uint64_t) n + 1);
+      cdf[0] = 0;
+      for (uint32_t i = 0; i < n; i++) cdf[i+1] = cdf[i] + pow(i + 1.0, -1 / (gamma - 1));
+   }
+
+   uint32_t NumChunks() const { return (n_edges + GEN_CHUNK - 1) / GEN_CHUNK; }
+
+   void ReadChunk(uint32_t c, const EdgeSink& sink) const {
+      Emitter out(sink);
+      uint64_t end = std::min(n_edges, (c + 1) * GEN_CHUNK);
+      for (uint64_t i = c * GEN_CHUNK; i < end; i++) {
+         out.emit(sample(2*i), sample(2*i + 1), rng_weight(i));
+      }
+   }
+};
+
+// Chunk i < r-1 holds the edges from row i to row i+1, and chunk r-1 the
+// source and sink edges. The k targets of a node are drawn with Floyd's
+// algorithm, which takes O(k) draws; duplicates are caught in O(1) by
+// stamping the columns already taken.
+class GridFlowSource : public EdgeSource {
+   uint32_t r, c, k;
+   static const uint32_t MIN_CAPACITY = 1;
+   static const uint32_t MAX_CAPACITY = 10;
+
+   uint32_t capacity(uint64_t i) const {
+      return rng(STREAM_FLOW_GRID, i) % (MAX_CAPACITY - MIN_CAPACITY) + MIN_CAPACITY;
+   }
+
+  public:
+   GridFlowSource(uint32_t r, uint32_t c, uint32_t k) : r(r), c(c), k(k) {}
+
+   uint32_t NumChunks() const { return r; }
+
+   void ReadChunk(uint32_t row, const EdgeSink& sink) const {
+      Emitter out(sink);
+      uint32_t source = r * c, sink_node = r * c + 1;
+      // counters: the k draws and capacities of node u use [2ku, 2k(u+1))
+      if (row == r - 1) {
+         uint64_t base = 2ull * k * r * c;
+         for (uint32_t j = 0; j < c; j++) {
+            out.emit(source, j, capacity(base + j));
+            out.emit((r - 1) * c + j, sink_node, capacity(base + c + j));
+         }
+         return;
+      }
+      std::vector<uint32_t> stamp(c, 0);
+      for (uint32_t j = 0; j < c; j++) {
+         uint32_t u = row * c + j;
+         uint64_t ctr = 2ull * k * u;
+         for (uint32_t m = c - k; m < c; m++) {
+            uint32_t t = rng(STREAM_FLOW_GRID, ctr++) % (m + 1);
+            if (stamp[t] == j + 1) t = m;
+            stamp[t] = j + 1;
+            out.emit(u, (row + 1) * c + t, capacity(ctr++));
+         }
+      }
+   }
+};
+
+// Node (x, y) of frame f is f*a*a + y*a + x. In-frame edges join grid
+// neighbors in both directions with capacity c2*a*a; node i of frame f
+// links to node P_f(i) of frame f+1 with capacity in [c1, c2]. One chunk
+// per frame.
+class GenRMFSource : public EdgeSource {
+   uint32_t a, b, c1, c2;
+
+  public:
+   GenRMFSource(uint32_t a, uint32_t b, uint32_t c1, uint32_t c2) :
+      a(a), b(b), c1(c1), c2(c2) {}
+
+   uint32_t NumChunks() const { return b; }
+
+   void ReadChunk(uint32_t f, const EdgeSink& sink) const {
+      Emitter out(sink);
+      uint32_t n = a * a;
+      uint32_t base = f * n;
+      uint32_t big = c2 * a * a;
+      for (uint32_t y = 0; y < a; y++) {
+         for (uint32_t x = 0; x < a; x++) {
+            uint32_t u = base + y * a + x;
+            if (x > 0) out.emit(u, u - 1, big);
+            if (x < a - 1) out.emit(u, u + 1, big);
+            if (y > 0) out.emit(u, u - a, big);
+            if (y < a - 1) out.emit(u, u + a, big);
+         }
+      }
+      if (f == b - 1) return;
+      // Fisher-Yates on counters [2n*f, 2n*(f+1))
+      std::vector<uint32_t> perm(n);
+      for (uint32_t i = 0; i < n; i++) perm[i] = i;
+      uint64_t ctr = 2ull * n * f;
+      for (uint32_t i = n - 1; i > 0; i--) {
+         std::swap(perm[i], perm[rng(STREAM_GENRMF, ctr++) % (i + 1)]);
+      }
+      for (uint32_t i = 0; i < n; i++) {
+         uint32_t cap = c1 + rng(STREAM_GENRMF, ctr++) % (c2 - c1 + 1);
+         out.emit(base + i, base + n + perm[i], cap);
+      }
+   }
+};
+
+// Vertex ids are 32-bit; edge counts are not limited (offsets are 64-bit)
+void check_size(uint64_t n_vertices, uint64_t n_edges) {
+   if (n_vertices == 0 || n_vertices > (1ull << 32) - 1) {
+      printf("ERROR: %lu nodes / %lu edges not supported\n", n_vertices, n_edges);
+      exit(1);
+   }
+}
+
+} // namespace
+
+EdgeSource* GenerateRMAT(uint32_t scale, uint32_t edge_factor) {
+   if (scale == 0 || scale > 31) {
+      printf("ERROR: R-MAT scale must be in [1, 31]\n");
+      exit(1);
+   }
+   uint64_t n_edges = (uint64_t) edge_factor << scale;
+   check_size(1ull << scale, n_edges);
+   numV = 1u << scale;
+   numE = n_edges;
+   return new RMATSource(scale, n_edges);
+}
+
+EdgeSource* GenerateRGG(uint32_t n, double degree) {
+   check_size(n, (uint64_t) (n * degree));
+   numV = n;
+   numE = (uint64_t) (n * degree);
+   return new RGGSource(n, degree);
+}
+
+EdgeSource* GenerateChungLu(uint32_t n, double degree, double gamma) {
+   if (gamma <= 1) {
+      printf("ERROR: Chung-Lu exponent must be > 1\n");
+      exit(1);
+   }
+   uint64_t n_edges = n * degree;
+   check_size(n, n_edges);
+   numV = n;
+   numE = n_edges;
+   return new ChungLuSource(n, n_edges, gamma);
+}
+
+EdgeSource* GenerateGridGraphMaxflow(uint32_t r, uint32_t c, uint32_t num_connections) {
+   if (r < 2 || num_connections > c) {
+      printf("ERROR: flow grid needs r >= 2 and k <= c\n");
+      exit(1);
+   }
+   check_size((uint64_t) r * c + 2, (uint64_t) (r - 1) * c * num_connections + 2 * c);
+   numV = r*c + 2;
+   numE = (uint64_t) (r - 1) * c * num_connections + 2ull * c;
+   startNode = numV-2;
+   endNode = numV-1;
+   return new GridFlowSource(r, c, num_connections);
+}
+
+EdgeSource* GenerateGenRMF(uint32_t a, uint32_t b, uint32_t c1, uint32_t c2) {
+   if (a == 0 || b == 0 || c1 > c2) {
+      printf("ERROR: genrmf needs a, b > 0 and c1 <= c2\n");
+      exit(1);
+   }
+   uint64_t n = (uint64_t) a * a;
+   check_size(n * b, b * (4 * n) + (b - 1) * n);
+   if ((uint64_t) c2 * a * a >= (1ull << 32)) {
+      printf("ERROR: genrmf in-frame capacity c2*a*a does not fit in 32 bits\n");
+      exit(1);
+   }
+   numV = n * b;
+   numE = 4ull * b * a * (a - 1) + (b - 1) * n;
+   startNode = 0;
+   endNode = numV - 1;
+   return new GenRMFSource(a, b, c1, c2);
+}
+
+// Synthetic graphs have no designated source/sink. Use the first vertex with
+// outgoing edges as startNode and the last other vertex with edges as
+// endNode.
+void PickEndpoints() {
+   startNode = 0;
+   while (startNode < numV - 1 && csr_offset[startNode+1] == csr_offset[startNode]) {
+      startNode++;
+   }
+   endNode = numV - 1;
+   while (endNode > 0 && (endNode == startNode ||
+            csr_offset[endNode+1] == csr_offset[endNode])) {
+      endNode--;
+   }
+   printf("startNode %d endNode %d\n", startNode, endNode);
+}
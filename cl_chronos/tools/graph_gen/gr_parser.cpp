@@ -0,0 +1,185 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// DIMACS (.gr) reader.
+//
+// The file is mmap'd and split into fixed-size chunks aligned to line
+// boundaries. LoadGraphGR makes one parallel pass over the chunks to count
+// the arcs and pick up the 'p' and 'n' lines; the arcs themselves are only
+// parsed when BuildCSR reads the returned source, so no edge list is ever
+// materialized.
+
+#include "graph_gen.h"
+#include "parallel.h"
+#include "text_util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const uint64_t GR_CHUNK_SIZE = 8 << 20;
+
+struct GRChunk {
+   const char* begin;
+   const char* end;
+   uint64_t n_arcs;
+   // header lines seen in this chunk (0 if none)
+   bool has_p;
+   uint32_t p_numV;
+   uint64_t p_numE;
+   uint32_t n_src, n_sink; // 1-based, as in the file
+};
+
+// 'p sp <n> <m>' (or 'p max <n> <m>' for flow networks)
+void parse_p_line(const char* p, const char* end, GRChunk* c) {
+   p = skip_token(p, end);
+   p = skip_token(p, end);
+   p = parse_uint(p, end, &c->p_numV);
+   parse_uint64(p, end, &c->p_numE);
+   c->has_p = true;
+}
+
+// 'n <id> <s|t>'
+void parse_n_line(const char* p, const char* end, GRChunk* c) {
+   uint32_t r;
+   p = skip_token(p, end);
+   p = parse_uint(p, end, &r);
+   p = skip_blanks(p, end);
+   if (p < end && *p == 's') c->n_src = r;
+   if (p < end && *p == 't') c->n_sink = r;
+}
+
+void count_chunk(GRChunk* c) {
+   const char* p = c->begin;
+   uint64_t n = 0;
+   while (p < c->end) {
+      const char* eol = next_line(p, c->end);
+      switch (*p) {
+         case 'a': n++; break;
+         case 'p': parse_p_line(p, eol, c); break;
+         case 'n': parse_n_line(p, eol, c); break;
+         default: break;
+      }
+      p = eol;
+   }
+   c->n_arcs = n;
+}
+
+const uint32_t GR_BATCH = 4096;
+
+void parse_chunk(const GRChunk* c, uint32_t nv, const EdgeSink& sink) {
+   Edge batch[GR_BATCH];
+   uint32_t n = 0;
+   const char* p = c->begin;
+   while (p < c->end) {
+      if (*p == 'a') {
+         uint32_t src, dest, w;
+         const char* q = parse_uint(p + 1, c->end, &src);
+         q = parse_uint(q, c->end, &dest);
+         q = parse_uint(q, c->end, &w);
+         if (src == 0 || dest == 0 || src > nv || dest > nv) {
+            printf("ERROR: arc %u -> %u out of range (%u nodes)\n",
+                  src, dest, nv);
+            exit(1);
+         }
+         batch[n].src = src - 1;
+         batch[n].dst = dest - 1;
+         batch[n].w = w;
+         if (++n == GR_BATCH) {
+            sink(batch, n);
+            n = 0;
+         }
+         p = q;
+      }
+      p = next_line(p, c->end);
+   }
+   if (n) sink(batch, n);
+}
+
+class GRSource : public EdgeSource {
+  public:
+   MappedFile file;
+   std::vector<GRChunk> chunks;
+
+   uint32_t NumChunks() const { return chunks.size(); }
+   uint64_t InputBytes() const { return file.size; }
+   void ReadChunk(uint32_t i, const EdgeSink& sink) const {
+      parse_chunk(&chunks[i], numV, sink);
+   }
+};
+
+} // namespace
+
+EdgeSource* LoadGraphGR(const char* file) {
+   // DIMACS
+   GRSource* src = new GRSource();
+   double t_start = wall_time();
+   src->file.open(file);
+   const char* text = src->file.data;
+   uint64_t size = src->file.size;
+
+   // Chunk boundaries are moved forward to the next line start, so every
+   // line belongs to exactly one chunk.
+   uint32_t n_chunks = (size + GR_CHUNK_SIZE - 1) / GR_CHUNK_SIZE;
+   std::vector<GRChunk>& chunks = src->chunks;
+   chunks.resize(n_chunks);
+   const char* file_end = text + size;
+   for (uint32_t i = 0; i < n_chunks; i++) {
+      GRChunk& c = chunks[i];
+      memset(&c, 0, sizeof(GRChunk));
+      c.begin = (i == 0) ? text : next_line(text + i * GR_CHUNK_SIZE - 1, file_end);
+      if (i > 0) chunks[i-1].end = c.begin;
+   }
+   chunks[n_chunks-1].end = file_end;
+
+   parallel_tasks(n_chunks, [&](uint32_t, uint32_t i) {
+      if (chunks[i].begin < chunks[i].end) count_chunk(&chunks[i]);
+   });
+
+   // Later header lines take precedence, as they did with the serial reader
+   uint64_t n_arcs = 0;
+   bool has_p = false;
+   for (GRChunk& c : chunks) {
+      n_arcs += c.n_arcs;
+      if (c.has_p) {
+         has_p = true;
+         numV = c.p_numV;
+         numE = c.p_numE;
+      }
+      if (c.n_src) startNode = c.n_src - 1;
+      if (c.n_sink) endNode = c.n_sink - 1;
+   }
+   if (!has_p) {
+      printf("ERROR: No problem line ('p') in %s\n", file);
+      exit(1);
+   }
+
+   double t = wall_time() - t_start;
+   printf("n %lu %d %lu\n", n_arcs, numV, numE);
+   // the arcs are parsed by BuildCSR; graph_gen.cpp reports the total
+   printf("Counted the arcs of %.1f MB in %.3f s (%.1f MB/s, %d threads)\n",
+         size / 1e6, t, size / 1e6 / t, n_threads);
+   return src;
+}
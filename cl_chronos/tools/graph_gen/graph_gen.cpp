@@ -21,7 +21,6 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#define MAGIC_OP 0xdead
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,486 +34,207 @@
 #include <tuple>
 #include <utility>
 #include <vector>
-#include <set>
 #include <map>
 #include <unordered_set>
 #include <queue>
-#include <random>
-#include <numeric>
 
-struct Node {
-   uint32_t vid;
-   uint32_t dist;
-   uint32_t bucket;
-};
+#include "graph_gen.h"
+#include "latlon_bin.h"
+#include "parallel.h"
 
-struct NodeSort {
-   uint32_t vid;
-   uint32_t degree;
-};
-struct degree_sort {
-   bool operator() (const NodeSort &a, const NodeSort &b) const {
-      int a_deg = a.degree;
-      int b_deg = b.degree;
-      bool ret = (a_deg > b_deg) ||
-                  ( (a_deg == b_deg) && (a.vid < b.vid)) ;
-      //printf(" (%d %d), (%d,%d) %d\n", a.degree, a.vid, b.degree, b.vid, ret);
-      return ret;
-   }
-};
-
-#define APP_SSSP 0
-#define APP_COLOR 1
-#define APP_MAXFLOW 2
 const double EarthRadius_cm = 637100000.0;
+const double EarthRadius_m = 6371000.0;
 
-struct Vertex;
-
-struct Adj {
-   uint32_t n;
-   uint32_t d_cm; // edge weight
-   uint32_t index; // index of the reverse edge
-};
-
-struct Vertex {
-   double lat, lon;  // in RADIANS
-   std::vector<Adj> adj;
-};
-
-Vertex* graph;
 uint32_t numV;
-uint32_t numE;
+uint64_t numE;
 uint32_t startNode;
 uint32_t endNode;
 
 int app = APP_SSSP;
+uint32_t edge_format = EDGE_FORMAT_PAIR;
+bool large_image = false;
+uint32_t n_threads = 1;
 
-uint32_t* csr_offset;
+uint64_t* csr_offset;
 Adj* csr_neighbors;
 uint32_t* csr_dist;
+double* vertex_lat;
+double* vertex_lon;
 
-void addEdge(uint32_t from, uint32_t to, uint32_t cap) {
-    bool combine_edges = true;
-    if (combine_edges) {
-      for (Adj& a : graph[from].adj) {
-         if (a.n == to) {
-            a.d_cm = cap;
-            graph[to].adj[a.index].d_cm = cap;
-            return;
+void LoadGraph(const char* file) {
+   LatLonBin g;
+   g.open(file);
+   numV = g.numV;
+   numE = g.numE;
+
+   // astar works in meters, to match its heuristic
+   double radius = (app == APP_ASTAR) ? EarthRadius_m : EarthRadius_cm;
+   csr_offset = (uint64_t*)(malloc (sizeof(uint64_t) * (numV+1)));
+   csr_neighbors = (Adj*)(malloc (sizeof(Adj) * (numE)));
+   csr_dist = (uint32_t*)(malloc (sizeof(uint32_t) * numV));
+   vertex_lat = (double*)(malloc (sizeof(double) * numV));
+   vertex_lon = (double*)(malloc (sizeof(double) * numV));
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint32_t i = lo; i < hi; i++) {
+         vertex_lat[i] = g.lat(i);
+         vertex_lon[i] = g.lon(i);
+         csr_offset[i] = g.edge_offset[i];
+         Adj* adj = csr_neighbors + csr_offset[i];
+         uint32_t n = g.degree(i);
+         for (uint32_t j = 0; j < n; j++) {
+            adj[j].n = g.neighbor(i, j);
+            adj[j].d_cm = g.dist(i, j)*radius;
+            adj[j].index = 0;
          }
+         csr_dist[i] = ~0;
       }
-
-    }
-
-    // Push edge to _graph[node]
-    Adj adj_from = {to, cap, (uint32_t) graph[to].adj.size()};
-    graph[from].adj.push_back(adj_from);
-
-    // Insert the reverse edge (residual graph)
-    Adj adj_to = {from, 0, (uint32_t) graph[from].adj.size()-1};
-    graph[to].adj.push_back(adj_to);
-    //printf("Edge %d %d %d\n", from, to, cap);
-}
-
-uint64_t dist(const Vertex* src, const Vertex* dst) {
-   // Use the haversine formula to compute the great-angle radians
-   double latS = std::sin(src->lat - dst->lat);
-   double lonS = std::sin(src->lon - dst->lon);
-   double a = latS*latS + lonS*lonS*std::cos(src->lat)*std::cos(dst->lat);
-   double c = 2*std::atan2(std::sqrt(a), std::sqrt(1-a));
-
-   uint64_t d_cm = c*EarthRadius_cm;
-   return d_cm;
+   });
+   csr_offset[numV] = numE;
+   printf("Read %d nodes, %lu adjacencies\n", numV, numE);
 }
 
-void LoadGraphGR(const char* file) {
-   // DIMACS
-   std::ifstream f;
-   std::string s;
-   f.open(file, std::ios::binary);
-   if (!f.is_open()) {
-      printf("ERROR: Could not open input file\n");
-      exit(1);
-   }
-   int n =0;
-   while(!f.eof()) {
-      std::getline(f, s);
-      if (s.c_str()[0]=='c') continue;
-      if (s.c_str()[0]=='n') {
-         char st;
-         uint32_t r;
-         sscanf(s.c_str(), "%*s %d %c\n", &r, &st);
-         if (st=='s') startNode = r-1;
-         if (st=='t') endNode = r-1;
-      }
-      if (s.c_str()[0]=='p') {
-         sscanf(s.c_str(), "%*s %*s %d %d\n", &numV, &numE);
-         graph = new Vertex[numV];
-      }
-      if (s.c_str()[0]=='a') {
-         uint32_t src, dest, w;
-         sscanf(s.c_str(), "%*s %d %d %d\n", &src, &dest, &w);
-         if (app == APP_MAXFLOW) {
-            addEdge(src-1, dest-1, w);
-         } else {
-            Adj a = {dest-1,w};
-            graph[src-1].adj.push_back(a);
+// n x n grid with edges to the right and down neighbors. The weights come
+// from a fixed rand() sequence, so the whole grid is a single chunk that is
+// regenerated from the seed on every read.
+class GridSource : public EdgeSource {
+  public:
+   uint32_t n;
+   GridSource(uint32_t n) : n(n) {}
+   uint32_t NumChunks() const { return 1; }
+   void ReadChunk(uint32_t, const EdgeSink& sink) const {
+      std::vector<Edge> row;
+      srand(0);
+      for (uint32_t i=0;i<n;i++){
+         row.clear();
+         for (uint32_t j=0;j<n;j++){
+            uint32_t vid = i*n+j;
+            if (i < n-1) {
+               Edge e = {vid, vid+n, (uint32_t) (rand() % 10)};
+               row.push_back(e);
+            }
+            if (j < n-1) {
+               Edge e = {vid, vid+1, (uint32_t) (rand() % 10)};
+               row.push_back(e);
+            }
          }
+         sink(row.data(), row.size());
       }
-
-      n++;
    }
-   printf("n %d %d %d\n",n, numV, numE);
-
-}
-void LoadGraphEdges(const char* file) {
-   std::ifstream f;
-   std::string s;
-   f.open(file, std::ios::binary);
-   if (!f.is_open()) {
-      printf("ERROR: Could not open input file\n");
-      exit(1);
-   }
-   int n =0;
-   numV = 1157828; // hack: com-youtube
-   graph = new Vertex[numV];
-   while(!f.eof()) {
-      std::getline(f, s);
-      if (s.c_str()[0]=='E') continue;
-      else {
-         uint32_t src, dest;
-         sscanf(s.c_str(), "%d %d\n", &src, &dest);
-         //printf("%d %d\n", src, dest);
-         if (src > numV || dest > numV) continue;
-         Adj a = {dest-1,0};
-         graph[src-1].adj.push_back(a);
-      }
-
-      n++;
-   }
-   printf("%d %d\n", numV, numE);
-
-}
-void LoadGraph(const char* file) {
-   const uint32_t MAGIC_NUMBER = 0x150842A7 + 0; // increment every time you change the file format
-   std::ifstream f;
-   f.open(file, std::ios::binary);
-   if (!f.is_open()) {
-      printf("ERROR: Could not open input file\n");
-      exit(1);
-   }
-
-   auto readU = [&]() -> uint32_t {
-      union U {
-         uint32_t val;
-         char bytes[sizeof(uint32_t)];
-      };
-      U u;
-      f.read(u.bytes, sizeof(uint32_t));
-      // assert(!f.fail());
-      return u.val;
-   };
-
-   auto readD = [&]() -> double {
-      union U {
-         double val;
-         char bytes[sizeof(double)];
-      };
-      U u;
-      f.read(u.bytes, sizeof(double));
-      // assert(!f.fail());
-      return u.val;
-   };
-
-   uint32_t magic = readU();
-   if (magic != MAGIC_NUMBER) {
-      printf("ERROR: Wrong input file format (magic number %d, expected %d)\n",
-            magic, MAGIC_NUMBER);
-      exit(1);
-   }
-
-   numV = readU();
-   printf("Reading %d nodes...\n", numV);
-
-   graph = new Vertex[numV];
-   uint32_t i = 0;
-   while (i < numV) {
-      graph[i].lat = readD();
-      graph[i].lon = readD();
-      uint32_t n = readU();
-      graph[i].adj.resize(n);
-      for (uint32_t j = 0; j < n; j++) graph[i].adj[j].n = readU();
-      for (uint32_t j = 0; j < n; j++) graph[i].adj[j].d_cm = readD()*EarthRadius_cm;
-      i++;
-
-   }
-
-   f.get();
-   // assert(f.eof());
-
-#if 0
-   // Print graph
-   for (uint32_t i = 0; i < numV; i++) {
-      printf("%6d: %7f %7f", i, graph[i].lat, graph[i].lon);
-      for (auto a: graph[i].adj) printf(" %5ld %7f", a.n-graph, a.d);
-      printf("\n");
-   }
-#endif
-
-}
+};
 
-void GenerateGridGraph(uint32_t n) {
+EdgeSource* GenerateGridGraph(uint32_t n) {
    numV = n*n;
-   numE = 2 * n * (n-1) ;
-   graph = new Vertex[numV];
-   bool debug = false;
-   srand(0);
-   for (uint32_t i=0;i<n;i++){
-      for (uint32_t j=0;j<n;j++){
-         uint32_t vid = i*n+j;
-         if (i < n-1) {
-            Adj e;
-            e.n = (vid+n);
-            e.d_cm = rand() % 10;
-            graph[vid].adj.push_back(e);
-            if(debug) printf("%d->%d %d\n", vid, e.n, e.d_cm);
-         }
-         if (j < n-1) {
-            Adj e;
-            e.n = (vid+1);
-            e.d_cm = rand() % 10;
-            graph[vid].adj.push_back(e);
-            if(debug) printf("%d->%d %d\n", vid, e.n, e.d_cm);
-         }
-      }
-   }
-
-   // Add extra edges to get a high-fanout node
-    /*
-   for (int j=30;j<100;j++) {
-      Adj e;
-      e.n=j;
-      e.d_cm = 0;
-      graph[15].adj.push_back(e);
-   } */
+   numE = 2ull * n * (n-1) ;
+   return new GridSource(n);
 }
 
-// code copied from suvinay's maxflow graph generator
-void choose_k(int to, std::vector<int>* vec, int k, int seed) {
-    std::vector<int> numbers;
-    numbers.resize(to);
-    std::iota(numbers.begin(), numbers.end(), 0);   // Populate numbers from 0 to (to-1)
-    //std::shuffle(numbers.begin(), numbers.end(), std::mt19937{std::random_device{}()}); // Shuffle them
-    std::shuffle(numbers.begin(), numbers.end(), std::default_random_engine(seed));
-    std::copy_n(numbers.begin(), k, vec->begin()); // Copy the first k in the shuffled array to vec
-    return;
+uint64_t size_of_field(uint64_t items, uint64_t size_of_item){
+	const uint64_t CACHE_LINE_SIZE = 64;
+	return ( (items * size_of_item + CACHE_LINE_SIZE-1) /CACHE_LINE_SIZE) * CACHE_LINE_SIZE / 4;
 }
 
-void GenerateGridGraphMaxflow(uint32_t r, uint32_t c, uint32_t num_connections) {
-   srand(42);
-   numV = r*c + 2;
-   const int MAX_CAPACITY = 10;
-   const int MIN_CAPACITY = 1;
-   graph = new Vertex[numV];
-   uint32_t i, j;
-   for (i = 0; i < r - 1; ++i) {
-      for (j = 0; j < c; ++j) {
-         std::vector<int> connections;
-         connections.resize(num_connections);
-         choose_k(c, &connections, num_connections, rand());
-         for (auto &x : connections) {
-            uint32_t capacity = static_cast<uint32_t>(
-                  rand() % (MAX_CAPACITY - MIN_CAPACITY) + MIN_CAPACITY);
-            addEdge(i*c+j, (i+1)*c+x, capacity);
-            //printf("a %d %d %d\n", i * c + j, (i + 1) * c + x, capacity);
-         }
-      }
-   }
-   for (i = 0; i < c; ++i) {
-      uint32_t capacity = static_cast<uint32_t>
-         (rand() % (MAX_CAPACITY - MIN_CAPACITY) + MIN_CAPACITY);
-      addEdge(r*c, i, capacity);
-      //printf("a %d %d %d\n", r*c , i, capacity);
+// Edge offsets are one word each, or (low, high) pairs in large images
+inline void put_offset(uint32_t* edge_offset, uint64_t i, uint64_t value, bool large) {
+   if (large) {
+      edge_offset[2*i] = value;
+      edge_offset[2*i+1] = value >> 32;
+   } else {
+      edge_offset[i] = value;
    }
+}
 
-   for (i = 0; i < c; ++i) {
-      uint32_t capacity = static_cast<uint32_t>
-         (rand() % (MAX_CAPACITY - MIN_CAPACITY) + MIN_CAPACITY);
-      addEdge((r - 1) * c + i, c*r + 1, capacity);
-      //printf("a %d %d %d\n", (r-1)*c +i ,c*r+ 1, capacity);
+// maxflow and astar images only have the 32-bit layout
+void CheckSmallImage(uint64_t end) {
+   if (end >= (1ull << 32) || numE >= (1ull << 32)) {
+      printf("ERROR: %lu words and %lu edges need a large image, which only sssp and color support\n",
+            end, numE);
+      exit(1);
    }
-   startNode = numV-2;
-   endNode = numV-1;
 }
 
-std::set<uint32_t>* edges;
-void makeUndirectional() {
+// Edges are (neighbor, weight) word pairs, or with --packed-edges one word
+// each, weight[31:24] neighbor[23:0] (read by riscv_code/sssp-packed), or
+// with --varint-edges compressed lists at byte offsets (read by
+// riscv_code/sssp-varint). Header word 9 holds the edge format.
+void WriteOutput(const char* file) {
+   // all offsets are in units of uint32_t. i.e 16 per cache line
 
-   edges = new std::set<uint32_t>[numV];
-   for (uint32_t i = 0; i < numV; i++) {
-      for (uint32_t a=0;a<graph[i].adj.size();a++){
-         int n = graph[i].adj[a].n;
-         //         printf("%d %d\n",i,n);
-         edges[i].insert(n);
-         edges[n].insert(i);
+   if (edge_format == EDGE_FORMAT_PACKED) {
+      std::vector<uint32_t> max_w(n_threads, 0);
+      parallel_for(0, numE, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+         for (uint64_t i=lo;i<hi;i++) max_w[t] = std::max(max_w[t], csr_neighbors[i].d_cm);
+      });
+      uint32_t max_weight = *std::max_element(max_w.begin(), max_w.end());
+      if (numV > (1u << 24) || max_weight > 0xff) {
+         printf("ERROR: packed edges need numV <= 2^24 and weights <= 255 (numV %u, max weight %u)\n",
+               numV, max_weight);
+         exit(1);
       }
-
    }
-
-   for (uint32_t i = 0; i < numV; i++) {
-      graph[i].adj.clear();
-      for (uint32_t n: edges[i]) {
-         Adj a;
-         a.n = n;
-         a.d_cm = 0;
-         graph[i].adj.push_back(a);
-      }
-
+   uint64_t edge_bytes = numE * ((edge_format == EDGE_FORMAT_PACKED) ? 4 : 8);
+   uint64_t* offset = csr_offset;
+   if (edge_format == EDGE_FORMAT_VARINT) {
+      offset = (uint64_t*) malloc(sizeof(uint64_t) * (numV+1));
+      edge_bytes = VarintOffsets(true, offset);
+   }
+
+   bool large = large_image;
+   uint64_t BASE_DIST, BASE_EDGE_OFFSET, BASE_NEIGHBORS, BASE_GROUND_TRUTH, BASE_END;
+   auto layout = [&]() {
+      uint64_t SIZE_DIST = size_of_field(numV, 4);
+      uint64_t SIZE_EDGE_OFFSET = size_of_field(numV+1, large ? 8 : 4);
+      uint64_t SIZE_NEIGHBORS = size_of_field(edge_bytes, 1);
+
+      BASE_DIST = large ? LARGE_HEADER_WORDS : 16;
+      BASE_EDGE_OFFSET = BASE_DIST + SIZE_DIST;
+      BASE_NEIGHBORS = BASE_EDGE_OFFSET + SIZE_EDGE_OFFSET;
+      BASE_GROUND_TRUTH = BASE_NEIGHBORS + SIZE_NEIGHBORS;
+      BASE_END = BASE_GROUND_TRUTH + size_of_field(numV, 4);
+   };
+   layout();
+   if (!large && (BASE_END >= (1ull << 32) || numE >= (1ull << 32))) {
+      printf("Offsets do not fit in 32 bits, writing a large image\n");
+      large = true;
+      layout();
    }
 
+   Image img = OpenImage(file, BASE_END);
+   uint32_t* data = img.data;
 
+   uint64_t header[] = {MAGIC_OP, numV, numE, BASE_EDGE_OFFSET, BASE_NEIGHBORS,
+      BASE_DIST, BASE_GROUND_TRUTH, startNode, BASE_END, edge_format};
+   WriteHeader(data, header, 10, large);
 
-}
-
-void ConvertToCSR() {
-   numE = 0;
-   for (uint32_t i = 0; i < numV; i++) numE += graph[i].adj.size();
-   printf("Read %d nodes, %d adjacencies\n", numV, numE);
-
-   csr_offset = (uint32_t*)(malloc (sizeof(uint32_t) * (numV+1)));
-   csr_neighbors = (Adj*)(malloc (sizeof(Adj) * (numE)));
-   csr_dist = (uint32_t*)(malloc (sizeof(uint32_t) * numV));
-   numE = 0;
-   for (uint32_t i=0;i<numV;i++){
-      csr_offset[i] = numE;
-      for (uint32_t a=0;a<graph[i].adj.size();a++){
-         csr_neighbors[numE++] = graph[i].adj[a];
+   printf("Writing file \n");
+   uint32_t max_int = 0xFFFFFFFF;
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint32_t i=lo;i<hi;i++) {
+         put_offset(data + BASE_EDGE_OFFSET, i, offset[i], large);
+         data[BASE_DIST+i] = max_int;
+         data[BASE_GROUND_TRUTH +i] = csr_dist[i];
       }
-      csr_dist[i] = ~0;
-   }
-   csr_offset[numV] = numE;
-
-}
-
-struct compare_node {
-   bool operator() (const Node &a, const Node &b) const {
-      return a.bucket > b.bucket;
-   }
-};
-void ComputeReference(){
-   uint32_t  delta = 1;
-   printf("Compute Reference\n");
-   std::priority_queue<Node, std::vector<Node>, compare_node> pq;
-
-    // cache flush
-#if 0
-    const int size = 20*1024*1024;
-    char *c = (char *) malloc(size);
-    for (int i=0;i<0xff;i++) {
-       // printf("%d\n", i);
-
-        for (int j=0;j<size;j++)
-            c[j] = i*j;
-    }
-#endif
-   uint32_t max_pq_size = 0;
-   int edges_traversed = 0;
-
-   clock_t t = clock();
-   Node v = {startNode, 0, 0};
-   pq.push(v);
-   while(!pq.empty()){
-      Node n = pq.top();
-      uint32_t vid = n.vid;
-      uint32_t dist = n.dist;
-      //printf("visit %d %d\n", vid, dist);
-      pq.pop();
-      max_pq_size = pq.size() < max_pq_size ?  max_pq_size : pq.size();
-      edges_traversed++;
-      if (csr_dist[vid] > dist) {
-         csr_dist[vid] = dist;
-
-         uint32_t ngh = csr_offset[vid];
-         uint32_t nghEnd = csr_offset[vid+1];
-
-         while(ngh != nghEnd) {
-            Adj a = csr_neighbors[ngh++];
-            Node e = {a.n, dist +  a.d_cm, (dist+a.d_cm)/delta};
-            //printf(" -> %d %d\n", a.n, dist+ a.d_cm);
-            pq.push(e);
+   });
+   put_offset(data + BASE_EDGE_OFFSET, numV, offset[numV], large);
+
+   if (edge_format == EDGE_FORMAT_VARINT) {
+      VarintEncode(true, offset, (uint8_t*) (data + BASE_NEIGHBORS));
+      free(offset);
+   } else parallel_for(0, numE, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      if (edge_format == EDGE_FORMAT_PACKED) {
+         for (uint64_t i=lo;i<hi;i++) {
+            data[ BASE_NEIGHBORS +i ] = csr_neighbors[i].d_cm << 24 | csr_neighbors[i].n;
+         }
+      } else {
+         for (uint64_t i=lo;i<hi;i++) {
+            data[ BASE_NEIGHBORS +2*i ] = csr_neighbors[i].n;
+            data[ BASE_NEIGHBORS +2*i+1] = csr_neighbors[i].d_cm;
          }
       }
-   }
-   t = clock() -t;
-   printf("Time taken :%f msec\n", ((float)t * 1000)/CLOCKS_PER_SEC);
-   printf("Node %d dist:%d\n", numV -1, csr_dist[numV-1]);
-   printf("Max PQ size %d\n", max_pq_size);
-   printf("edges traversed %d\n", edges_traversed);
-}
+   });
 
-int size_of_field(int items, int size_of_item){
-	const int CACHE_LINE_SIZE = 64;
-	return ( (items * size_of_item + CACHE_LINE_SIZE-1) /CACHE_LINE_SIZE) * CACHE_LINE_SIZE / 4;
+   CloseImage(img);
 }
-
-
-void WriteOutput(FILE* fp) {
-   // all offsets are in units of uint32_t. i.e 16 per cache line
-
-   int SIZE_DIST =((numV+15)/16)*16;
-   int SIZE_EDGE_OFFSET =( (numV+1 +15)/ 16) * 16;
-   int SIZE_NEIGHBORS =(( (numE* 8)+ 63)/64 ) * 16;
-   int SIZE_GROUND_TRUTH =((numV+15)/16)*16;
-
-   int BASE_DIST = 16;
-   int BASE_EDGE_OFFSET = BASE_DIST + SIZE_DIST;
-   int BASE_NEIGHBORS = BASE_EDGE_OFFSET + SIZE_EDGE_OFFSET;
-   int BASE_GROUND_TRUTH = BASE_NEIGHBORS + SIZE_NEIGHBORS;
-
-   int BASE_END = BASE_GROUND_TRUTH + SIZE_GROUND_TRUTH;
-
-   uint32_t* data = (uint32_t*) calloc(BASE_END, sizeof(uint32_t));
-
-   data[0] = MAGIC_OP;
-   data[1] = numV;
-   data[2] = numE;
-   data[3] = BASE_EDGE_OFFSET;
-   data[4] = BASE_NEIGHBORS;
-   data[5] = BASE_DIST;
-   data[6] = BASE_GROUND_TRUTH;
-   data[7] = startNode;
-   data[8] = BASE_END;
-
-   for (int i=0;i<9;i++) {
-      printf("header %d: %d\n", i, data[i]);
-   }
-
-   uint32_t max_int = 0xFFFFFFFF;
-   for (uint32_t i=0;i<numV;i++) {
-      data[BASE_EDGE_OFFSET +i] = csr_offset[i];
-      data[BASE_DIST+i] = max_int;
-      data[BASE_GROUND_TRUTH +i] = csr_dist[i];
-      //printf("gt %d %d\n", i, csr_dist[i]);
-   }
-   data[BASE_EDGE_OFFSET +numV] = csr_offset[numV];
-
-   for (uint32_t i=0;i<numE;i++) {
-      data[ BASE_NEIGHBORS +2*i ] = csr_neighbors[i].n;
-      data[ BASE_NEIGHBORS +2*i+1] = csr_neighbors[i].d_cm;
-   }
-
-   printf("Writing file \n");
-   fwrite(data, 4, BASE_END, fp);
-   /*
-   for (int i=0;i<BASE_END;i++) {
-      fprintf(fp, "%08x\n", data[i]);
-   } */
-   fclose(fp);
-
-   free(data);
-
-}
-void WriteOutputColor(FILE* fp) {
+void WriteOutputColor(const char* file) {
    // all offsets are in units of uint32_t. i.e 16 per cache line
    //int SIZE_COLOR =((numV+15)/16)*16;
    //
@@ -522,115 +242,95 @@ void WriteOutputColor(FILE* fp) {
    // (The expected input format for the pipelined cores differs from the one
    // for non-pipe/riscv versions. This generator is compatible with both.
 
-   int SIZE_DATA = size_of_field(numV, 16);
-   int SIZE_EDGE_OFFSET = size_of_field(numV+1, 4) ;
-   int SIZE_NEIGHBORS = size_of_field(numE, 4) ;
-   int SIZE_SCRATCH = size_of_field(numV, 8);
-   int SIZE_GROUND_TRUTH = size_of_field(numV, 4);
-
-   int BASE_DATA = 16;
-   int BASE_EDGE_OFFSET = BASE_DATA + SIZE_DATA;
-   int BASE_NEIGHBORS = BASE_EDGE_OFFSET + SIZE_EDGE_OFFSET;
-   int BASE_SCRATCH = BASE_NEIGHBORS + SIZE_NEIGHBORS;
-   int BASE_GROUND_TRUTH = BASE_SCRATCH + SIZE_SCRATCH;
-   int BASE_END = BASE_GROUND_TRUTH + SIZE_GROUND_TRUTH;
-
-   uint32_t* data = (uint32_t*) calloc(BASE_END, sizeof(uint32_t));
-   uint32_t enqueuer_size = 16;
-
-   data[0] = MAGIC_OP;
-   data[1] = numV;
-   data[2] = numE;
-   data[3] = BASE_EDGE_OFFSET;
-   data[4] = BASE_NEIGHBORS;
-   data[5] = BASE_DATA;
-   data[6] = BASE_GROUND_TRUTH;
-   data[7] = BASE_SCRATCH;
-   data[8] = BASE_END;
-   data[9] = enqueuer_size;
-
-
-   for (int i=0;i<10;i++) {
-      printf("header %d: %d\n", i, data[i]);
-   }
-
-   for (uint32_t i=0;i<numV;i++) {
-
-      data[BASE_EDGE_OFFSET + i] = csr_offset[i];
-      data[BASE_SCRATCH + i*2 + 0] = 0;
-      data[BASE_SCRATCH + i*2 + 1] = 0;
-
-      data[BASE_DATA+i*4] = (csr_offset[i+1]-csr_offset[i]) << 16 | 0xffff; // degree, color
-      data[BASE_DATA+i*4+1] = 0; // scratch
-      data[BASE_DATA+i*4+2] = (csr_offset[i+1]-csr_offset[i]) << 16 | 0; // ndp, ncp
-      data[BASE_DATA+i*4+3] = csr_offset[i];
-
-      //printf("gt %d %d\n", i, csr_dist[i]);
-   }
-   data[BASE_EDGE_OFFSET + numV] = csr_offset[numV];
-
-   for (uint32_t i=0;i<numE;i++) {
-      data[ BASE_NEIGHBORS +i ] = csr_neighbors[i].n;
+   // --varint-edges: edge offsets (also in the data words) are byte offsets
+   // into the compressed lists; header word 10 holds the edge format
+   uint64_t edge_bytes = numE * 4;
+   uint64_t* offset = csr_offset;
+   if (edge_format == EDGE_FORMAT_VARINT) {
+      offset = (uint64_t*) malloc(sizeof(uint64_t) * (numV+1));
+      edge_bytes = VarintOffsets(false, offset);
+   }
+
+   // Large images keep only the low half of the edge offset in the data
+   // words; the riscv apps read the 64-bit edge offset array.
+   bool large = large_image;
+   uint64_t BASE_DATA, BASE_EDGE_OFFSET, BASE_NEIGHBORS, BASE_SCRATCH, BASE_GROUND_TRUTH, BASE_END;
+   auto layout = [&]() {
+      uint64_t SIZE_DATA = size_of_field(numV, 16);
+      uint64_t SIZE_EDGE_OFFSET = size_of_field(numV+1, large ? 8 : 4);
+      uint64_t SIZE_NEIGHBORS = size_of_field(edge_bytes, 1);
+      uint64_t SIZE_SCRATCH = size_of_field(numV, 8);
+
+      BASE_DATA = large ? LARGE_HEADER_WORDS : 16;
+      BASE_EDGE_OFFSET = BASE_DATA + SIZE_DATA;
+      BASE_NEIGHBORS = BASE_EDGE_OFFSET + SIZE_EDGE_OFFSET;
+      BASE_SCRATCH = BASE_NEIGHBORS + SIZE_NEIGHBORS;
+      BASE_GROUND_TRUTH = BASE_SCRATCH + SIZE_SCRATCH;
+      BASE_END = BASE_GROUND_TRUTH + size_of_field(numV, 4);
+   };
+   layout();
+   if (!large && (BASE_END >= (1ull << 32) || numE >= (1ull << 32))) {
+      printf("Offsets do not fit in 32 bits, writing a large image\n");
+      large = true;
+      layout();
    }
 
+   Image img = OpenImage(file, BASE_END);
+   uint32_t* data = img.data;
+   uint32_t enqueuer_size = 16;
 
-   // sort by degree
-   std::vector< NodeSort > vec;
-   for (unsigned int i=0;i<numV;i++) {
-      uint32_t degree = csr_offset[i+1] - csr_offset[i];
-      NodeSort n = {i, degree};
-      vec.push_back(n);
-   }
-   std::sort(vec.begin(), vec.end(), degree_sort());
-   for (uint32_t i=0;i<numV;i++) {
-      uint32_t vid = vec[i].vid;
-      uint64_t vec = 0;
-      for (uint32_t j=csr_offset[vid]; j< csr_offset[vid+1]; j++) {
-         uint32_t neighbor = csr_neighbors[j].n;
-         //printf("\t%d neighbor %x\n", neighbor, csr_dist[neighbor]);
-         if (csr_dist[neighbor] != 0xFFFFFFFF) {
-            vec = vec | ( 1<<csr_dist[neighbor]);
-         }
+   uint64_t header[] = {MAGIC_OP, numV, numE, BASE_EDGE_OFFSET, BASE_NEIGHBORS,
+      BASE_DATA, BASE_GROUND_TRUTH, BASE_SCRATCH, BASE_END, enqueuer_size, edge_format};
+   WriteHeader(data, header, 11, large);
+
+   // (BASE_SCRATCH and the data scratch word are left as 0)
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint32_t i=lo;i<hi;i++) {
+         uint32_t degree = csr_offset[i+1]-csr_offset[i];
+         put_offset(data + BASE_EDGE_OFFSET, i, offset[i], large);
+         data[BASE_DATA+i*4] = degree << 16 | 0xffff; // degree, color
+         data[BASE_DATA+i*4+2] = degree << 16 | 0; // ndp, ncp
+         data[BASE_DATA+i*4+3] = offset[i];
       }
-      int bit = 0;
-      while(vec & 1) {
-         vec >>=1;
-         bit++;
+   });
+   put_offset(data + BASE_EDGE_OFFSET, numV, offset[numV], large);
+
+   if (edge_format == EDGE_FORMAT_VARINT) {
+      VarintEncode(false, offset, (uint8_t*) (data + BASE_NEIGHBORS));
+      free(offset);
+   } else parallel_for(0, numE, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t i=lo;i<hi;i++) {
+         data[ BASE_NEIGHBORS +i ] = csr_neighbors[i].n;
       }
-      csr_dist[vid] = bit;
-      data[BASE_GROUND_TRUTH + vid] = bit;
+   });
 
-      if (bit >= 28) printf("vid %d color %d\n", vid, bit);
-   }
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint32_t i=lo;i<hi;i++) data[BASE_GROUND_TRUTH + i] = csr_dist[i];
+   });
 
    printf("Writing file \n");
-   fwrite(data, 4, BASE_END, fp);
-   /*
-   for (int i=0;i<BASE_END;i++) {
-      fprintf(fp, "%08x\n", data[i]);
-   } */
-   fclose(fp);
-
-   free(data);
-
+   CloseImage(img);
 }
 
-void WriteOutputMaxflow(FILE* fp) {
+void WriteOutputMaxflow(const char* file) {
    // all offsets are in units of uint32_t. i.e 16 per cache line
    // dist = {height, excess, counter, active, visited, min_neighbor_height,
    // flow[10]}
-   int SIZE_DIST = size_of_field(numV, 64);
-   int SIZE_EDGE_OFFSET = size_of_field(numV+1, 4);
-   int SIZE_NEIGHBORS = size_of_field(numE, 8) ;
-   int SIZE_GROUND_TRUTH =size_of_field(numV, 4); // redundant
-
-   int BASE_DIST = 16;
-   int BASE_EDGE_OFFSET = BASE_DIST + SIZE_DIST;
-   int BASE_NEIGHBORS = BASE_EDGE_OFFSET + SIZE_EDGE_OFFSET;
-   int BASE_GROUND_TRUTH = BASE_NEIGHBORS + SIZE_NEIGHBORS;
-   int BASE_END = BASE_GROUND_TRUTH + SIZE_GROUND_TRUTH;
-
-   uint32_t* data = (uint32_t*) calloc(BASE_END, sizeof(uint32_t));
+   uint64_t SIZE_DIST = size_of_field(numV, 64);
+   uint64_t SIZE_EDGE_OFFSET = size_of_field(numV+1, 4);
+   uint64_t SIZE_NEIGHBORS = size_of_field(numE, 8) ;
+   // ground truth = {max flow, expected excess at endNode, 0...}
+   uint64_t SIZE_GROUND_TRUTH =size_of_field(numV, 4);
+
+   uint64_t BASE_DIST = 16;
+   uint64_t BASE_EDGE_OFFSET = BASE_DIST + SIZE_DIST;
+   uint64_t BASE_NEIGHBORS = BASE_EDGE_OFFSET + SIZE_EDGE_OFFSET;
+   uint64_t BASE_GROUND_TRUTH = BASE_NEIGHBORS + SIZE_NEIGHBORS;
+   uint64_t BASE_END = BASE_GROUND_TRUTH + SIZE_GROUND_TRUTH;
+
+   CheckSmallImage(BASE_END);
+   Image img = OpenImage(file, BASE_END);
+   uint32_t* data = img.data;
 
    uint32_t log_global_relabel_interval = (int) (round(log2(numV))); // closest_power_of_2(numV)
    if (log_global_relabel_interval <= 5) log_global_relabel_interval = 6;
@@ -661,30 +361,25 @@ void WriteOutputMaxflow(FILE* fp) {
    for (int i=0;i<14;i++) {
       printf("header %d: %x\n", i, data[i]);
    }
-   //todo ground truth
-   uint32_t max_degree = 0;
-
-   for (uint32_t i=0;i<numV;i++) {
-      data[BASE_EDGE_OFFSET +i] = csr_offset[i];
-      data[BASE_GROUND_TRUTH +i] = csr_dist[i];
-      //printf("Node %d n_edges %d %d\n", i, csr_offset[i], csr_offset[i+1]-csr_offset[i]);
-      for (int j=0;j<16;j++) {
-         data[BASE_DIST +i * 16 + j] = 0;
+   // (words 0-13 of every node start out as 0)
+   std::vector<uint32_t> max_deg(n_threads, 0);
+   parallel_for(0, numV, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      for (uint32_t i=lo;i<hi;i++) {
+         data[BASE_EDGE_OFFSET +i] = csr_offset[i];
+         data[BASE_DIST+i*16+14] = csr_offset[i];
+         data[BASE_DIST+i*16+15] = csr_offset[i+1];
+         max_deg[t] = std::max(max_deg[t], (uint32_t) (csr_offset[i+1] - csr_offset[i]));
       }
-      data[BASE_DIST+i*16+14] = csr_offset[i];
-      data[BASE_DIST+i*16+15] = csr_offset[i+1];
-      if (csr_offset[i+1] - csr_offset[i] > max_degree)
-          max_degree = csr_offset[i+1]-csr_offset[i];
-
-   }
+   });
    data[BASE_EDGE_OFFSET +numV] = csr_offset[numV];
+   uint32_t max_degree = *std::max_element(max_deg.begin(), max_deg.end());
 
    printf("max deg %d \n", max_degree);
 
    // startNode excess
    uint32_t startNodeExcess= 0;
-   for (Adj e : graph[startNode].adj) {
-      startNodeExcess += e.d_cm;
+   for (uint64_t i = csr_offset[startNode];i<csr_offset[startNode+1];i++) {
+      startNodeExcess += csr_neighbors[i].d_cm;
    }
    // dist structure 0 - excess; 1 - {8'b counter, 24'b min_neighbor_height}
    // 2 - height , 3 - visited
@@ -693,33 +388,93 @@ void WriteOutputMaxflow(FILE* fp) {
    data[BASE_DIST + startNode*16 +2 ] = numV; // height
    printf("StartNodeExcess %d\n", startNodeExcess);
 
-   for (uint32_t i=0;i<numE;i++) {
-      data[ BASE_NEIGHBORS +i*2 ] =  (csr_neighbors[i].index << 24) + csr_neighbors[i].n;
-      data[ BASE_NEIGHBORS +i*2+1 ] = csr_neighbors[i].d_cm;
-      //printf("edge %2d: %2d %2d %2d \t%x\n",i, csr_neighbors[i].n, csr_neighbors[i].d_cm,
-      //         csr_neighbors[i].index, (BASE_NEIGHBORS +i*2)*4);
-   }
+   // The sink ends up with the whole flow as excess. 0xFFFFFFFF is no
+   // ground truth: none was computed, or the flow does not fit in the word.
+   uint32_t ground_truth = (maxflow_value < 0 || maxflow_value >= 0xFFFFFFFFll) ?
+      0xFFFFFFFF : maxflow_value;
+   data[BASE_GROUND_TRUTH + 0] = ground_truth;
+   data[BASE_GROUND_TRUTH + 1] = ground_truth;
+
    printf("Writing file \n");
-   fwrite(data, 4, BASE_END, fp);
-   /*
-   for (int i=0;i<BASE_END;i++) {
-      fprintf(fp, "%08x\n", data[i]);
+   parallel_for(0, numE, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t i=lo;i<hi;i++) {
+         data[ BASE_NEIGHBORS +i*2 ] =  (csr_neighbors[i].index << 24) + csr_neighbors[i].n;
+         data[ BASE_NEIGHBORS +i*2+1 ] = csr_neighbors[i].d_cm;
+      }
+   });
+
+   CloseImage(img);
+}
+
+// Same layout as hls/astar/astar_test.cpp wrote, for one query of a batch
+void WriteOutputAstar(const char* file, const AstarQuery& q) {
+   uint64_t SIZE_DATA = size_of_field(numV, 4);
+   uint64_t SIZE_EDGE_OFFSET = size_of_field(numV+1, 4);
+   uint64_t SIZE_NEIGHBORS = size_of_field(numE, 8);
+   uint64_t SIZE_LATLON = size_of_field(numV, 8);
+   uint64_t SIZE_GROUND_TRUTH = size_of_field(numV, 4);
+
+   uint64_t BASE_DATA = 16;
+   uint64_t BASE_EDGE_OFFSET = BASE_DATA + SIZE_DATA;
+   uint64_t BASE_NEIGHBORS = BASE_EDGE_OFFSET + SIZE_EDGE_OFFSET;
+   uint64_t BASE_LATLON = BASE_NEIGHBORS + SIZE_NEIGHBORS;
+   uint64_t BASE_GROUND_TRUTH = BASE_LATLON + SIZE_LATLON;
+   uint64_t BASE_END = BASE_GROUND_TRUTH + SIZE_GROUND_TRUTH;
+
+   CheckSmallImage(BASE_END);
+   Image img = OpenImage(file, BASE_END);
+   uint32_t* data = img.data;
+
+   data[0] = MAGIC_OP;
+   data[1] = numV;
+   data[2] = numE;
+   data[3] = BASE_EDGE_OFFSET;
+   data[4] = BASE_NEIGHBORS;
+   data[5] = BASE_DATA;
+   data[6] = BASE_LATLON;
+   data[7] = q.start;
+   data[8] = q.dest;
+   data[9] = BASE_GROUND_TRUTH;
+   data[10] = BASE_END;
+   // dest lat, lon (the runtime also fills these in)
+   data[11] = csr_latlon[2 * (uint64_t) q.dest];
+   data[12] = csr_latlon[2 * (uint64_t) q.dest + 1];
+
+   for (int i=0;i<13;i++) {
+      printf("header %d: %d\n", i, data[i]);
    }
-   */
-   fclose(fp);
 
-   free(data);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint32_t i=lo;i<hi;i++) {
+         data[BASE_DATA + i] = ~0;
+         data[BASE_EDGE_OFFSET + i] = csr_offset[i];
+         data[BASE_LATLON + 2*i] = csr_latlon[2*i];
+         data[BASE_LATLON + 2*i+1] = csr_latlon[2*i+1];
+         data[BASE_GROUND_TRUTH + i] = ~0;
+      }
+   });
+   data[BASE_EDGE_OFFSET + numV] = csr_offset[numV];
+
+   parallel_for(0, numE, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t i=lo;i<hi;i++) {
+         data[ BASE_NEIGHBORS +2*i ] = csr_neighbors[i].n;
+         data[ BASE_NEIGHBORS +2*i+1] = csr_neighbors[i].d_cm;
+      }
+   });
+
+   for (auto& vt : q.closed) data[BASE_GROUND_TRUTH + vt.first] = vt.second;
 
+   CloseImage(img);
 }
 
 void WriteDimacs(FILE* fp) {
    // all offsets are in units of uint32_t. i.e 16 per cache line
 
-   fprintf(fp, "p sp %d %d\n", numV, numE);
+   fprintf(fp, "p sp %d %lu\n", numV, numE);
 
    for (uint32_t i=0;i<numV;i++){
-      for (uint32_t a=0;a<graph[i].adj.size();a++){
-          Adj e = graph[i].adj[a];
+      for (uint64_t a = csr_offset[i];a<csr_offset[i+1];a++){
+          Adj e = csr_neighbors[a];
           fprintf(fp, "a %d %d %d\n", i + 1, e.n + 1, e.d_cm);
       }
    }
@@ -728,24 +483,85 @@ void WriteEdgesFile(FILE *fp) {
    // for use in coloring
    fprintf(fp, "EdgeArray");
    for (uint32_t i=0;i<numV;i++){
-      for (uint32_t a=0;a<graph[i].adj.size();a++){
-          Adj e = graph[i].adj[a];
+      for (uint64_t a = csr_offset[i];a<csr_offset[i+1];a++){
+          Adj e = csr_neighbors[a];
           fprintf(fp, "%d %d\n", i + 1, e.n + 1);
       }
    }
 
 }
 
+int prefix(const char* pre, const char* str) {
+   return strncmp(pre, str, strlen(pre)) ==0;
+}
+
+// eg: 512M, 8G
+uint64_t parse_size(const char* s) {
+   char* end;
+   double v = strtod(s, &end);
+   uint64_t scale = 1;
+   switch (*end) {
+      case 'k': case 'K': scale = 1ull << 10; break;
+      case 'm': case 'M': scale = 1ull << 20; break;
+      case 'g': case 'G': scale = 1ull << 30; break;
+      case 't': case 'T': scale = 1ull << 40; break;
+   }
+   return (uint64_t) (v * scale);
+}
+
 int main(int argc, char *argv[]) {
 
    // 0 - load from file .bin format
    // 1 - grid graph
-   char out_file[50];
+   char out_file[256];
    char dimacs_file[50];
    char edgesFile[50];
    char ext[50];
+   char graph_name[256];
+   const char* reorder = NULL;
+   n_threads = std::thread::hardware_concurrency();
+   if (n_threads == 0) n_threads = 1;
+
+   int cur_arg = 1;
+   while (cur_arg < argc && prefix("--", argv[cur_arg])) {
+      const char* val = strstr(argv[cur_arg], "=");
+      val = val ? val+1 : "";
+      if (prefix("--threads", argv[cur_arg])) n_threads = atoi(val);
+      if (prefix("--delta", argv[cur_arg])) sssp_delta = atoi(val);
+      if (prefix("--reorder", argv[cur_arg])) reorder = val;
+      if (prefix("--seed", argv[cur_arg])) gen_seed = strtoull(val, NULL, 0);
+      if (prefix("--no-snapshot", argv[cur_arg])) use_snapshot = false;
+      if (prefix("--packed-edges", argv[cur_arg])) edge_format = EDGE_FORMAT_PACKED;
+      if (prefix("--varint-edges", argv[cur_arg])) edge_format = EDGE_FORMAT_VARINT;
+      if (prefix("--mem-limit", argv[cur_arg])) mem_limit = parse_size(val);
+      if (prefix("--scratch-dir", argv[cur_arg])) scratch_dir = val;
+      if (prefix("--large-image", argv[cur_arg])) large_image = true;
+      if (prefix("--profile", argv[cur_arg])) profile_file = val;
+      cur_arg++;
+   }
+   if (n_threads == 0) n_threads = 1;
+   // The remaining code indexes the positional arguments from 1
+   argv += cur_arg - 1;
+   argc -= cur_arg - 1;
+
    if (argc < 3) {
-      printf("Usage: graph_gen app type=<latlon,grid,gr,color> type_args\n");
+      printf("Usage: graph_gen <--threads=N> <--delta=W> <--reorder=bfs|rcm|degree|hubsort> <--seed=S> <--no-snapshot> <--packed-edges|--varint-edges> <--mem-limit=SIZE> <--scratch-dir=DIR> <--large-image> <--profile=FILE> app type=<latlon,grid,gr,edges,rmat,rgg,chunglu,genrmf> type_args\n");
+      printf("  edges <file> (SNAP text, .mtx, or binary .bel/.bwel; 'color' is an alias)\n");
+      printf("  rmat <scale> <edge_factor>, rgg <n> <degree>, chunglu <n> <degree> <gamma>\n");
+      printf("  flow grid <r> <c> <k>, genrmf <a> <b> <c1> <c2> (eg: genrmf 37 6 1 10000 for genrmf_wide)\n");
+      printf("  --delta=W  sssp reference by parallel delta-stepping with bucket width W\n");
+      printf("             (default: serial radix heap, which also reports Max PQ size)\n");
+      printf("  --no-snapshot  do not read or write <input>.csrbin for gr/edges inputs\n");
+      printf("  --packed-edges  sssp: one word per edge, weight[31:24] neighbor[23:0]\n");
+      printf("  --varint-edges  sssp, color: delta + varint adjacency lists (see varint.cpp)\n");
+      printf("  --mem-limit=SIZE  sssp, color: build the CSR out of core within SIZE (eg: 8G)\n");
+      printf("             of memory, with scratch files in --scratch-dir (default: .)\n");
+      printf("  --large-image  sssp, color: 64-bit section and edge offsets (see graph_gen.h);\n");
+      printf("             the default once an offset does not fit in 32 bits\n");
+      printf("  --profile=FILE  JSON degree/weight distributions and reference task timeline\n");
+      printf("             (sssp: uses the radix heap even with --delta; see profile.cpp)\n");
+      printf("  astar latlon <file.bin> [<start>:<dest> ... | <n_pairs>]  one image per pair,\n");
+      printf("             <n_pairs> random ones by --seed (default: numV/10 : 9*numV/10)\n");
       exit(0);
    }
    if (strcmp(argv[1], "sssp") ==0) {
@@ -760,8 +576,46 @@ int main(int argc, char *argv[]) {
       app = APP_MAXFLOW;
       sprintf(ext, "%s", "flow");
    }
+   if (edge_format == EDGE_FORMAT_PACKED && strcmp(argv[1], "sssp") != 0) {
+      printf("ERROR: --packed-edges is only supported for sssp\n");
+      exit(1);
+   }
+   if (edge_format == EDGE_FORMAT_VARINT && strcmp(argv[1], "sssp") != 0 &&
+         strcmp(argv[1], "color") != 0) {
+      printf("ERROR: --varint-edges is only supported for sssp and color\n");
+      exit(1);
+   }
+   if (strcmp(argv[1], "astar") ==0) {
+      app = APP_ASTAR;
+      sprintf(ext, "%s", "astar");
+      if (strcmp(argv[2], "latlon") != 0) {
+         printf("ERROR: astar needs a latlon input\n");
+         exit(1);
+      }
+   }
+   if (large_image && app != APP_SSSP && app != APP_COLOR) {
+      printf("ERROR: --large-image is only supported for sssp and color\n");
+      exit(1);
+   }
+
+   if (mem_limit && app != APP_SSSP && app != APP_COLOR) {
+      printf("ERROR: --mem-limit is only supported for sssp and color\n");
+      exit(1);
+   }
+   if (mem_limit && reorder) {
+      printf("ERROR: --reorder needs the CSR in memory, it can not be used with --mem-limit\n");
+      exit(1);
+   }
+   // snapshots are loaded into memory
+   if (mem_limit) use_snapshot = false;
 
    startNode = 0;
+   EdgeSource* edges = NULL;
+   bool synthetic = false;
+   bool residual = (app == APP_MAXFLOW);
+   // file input whose CSR is cached in a snapshot
+   const char* snapshot_src = NULL;
+   double t_load = wall_time();
    if (strcmp(argv[2], "latlon") ==0) {
       // astar type
       LoadGraph(argv[3]);
@@ -771,22 +625,30 @@ int main(int argc, char *argv[]) {
          if (argv[3][i] == '/') strStart = i+1;
       }
       sprintf(out_file, "%s.%s", argv[3] +strStart, ext);
+      // astar names its images <graph>_<start>_<dest>.astar
+      snprintf(graph_name, sizeof(graph_name), "%s", argv[3] + strStart);
+      char* dot = strrchr(graph_name, '.');
+      if (dot && strcmp(dot, ".bin") == 0) *dot = 0;
+      if (app == APP_ASTAR) {
+         snprintf(out_file, sizeof(out_file), "%.20s_<start>_<dest>.astar", graph_name);
+      }
    } else if (strcmp(argv[2], "grid") == 0) {
       int r, c;
       if (app==APP_MAXFLOW) {
          r = atoi(argv[3]);
          c = atoi(argv[4]);
          int n_connections = atoi(argv[5]);
-         GenerateGridGraphMaxflow(c, r, n_connections);
+         edges = GenerateGridGraphMaxflow(c, r, n_connections);
       } else {
          r = atoi(argv[3]);
          c = r;
-         GenerateGridGraph(r);
+         edges = GenerateGridGraph(r);
       }
       sprintf(out_file, "grid_%dx%d.%s", r,c, ext);
       sprintf(dimacs_file, "grid_%dx%d.dimacs", r,c);
    } else if (strcmp(argv[2], "gr") == 0) {
-      LoadGraphGR(argv[3]);
+      snapshot_src = argv[3];
+      if (!LoadSnapshot(snapshot_src, residual)) edges = LoadGraphGR(argv[3]);
       int strStart = 0;
       // strip out filename from path
       for (uint32_t i=0;i<strlen(argv[3]);i++) {
@@ -794,40 +656,134 @@ int main(int argc, char *argv[]) {
       }
       sprintf(out_file, "%s.%s", argv[3] +strStart, ext);
       sprintf(edgesFile, "%s.edges", argv[3] +strStart);
-   } else if (strcmp(argv[2], "color") == 0) {
-      // coloring type : eg: com-youtube
-      LoadGraphEdges(argv[3]);
+   } else if (strcmp(argv[2], "color") == 0 || strcmp(argv[2], "edges") == 0) {
+      // edge lists: SNAP (eg: com-youtube), .mtx, .bel/.bwel
+      snapshot_src = argv[3];
+      if (!LoadSnapshot(snapshot_src, residual)) edges = LoadGraphEdgeList(argv[3]);
       int strStart = 0;
       // strip out filename from path
       for (uint32_t i=0;i<strlen(argv[3]);i++) {
          if (argv[3][i] == '/') strStart = i+1;
       }
       sprintf(out_file, "%s.%s", argv[3] +strStart, ext);
+   } else if (strcmp(argv[2], "genrmf") == 0) {
+      edges = GenerateGenRMF(atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]));
+      snprintf(out_file, sizeof(out_file), "genrmf_%s_%s_%s_%s_%lu.%s",
+            argv[3], argv[4], argv[5], argv[6], gen_seed, ext);
+   } else if (strcmp(argv[2], "rmat") == 0) {
+      edges = GenerateRMAT(atoi(argv[3]), atoi(argv[4]));
+      synthetic = true;
+      snprintf(out_file, sizeof(out_file), "rmat_%s_%s.%s", argv[3], argv[4], ext);
+   } else if (strcmp(argv[2], "rgg") == 0) {
+      edges = GenerateRGG(atoi(argv[3]), atof(argv[4]));
+      synthetic = true;
+      snprintf(out_file, sizeof(out_file), "rgg_%s_%s.%s", argv[3], argv[4], ext);
+   } else if (strcmp(argv[2], "chunglu") == 0) {
+      edges = GenerateChungLu(atoi(argv[3]), atof(argv[4]), atof(argv[5]));
+      synthetic = true;
+      snprintf(out_file, sizeof(out_file), "chunglu_%s_%s_%s.%s", argv[3], argv[4], argv[5], ext);
+   }
+   if (mem_limit && !edges) {
+      printf("ERROR: --mem-limit needs an edge list, gr or generated input\n");
+      exit(1);
    }
-   if (app == APP_COLOR) {
+   if (edges) {
+      if (mem_limit) {
+         BuildCSRExternal(*edges, app == APP_COLOR);
+      } else {
+         BuildCSR(*edges, residual);
+      }
+      // file inputs: the load and the CSR build together parse the file
+      if (edges->InputBytes()) {
+         double t = wall_time() - t_load;
+         double mb = edges->InputBytes() / 1e6;
+         printf("Parsed %.1f MB in %.3f s (%.1f MB/s, %d threads)\n",
+               mb, t, mb / t, n_threads);
+      }
+      delete edges;
+      if (snapshot_src && !mem_limit) SaveSnapshot(snapshot_src, residual);
+   }
+   if (synthetic) {
+      PickEndpoints();
+   }
+   if (app == APP_COLOR && !mem_limit) {
       makeUndirectional();
    }
+   if (reorder) {
+      ReorderGraph(reorder, residual);
+   }
+   // the maxflow and astar references and images index edges in 32 bits
+   if ((app == APP_MAXFLOW || app == APP_ASTAR) && numE >= (1ull << 32)) {
+      printf("ERROR: %lu adjacencies do not fit in 32 bits (only sssp and color support more)\n", numE);
+      exit(1);
+   }
+   // astar start:dest pairs, in the ids of the (reordered) output
+   std::vector<AstarQuery> queries;
+   if (app == APP_ASTAR) {
+      for (int i = 4; i < argc; i++) {
+         AstarQuery q = AstarQuery();
+         if (sscanf(argv[i], "%u:%u", &q.start, &q.dest) == 2) {
+            queries.push_back(q);
+         } else {
+            PickAstarQueries(atoi(argv[i]), queries);
+         }
+      }
+      if (argc <= 4) {
+         AstarQuery q = AstarQuery();
+         q.start = numV / 10;
+         q.dest = 9 * (uint64_t) numV / 10;
+         queries.push_back(q);
+      }
+      for (const AstarQuery& q : queries) {
+         if (q.start >= numV || q.dest >= numV) {
+            printf("ERROR: astar pair %u:%u out of range (numV %u)\n",
+                  q.start, q.dest, numV);
+            exit(1);
+         }
+      }
+   }
 
-   ConvertToCSR();
-
+   profiling = profile_file && *profile_file;
    if (app == APP_SSSP) {
       ComputeReference();
+   } else if (app == APP_COLOR) {
+      ComputeColorReference();
+   } else if (app == APP_MAXFLOW) {
+      ComputeMaxflowReference();
+   } else if (app == APP_ASTAR) {
+      ComputeAstarReference(queries);
+   }
+   if (profiling) {
+      if (app == APP_COLOR) {
+         ProfileColorTasks();
+      } else if (app == APP_ASTAR && !queries.empty()) {
+         ProfileAstarTasks(queries[0]);
+      }
+      WriteProfile(profile_file, ext);
    }
 
-   FILE* fp;
-   fp = fopen(out_file, "wb");
-   printf("Writing file %s %p\n", out_file, fp);
+   printf("Writing file %s\n", out_file);
    //fpd = fopen(dimacs_file, "w");
    //WriteDimacs(fpd);
    //fpd = fopen(edgesFile, "w");
    //WriteEdgesFile(fpd);
    //fclose(fpd);
+   double t_write = wall_time();
    if (app == APP_SSSP) {
-      WriteOutput(fp);
+      WriteOutput(out_file);
    } else if (app == APP_COLOR) {
-      WriteOutputColor(fp);
+      WriteOutputColor(out_file);
    } else if (app == APP_MAXFLOW) {
-      WriteOutputMaxflow(fp);
+      WriteOutputMaxflow(out_file);
+   } else if (app == APP_ASTAR) {
+      for (const AstarQuery& q : queries) {
+         char astar_file[400];
+         snprintf(astar_file, sizeof(astar_file), "%s_%u_%u.%s", graph_name,
+               q.start, q.dest, ext);
+         printf("Writing file %s\n", astar_file);
+         WriteOutputAstar(astar_file, q);
+      }
    }
+   printf("Wrote %s in %.3f s\n", out_file, wall_time() - t_write);
    return 0;
 }
@@ -0,0 +1,232 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRAPH_GEN_H
+#define GRAPH_GEN_H
+
+#include <stdint.h>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#define MAGIC_OP 0xdead
+
+// Large images (sssp and color, with --large-image or whenever a section
+// offset or numE needs more than 32 bits) have a LARGE_HEADER_WORDS header:
+// words 0-15 as usual, holding the low halves of 64-bit values, then
+// LARGE_IMAGE_MAGIC, the header size, and (low, high) pairs of words 2-8 in
+// words 18-31. Their edge offsets are (low, high) pairs too.
+#define LARGE_IMAGE_MAGIC 0x6c617267 // "larg", header word 16
+#define LARGE_HEADER_WORDS 32
+
+#define APP_SSSP 0
+#define APP_COLOR 1
+#define APP_MAXFLOW 2
+#define APP_ASTAR 3
+
+// Edge formats (header word 9 for sssp, 10 for color)
+#define EDGE_FORMAT_PAIR 0   // neighbor, weight (color: neighbor)
+#define EDGE_FORMAT_PACKED 1 // weight[31:24] neighbor[23:0] (sssp)
+#define EDGE_FORMAT_VARINT 2 // delta + varint lists, byte offsets; see varint.cpp
+
+struct Adj {
+   uint32_t n;
+   uint32_t d_cm; // edge weight
+   uint32_t index; // index of the reverse edge
+};
+
+// A directed edge, as read from an edge-list style input (0-based ids)
+struct Edge {
+   uint32_t src;
+   uint32_t dst;
+   uint32_t w;
+};
+
+typedef std::function<void(const Edge* edges, uint32_t n)> EdgeSink;
+
+// A stream of edges split into chunks. Chunks may be read concurrently and
+// more than once; every read of a chunk must produce the same edges, which
+// lets BuildCSR make a counting pass and a scatter pass without keeping an
+// edge list around.
+class EdgeSource {
+  public:
+   virtual ~EdgeSource() {}
+   virtual uint32_t NumChunks() const = 0;
+   virtual void ReadChunk(uint32_t chunk, const EdgeSink& sink) const = 0;
+   // size of the input file the edges are parsed from (0 if generated)
+   virtual uint64_t InputBytes() const { return 0; }
+};
+
+// Edges held in memory, for inputs that can not be cheaply replayed.
+class EdgeListSource : public EdgeSource {
+  public:
+   std::vector<Edge> edges;
+   uint32_t NumChunks() const;
+   void ReadChunk(uint32_t chunk, const EdgeSink& sink) const;
+};
+
+extern uint32_t numV;
+extern uint64_t numE;
+extern uint32_t startNode;
+extern uint32_t endNode;
+
+extern int app;
+extern uint32_t edge_format;
+extern bool large_image;
+
+// numV+1 entries; adjacency counts are 64-bit
+extern uint64_t* csr_offset;
+extern Adj* csr_neighbors;
+extern uint32_t* csr_dist;
+// Vertex coordinates in radians (latlon inputs only, NULL otherwise)
+extern double* vertex_lat;
+extern double* vertex_lon;
+
+// csr.cpp
+// Builds csr_offset/csr_neighbors/csr_dist for numV vertices. Each
+// adjacency list is sorted by (neighbor, weight). With residual set (maxflow)
+// every edge also gets a zero-capacity reverse edge, parallel edges are
+// merged by adding their capacities, and Adj.index is filled in.
+void BuildCSR(const EdgeSource& edges, bool residual);
+// Relabels vertex v as new_id[v] (a permutation), including startNode,
+// endNode and the vertex coordinates. Adjacency lists are re-sorted and, if residual, Adj.index is
+// recomputed.
+void PermuteCSR(const uint32_t* new_id, bool residual);
+void ComputeReverseIndex();
+// Replaces the CSR with its symmetric closure, without duplicate edges
+// (color)
+void makeUndirectional();
+
+// csr_external.cpp
+// BuildCSR within mem_limit bytes (--mem-limit) through sorted runs in
+// scratch_dir; csr_neighbors ends up as a shared mapping of a scratch file.
+// undirected also does makeUndirectional (color). Not for residual CSRs.
+extern uint64_t mem_limit;
+extern const char* scratch_dir;
+void BuildCSRExternal(const EdgeSource& edges, bool undirected);
+
+// reorder.cpp
+// --reorder=<bfs|rcm|degree|hubsort>; see reorder.cpp
+void ReorderGraph(const char* method, bool residual);
+
+// varint.cpp
+// Fills byte_offset[0..numV] with the offsets of the --varint-edges lists
+// (with or without weights) and returns their total size
+uint64_t VarintOffsets(bool weights, uint64_t* byte_offset);
+void VarintEncode(bool weights, const uint64_t* byte_offset, uint8_t* out);
+
+// image.cpp
+// A Chronos memory image (32-bit words) mapped onto its output file. The
+// file is created at its final size and reads as zeros until written.
+struct Image {
+   uint32_t* data;
+   uint64_t n_words;
+   int fd;
+};
+Image OpenImage(const char* file, uint64_t n_words);
+void CloseImage(Image& img);
+// Writes and prints header words 0..n-1, plus the extended header if large
+void WriteHeader(uint32_t* data, const uint64_t* header, int n, bool large);
+
+// generators.cpp
+// Synthetic graphs; the result depends only on gen_seed (--seed).
+extern uint64_t gen_seed;
+EdgeSource* GenerateRMAT(uint32_t scale, uint32_t edge_factor);
+EdgeSource* GenerateRGG(uint32_t n, double degree);
+EdgeSource* GenerateChungLu(uint32_t n, double degree, double gamma);
+// Flow networks; these set startNode/endNode themselves
+EdgeSource* GenerateGridGraphMaxflow(uint32_t r, uint32_t c, uint32_t num_connections);
+EdgeSource* GenerateGenRMF(uint32_t a, uint32_t b, uint32_t c1, uint32_t c2);
+// Sets startNode/endNode to vertices that have edges (after BuildCSR)
+void PickEndpoints();
+
+// sssp_ref.cpp
+// Fills csr_dist with distances from startNode. Uses delta-stepping with
+// bucket width sssp_delta if it is non-zero (and not profiling), a serial radix
+// heap otherwise.
+extern uint32_t sssp_delta;
+void ComputeReference();
+
+// color_ref.cpp
+// Greedy coloring into csr_dist, in the color app's order (decreasing
+// degree, then increasing id)
+void ComputeColorReference();
+// Replays the color app's tasks into the profile
+void ProfileColorTasks();
+
+// maxflow_ref.cpp
+// Max flow from startNode to endNode on the residual CSR, into maxflow_value
+extern int64_t maxflow_value;
+void ComputeMaxflowReference();
+
+// astar_ref.cpp
+// One start/dest search of an astar batch. closed holds the (vertex, ts)
+// ground truth; dist is the path length to dest, ~0 if it is unreachable.
+struct AstarQuery {
+   uint32_t start;
+   uint32_t dest;
+   uint32_t dist;
+   uint32_t max_heap;
+   std::vector<std::pair<uint32_t, uint32_t>> closed;
+};
+// Fixed-point (ap_fixed<32,3>) lat, lon of every vertex, as the astar
+// cores read them; filled in by ComputeAstarReference
+extern uint32_t* csr_latlon;
+void ComputeAstarReference(std::vector<AstarQuery>& queries);
+// Appends n random pairs of vertices with edges (by gen_seed)
+void PickAstarQueries(uint32_t n, std::vector<AstarQuery>& queries);
+// Replays the astar app's tasks for q into the profile
+void ProfileAstarTasks(const AstarQuery& q);
+
+// gr_parser.cpp
+// Reads the 'p' and 'n' lines (numV, numE, startNode, endNode) and returns
+// a source that parses the arcs on demand.
+EdgeSource* LoadGraphGR(const char* file);
+
+// edgelist_parser.cpp
+// SNAP text, Matrix Market (.mtx) or binary (.bel/.bwel) edge lists. Sets
+// numV, compacting sparse ids (except for .mtx, which is sized by its
+// header); see edgelist_parser.cpp.
+EdgeSource* LoadGraphEdgeList(const char* file);
+
+// snapshot.cpp
+// Caches the CSR built from a file input next to it (--no-snapshot turns
+// this off). LoadSnapshot returns false if there is no valid snapshot for
+// the source; SaveSnapshot is called right after BuildCSR.
+extern bool use_snapshot;
+bool LoadSnapshot(const char* source, bool residual);
+void SaveSnapshot(const char* source, bool residual);
+// csr_offset/csr_neighbors point into the snapshot's (private) mapping after
+// LoadSnapshot; this frees either array, malloc'd or mapped.
+void FreeCSRArray(void* p);
+
+// profile.cpp
+// --profile=<file>: degree and weight distributions plus a task timeline of
+// the reference run, as JSON; see profile.cpp. The references call
+// ProfileTask for each task they commit while profiling is set.
+extern const char* profile_file;
+extern bool profiling;
+void ProfileTask(uint32_t ts, uint32_t fanout, bool useful, uint64_t pending);
+void WriteProfile(const char* file, const char* app_name);
+
+#endif
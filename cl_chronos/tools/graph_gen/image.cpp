@@ -0,0 +1,76 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "graph_gen.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+Image OpenImage(const char* file, uint64_t n_words) {
+   Image img;
+   img.n_words = n_words;
+   img.fd = open(file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (img.fd < 0) {
+      printf("ERROR: Could not open output file %s\n", file);
+      exit(1);
+   }
+   uint64_t size = n_words * sizeof(uint32_t);
+   // ftruncate leaves the file sparse, so untouched words read back as 0
+   // just like the calloc'd buffer this replaces.
+   if (ftruncate(img.fd, size) != 0) {
+      printf("ERROR: Could not resize output file %s to %lu bytes\n", file, size);
+      exit(1);
+   }
+   img.data = (uint32_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+         img.fd, 0);
+   if (img.data == MAP_FAILED) {
+      printf("ERROR: Could not mmap output file %s\n", file);
+      exit(1);
+   }
+   return img;
+}
+
+void CloseImage(Image& img) {
+   munmap(img.data, img.n_words * sizeof(uint32_t));
+   close(img.fd);
+   img.data = NULL;
+}
+
+void WriteHeader(uint32_t* data, const uint64_t* header, int n, bool large) {
+   for (int i=0;i<n;i++) {
+      data[i] = header[i];
+      printf("header %d: %lu\n", i, header[i]);
+   }
+   if (large) {
+      data[16] = LARGE_IMAGE_MAGIC;
+      data[17] = LARGE_HEADER_WORDS;
+      for (int i=2;i<=8;i++) {
+         data[18 + 2*(i-2)] = header[i];
+         data[19 + 2*(i-2)] = header[i] >> 32;
+      }
+      printf("header 16-31: large image\n");
+   }
+}
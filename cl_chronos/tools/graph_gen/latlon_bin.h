@@ -0,0 +1,130 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Reader for the latlon .bin road graphs (eg: monaco.bin, germany.bin),
+// shared by graph_gen and hls/astar/astar_test.cpp. Header-only, so the HLS
+// testbench can include it without any of the other graph_gen sources.
+//
+// File format (little endian, packed):
+//   uint32 magic (0x150842A7), uint32 numV
+//   per vertex: double lat, double lon (radians), uint32 n,
+//               uint32 neighbor[n], double dist[n] (in units of the
+//               Earth's radius)
+//
+// The file is mmap'd and scanned once to find where each vertex's record
+// starts and its first edge index. The records can then be decoded in any
+// order, in parallel, straight into the caller's arrays.
+
+#ifndef LATLON_BIN_H
+#define LATLON_BIN_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "text_util.h"
+
+class LatLonBin {
+  public:
+   static const uint32_t MAGIC_NUMBER = 0x150842A7 + 0; // increment every time you change the file format
+
+   uint32_t numV;
+   uint64_t numE;
+   // (numV+1 entries) byte offset of each record, index of its first edge
+   std::vector<uint64_t> record;
+   std::vector<uint64_t> edge_offset;
+
+   void open(const char* file) {
+      f.open(file);
+      if (f.size < 8 || read<uint32_t>(0) != MAGIC_NUMBER) {
+         printf("ERROR: Wrong input file format (magic number %d, expected %d)\n",
+               f.size < 4 ? 0 : read<uint32_t>(0), MAGIC_NUMBER);
+         exit(1);
+      }
+      numV = read<uint32_t>(4);
+      printf("Reading %d nodes...\n", numV);
+
+      record.resize(numV + 1);
+      edge_offset.resize(numV + 1);
+      uint64_t pos = 8;
+      uint64_t e = 0;
+      for (uint32_t i = 0; i < numV; i++) {
+         if (pos + RECORD_HEADER > f.size) truncated();
+         record[i] = pos;
+         edge_offset[i] = e;
+         uint32_t n = read<uint32_t>(pos + 2 * sizeof(double));
+         e += n;
+         pos += RECORD_HEADER + (uint64_t) n * (sizeof(uint32_t) + sizeof(double));
+      }
+      if (pos > f.size) truncated();
+      record[numV] = pos;
+      edge_offset[numV] = e;
+      numE = e;
+   }
+
+   double lat(uint32_t v) const { return read<double>(record[v]); }
+   double lon(uint32_t v) const { return read<double>(record[v] + sizeof(double)); }
+   uint32_t degree(uint32_t v) const { return edge_offset[v+1] - edge_offset[v]; }
+   uint32_t neighbor(uint32_t v, uint32_t j) const {
+      return read<uint32_t>(record[v] + RECORD_HEADER + j * sizeof(uint32_t));
+   }
+   double dist(uint32_t v, uint32_t j) const {
+      return read<double>(record[v] + RECORD_HEADER
+            + degree(v) * sizeof(uint32_t) + j * sizeof(double));
+   }
+
+   // Calls fn(lo, hi) for contiguous vertex ranges on n_threads threads
+   template <typename F>
+   void ForVertices(uint32_t n_threads, F fn) const {
+      if (n_threads == 0) n_threads = 1;
+      std::vector<std::thread> workers;
+      for (uint32_t t = 0; t < n_threads; t++) {
+         uint32_t lo = (uint64_t) numV * t / n_threads;
+         uint32_t hi = (uint64_t) numV * (t+1) / n_threads;
+         if (t + 1 == n_threads) fn(lo, hi);
+         else workers.push_back(std::thread(fn, lo, hi));
+      }
+      for (auto& w : workers) w.join();
+   }
+
+  private:
+   static const uint64_t RECORD_HEADER = 2 * sizeof(double) + sizeof(uint32_t);
+   MappedFile f;
+
+   // Records are packed, so the fields are not aligned
+   template <typename T>
+   T read(uint64_t pos) const {
+      T val;
+      memcpy(&val, f.data + pos, sizeof(T));
+      return val;
+   }
+
+   void truncated() const {
+      printf("ERROR: Truncated input file\n");
+      exit(1);
+   }
+};
+
+#endif
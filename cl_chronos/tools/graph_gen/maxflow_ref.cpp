@@ -0,0 +1,251 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Maxflow ground truth: sequential highest-label push-relabel in the style
+// of HIPR (Cherkassky & Goldberg), with the global relabeling and gap
+// heuristics.
+//
+// Only the first phase is run: once no vertex that can still reach the sink
+// is active, the sink excess is the max-flow value. (The second phase, which
+// returns stranded excess to the source, does not change it.) The value is
+// cross-checked against the capacity of the resulting min cut.
+//
+// Works on the residual CSR from BuildCSR: Adj.d_cm is the capacity and
+// Adj.index the position of the reverse arc in the neighbor's list.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int64_t maxflow_value = -1;
+
+namespace {
+
+const uint32_t NIL = ~0u;
+// HIPR's global update frequency: relabel from the sink after
+// ALPHA*n + m units of relabeling work (BETA units + the degree per relabel)
+const uint64_t ALPHA = 6, BETA = 12;
+
+class PushRelabel {
+   uint32_t n, s, t;
+   std::vector<int64_t> res;    // residual capacity per arc
+   std::vector<int64_t> excess;
+   std::vector<uint32_t> h, cur;
+   // all vertices below n, in a doubly linked list per height (for gaps)
+   std::vector<uint32_t> next, prev, level_head;
+   // active vertices, a stack per height
+   std::vector<std::vector<uint32_t>> active;
+   int64_t max_active;
+   uint32_t max_level;
+   uint64_t work;
+
+   inline uint32_t rev(uint32_t e) const {
+      return csr_offset[csr_neighbors[e].n] + csr_neighbors[e].index;
+   }
+
+   void level_add(uint32_t v) {
+      uint32_t l = h[v];
+      next[v] = level_head[l];
+      prev[v] = NIL;
+      if (level_head[l] != NIL) prev[level_head[l]] = v;
+      level_head[l] = v;
+      max_level = std::max(max_level, l);
+   }
+
+   void level_remove(uint32_t v) {
+      uint32_t l = h[v];
+      if (prev[v] != NIL) next[prev[v]] = next[v];
+      else level_head[l] = next[v];
+      if (next[v] != NIL) prev[next[v]] = prev[v];
+   }
+
+   void activate(uint32_t v) {
+      active[h[v]].push_back(v);
+      max_active = std::max(max_active, (int64_t) h[v]);
+   }
+
+   // Exact distances to the sink in the residual graph; vertices that can
+   // not reach it are set to n and drop out.
+   void global_relabel() {
+      global_relabels++;
+      work = 0;
+      std::fill(h.begin(), h.end(), n);
+      for (uint32_t l = 0; l <= max_level; l++) {
+         level_head[l] = NIL;
+         active[l].clear();
+      }
+      max_level = 0;
+      max_active = -1;
+
+      std::vector<uint32_t> queue;
+      queue.reserve(n);
+      h[t] = 0;
+      queue.push_back(t);
+      for (uint64_t head = 0; head < queue.size(); head++) {
+         uint32_t v = queue[head];
+         for (uint32_t e = csr_offset[v]; e < csr_offset[v+1]; e++) {
+            uint32_t u = csr_neighbors[e].n;
+            if (h[u] == n && u != s && res[rev(e)] > 0) {
+               h[u] = h[v] + 1;
+               queue.push_back(u);
+            }
+         }
+      }
+      for (uint32_t v : queue) {
+         cur[v] = csr_offset[v];
+         level_add(v);
+         if (excess[v] > 0 && v != t) activate(v);
+      }
+   }
+
+   // Level l has become empty: nothing above it can reach the sink
+   void gap(uint32_t l) {
+      gaps++;
+      for (uint32_t k = l + 1; k <= max_level; k++) {
+         for (uint32_t v = level_head[k]; v != NIL; v = next[v]) h[v] = n;
+         level_head[k] = NIL;
+         active[k].clear();
+      }
+      max_level = l ? l - 1 : 0;
+      max_active = std::min(max_active, (int64_t) l - 1);
+   }
+
+   void discharge(uint32_t u) {
+      while (excess[u] > 0) {
+         uint32_t end = csr_offset[u+1];
+         for (uint32_t& e = cur[u]; e < end; e++) {
+            uint32_t v = csr_neighbors[e].n;
+            if (res[e] == 0 || h[u] != h[v] + 1) continue;
+            int64_t delta = std::min(excess[u], res[e]);
+            res[e] -= delta;
+            res[rev(e)] += delta;
+            if (excess[v] == 0 && v != t) activate(v);
+            excess[v] += delta;
+            excess[u] -= delta;
+            pushes++;
+            if (excess[u] == 0) return;
+         }
+
+         // relabel
+         relabels++;
+         uint32_t old = h[u];
+         uint32_t new_h = n;
+         for (uint32_t e = csr_offset[u]; e < end; e++) {
+            if (res[e] > 0) new_h = std::min(new_h, h[csr_neighbors[e].n] + 1);
+         }
+         work += BETA + end - csr_offset[u];
+         level_remove(u);
+         if (level_head[old] == NIL) {
+            h[u] = n;
+            gap(old);
+            return;
+         }
+         if (new_h >= n) {
+            h[u] = n;
+            return;
+         }
+         h[u] = new_h;
+         cur[u] = csr_offset[u];
+         level_add(u);
+      }
+   }
+
+  public:
+   uint64_t pushes, relabels, global_relabels, gaps;
+
+   PushRelabel(uint32_t s, uint32_t t) :
+      n(numV), s(s), t(t), res(numE), excess(numV, 0), h(numV, 0),
+      cur(numV), next(numV), prev(numV), level_head(numV + 1, NIL),
+      active(numV + 1), max_active(-1), max_level(0), work(0),
+      pushes(0), relabels(0), global_relabels(0), gaps(0) {
+      for (uint32_t e = 0; e < numE; e++) res[e] = csr_neighbors[e].d_cm;
+   }
+
+   int64_t run() {
+      h[s] = n;
+      for (uint32_t e = csr_offset[s]; e < csr_offset[s+1]; e++) {
+         int64_t delta = res[e];
+         if (delta == 0 || csr_neighbors[e].n == s) continue;
+         res[e] = 0;
+         res[rev(e)] += delta;
+         excess[csr_neighbors[e].n] += delta;
+         excess[s] -= delta;
+      }
+      global_relabel();
+
+      uint64_t update_threshold = 2 * (ALPHA * n + numE);
+      while (max_active >= 0) {
+         if (active[max_active].empty()) {
+            max_active--;
+            continue;
+         }
+         uint32_t u = active[max_active].back();
+         active[max_active].pop_back();
+         discharge(u);
+         if (work > update_threshold) global_relabel();
+      }
+      return excess[t];
+   }
+
+   // Capacity of the cut between the vertices that can still reach the sink
+   // in the residual graph and the rest (valid after run()).
+   int64_t min_cut() {
+      global_relabel();
+      int64_t cut = 0;
+      for (uint32_t u = 0; u < n; u++) {
+         if (h[u] < n) continue;
+         for (uint32_t e = csr_offset[u]; e < csr_offset[u+1]; e++) {
+            if (h[csr_neighbors[e].n] < n) cut += csr_neighbors[e].d_cm;
+         }
+      }
+      return cut;
+   }
+};
+
+} // namespace
+
+void ComputeMaxflowReference() {
+   printf("Compute Reference (push-relabel, %d -> %d)\n", startNode, endNode);
+   if (startNode >= numV || endNode >= numV || startNode == endNode) {
+      printf("ERROR: invalid source/sink %d -> %d\n", startNode, endNode);
+      exit(1);
+   }
+   double t_start = wall_time();
+   PushRelabel pr(startNode, endNode);
+   maxflow_value = pr.run();
+   double t = wall_time() - t_start;
+   int64_t cut = pr.min_cut();
+   printf("Time taken :%f msec\n", t * 1000);
+   printf("Max flow %ld (%lu pushes, %lu relabels, %lu global relabels, %lu gaps)\n",
+         maxflow_value, pr.pushes, pr.relabels, pr.global_relabels, pr.gaps);
+   if (cut != maxflow_value) {
+      printf("ERROR: min cut %ld does not match max flow %ld\n", cut, maxflow_value);
+      exit(1);
+   }
+   if (maxflow_value >= 0xFFFFFFFFll) {
+      printf("WARNING: max flow does not fit in the 32-bit ground truth word, "
+            "the image will have none\n");
+   }
+}
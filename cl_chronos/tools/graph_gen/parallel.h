@@ -0,0 +1,157 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Minimal std::thread helpers shared by the graph_gen passes.
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern uint32_t n_threads;
+
+// Runs fn(tid) on n_threads threads (the calling thread acts as thread 0).
+template <typename F>
+void parallel_run(F fn) {
+   std::vector<std::thread> workers;
+   for (uint32_t t = 1; t < n_threads; t++) {
+      workers.push_back(std::thread(fn, t));
+   }
+   fn(0);
+   for (auto& w : workers) w.join();
+}
+
+// Statically splits [begin, end) into one contiguous range per thread and
+// calls fn(tid, lo, hi). Thread t always gets the t-th range, so per-thread
+// partial results can be combined in a deterministic order.
+template <typename F>
+void parallel_for(uint64_t begin, uint64_t end, F fn) {
+   uint64_t n = end - begin;
+   parallel_run([&](uint32_t t) {
+      uint64_t lo = begin + n * t / n_threads;
+      uint64_t hi = begin + n * (t+1) / n_threads;
+      if (lo < hi) fn(t, lo, hi);
+   });
+}
+
+// Dynamically hands out tasks 0..n_tasks-1; use when the cost per task is
+// uneven (eg: parsing chunks of a text file).
+template <typename F>
+void parallel_tasks(uint32_t n_tasks, F fn) {
+   std::atomic<uint32_t> next(0);
+   parallel_run([&](uint32_t t) {
+      uint32_t i;
+      while ( (i = next.fetch_add(1)) < n_tasks) fn(t, i);
+   });
+}
+
+// Exclusive prefix sum over a[0..n), in place. a[n] is set to the total,
+// which is also returned.
+template <typename T>
+T parallel_prefix_sum(T* a, uint64_t n) {
+   std::vector<T> partial(n_threads + 1, 0);
+   parallel_for(0, n, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      T sum = 0;
+      for (uint64_t i = lo; i < hi; i++) sum += a[i];
+      partial[t+1] = sum;
+   });
+   for (uint32_t t = 0; t < n_threads; t++) partial[t+1] += partial[t];
+   parallel_for(0, n, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      T sum = partial[t];
+      for (uint64_t i = lo; i < hi; i++) {
+         T v = a[i];
+         a[i] = sum;
+         sum += v;
+      }
+   });
+   a[n] = partial[n_threads];
+   return a[n];
+}
+
+// Stable LSD radix sort of the low key_bits bits of a[0..n), 8 bits per
+// pass, using tmp (also n entries) as the scatter buffer. The pointers are
+// swapped after every pass; on return a points to the sorted data.
+inline void parallel_radix_sort(uint64_t*& a, uint64_t*& tmp, uint64_t n,
+      uint32_t key_bits) {
+   std::vector<uint64_t> count(n_threads * 256);
+   for (uint32_t shift = 0; shift < key_bits; shift += 8) {
+      std::fill(count.begin(), count.end(), 0);
+      parallel_for(0, n, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+         uint64_t* c = &count[t * 256];
+         for (uint64_t i = lo; i < hi; i++) c[(a[i] >> shift) & 0xff]++;
+      });
+      // digit-major, then thread order keeps the sort stable
+      uint64_t sum = 0;
+      for (uint32_t d = 0; d < 256; d++) {
+         for (uint32_t t = 0; t < n_threads; t++) {
+            uint64_t c = count[t * 256 + d];
+            count[t * 256 + d] = sum;
+            sum += c;
+         }
+      }
+      parallel_for(0, n, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+         uint64_t* c = &count[t * 256];
+         for (uint64_t i = lo; i < hi; i++) tmp[c[(a[i] >> shift) & 0xff]++] = a[i];
+      });
+      std::swap(a, tmp);
+   }
+}
+
+// Reusable barrier for the threads of a parallel_run, for algorithms that
+// proceed in rounds and would otherwise respawn their threads every round.
+class Barrier {
+   std::mutex m;
+   std::condition_variable cv;
+   uint32_t n;
+   uint32_t count;
+   uint64_t generation;
+  public:
+   explicit Barrier(uint32_t n) : n(n), count(0), generation(0) {}
+   void wait() {
+      std::unique_lock<std::mutex> lock(m);
+      uint64_t gen = generation;
+      if (++count == n) {
+         count = 0;
+         generation++;
+         cv.notify_all();
+      } else {
+         cv.wait(lock, [&] { return generation != gen; });
+      }
+   }
+};
+
+inline double wall_time() {
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+#endif
@@ -0,0 +1,227 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --profile=<file>: a JSON report to size a configuration for a graph before
+// running it (eg: LOG_TQ_SIZE and N_TILES in validation/scripts/configs).
+//
+//   "degree", "weight"   out-degree and edge weight distributions ("weight"
+//                        is null for color, which has none)
+//   "tasks"              the app's tasks as the reference commits them:
+//                        total, useful (sssp/astar: improved their vertex),
+//                        max_pending, fan-out (children per task), and the
+//                        number of tasks run at each pending queue size
+//   "timeline"           up to 2*TIMELINE_BINS consecutive slices of those
+//                        tasks, with the pending queue and the frontier
+//                        width (tasks that share a timestamp, which can all
+//                        run at once) over time
+//
+// Histograms are log2: entry 0 counts zeros, entry k values in
+// [2^(k-1), 2^k). Tasks follow the sssp app (one task per relaxation), the
+// riscv color app and the astar app (first query of the batch); the queue
+// is ordered by timestamp only, so ties can commit in any order. maxflow has
+// no task model here and reports "tasks": null.
+//
+// Pending tasks above the task queues' capacity (N_TILES << LOG_TQ_SIZE) get
+// spilled, so max_pending and the pending histogram estimate spill traffic,
+// and the frontier width the parallelism available without speculation.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+const char* profile_file = NULL;
+bool profiling = false;
+
+namespace {
+
+const uint32_t TIMELINE_BINS = 256;
+const uint32_t LOG2_BUCKETS = 65;
+
+inline uint32_t log2_bucket(uint64_t x) {
+   return x ? 64 - __builtin_clzll(x) : 0;
+}
+
+struct Histogram {
+   uint64_t count[LOG2_BUCKETS] = {};
+   uint64_t n = 0, sum = 0, max = 0;
+   uint64_t min = ~0ull;
+
+   void add(uint64_t x, uint64_t times = 1) {
+      count[log2_bucket(x)] += times;
+      n += times;
+      sum += x * times;
+      max = std::max(max, x);
+      min = std::min(min, x);
+   }
+   void merge(const Histogram& h) {
+      for (uint32_t i = 0; i < LOG2_BUCKETS; i++) count[i] += h.count[i];
+      n += h.n;
+      sum += h.sum;
+      max = std::max(max, h.max);
+      min = std::min(min, h.min);
+   }
+   void write(FILE* fp) const {
+      uint32_t last = 0;
+      for (uint32_t i = 0; i < LOG2_BUCKETS; i++) if (count[i]) last = i;
+      fprintf(fp, "{\"min\": %lu, \"max\": %lu, \"mean\": %.3f, \"log2_histogram\": [",
+            n ? min : 0, max, n ? (double) sum / n : 0.0);
+      for (uint32_t i = 0; i <= last; i++) fprintf(fp, "%s%lu", i ? ", " : "", count[i]);
+      fprintf(fp, "]}");
+   }
+};
+
+// A slice of consecutive tasks. A run is a group of consecutive tasks with
+// the same timestamp; its width counts towards the slice where it ends.
+struct Bin {
+   uint64_t first_task;
+   uint32_t first_ts, last_ts;
+   uint64_t tasks, useful;
+   uint64_t max_pending, end_pending;
+   uint64_t timestamps, max_width;
+
+   void merge(const Bin& b) {
+      timestamps += b.timestamps - (b.first_ts == last_ts);
+      last_ts = b.last_ts;
+      tasks += b.tasks;
+      useful += b.useful;
+      max_pending = std::max(max_pending, b.max_pending);
+      end_pending = b.end_pending;
+      max_width = std::max(max_width, b.max_width);
+   }
+};
+
+struct TaskStats {
+   uint64_t total = 0, useful = 0, max_pending = 0;
+   Histogram fanout;
+   Histogram pending;
+   std::vector<Bin> bins;
+   uint64_t bin_width = 1;
+   uint32_t run_ts = 0;
+   uint64_t run_width = 0;
+
+   void end_run() {
+      Bin& b = bins.back();
+      b.max_width = std::max(b.max_width, run_width);
+      run_width = 0;
+   }
+};
+
+TaskStats stats;
+
+} // namespace
+
+void ProfileTask(uint32_t ts, uint32_t fanout, bool useful, uint64_t pending) {
+   TaskStats& s = stats;
+   if (s.total > 0 && ts != s.run_ts) s.end_run();
+   if (s.total % s.bin_width == 0) {
+      if (s.bins.size() == 2 * TIMELINE_BINS) {
+         // halve the resolution
+         for (uint32_t i = 0; i < TIMELINE_BINS; i++) {
+            s.bins[i] = s.bins[2*i];
+            s.bins[i].merge(s.bins[2*i+1]);
+         }
+         s.bins.resize(TIMELINE_BINS);
+         s.bin_width *= 2;
+      }
+      Bin b = {s.total, ts, ts, 0, 0, 0, 0, 1, 0};
+      s.bins.push_back(b);
+   } else if (ts != s.run_ts) {
+      s.bins.back().timestamps++;
+   }
+   s.run_ts = ts;
+   s.run_width++;
+
+   Bin& b = s.bins.back();
+   b.last_ts = ts;
+   b.tasks++;
+   b.useful += useful;
+   b.max_pending = std::max(b.max_pending, pending);
+   b.end_pending = pending;
+
+   s.total++;
+   s.useful += useful;
+   s.max_pending = std::max(s.max_pending, pending);
+   s.fanout.add(fanout);
+   s.pending.add(pending);
+}
+
+void WriteProfile(const char* file, const char* app_name) {
+   FILE* fp = fopen(file, "w");
+   if (!fp) {
+      printf("ERROR: Could not open profile file %s\n", file);
+      exit(1);
+   }
+   std::vector<Histogram> degree(n_threads), weight(n_threads);
+   parallel_for(0, numV, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) {
+         degree[t].add(csr_offset[v+1] - csr_offset[v]);
+         for (uint64_t e = csr_offset[v]; e < csr_offset[v+1]; e++) {
+            weight[t].add(csr_neighbors[e].d_cm);
+         }
+      }
+   });
+   for (uint32_t t = 1; t < n_threads; t++) {
+      degree[0].merge(degree[t]);
+      weight[0].merge(weight[t]);
+   }
+
+   fprintf(fp, "{\n");
+   fprintf(fp, "  \"app\": \"%s\",\n", app_name);
+   fprintf(fp, "  \"numV\": %u,\n", numV);
+   fprintf(fp, "  \"numE\": %lu,\n", numE);
+   fprintf(fp, "  \"degree\": ");
+   degree[0].write(fp);
+   fprintf(fp, ",\n  \"weight\": ");
+   if (app == APP_COLOR) fprintf(fp, "null");
+   else weight[0].write(fp);
+
+   TaskStats& s = stats;
+   if (s.total == 0) {
+      fprintf(fp, ",\n  \"tasks\": null,\n  \"timeline\": null\n}\n");
+      fclose(fp);
+      printf("Wrote profile %s\n", file);
+      return;
+   }
+   s.end_run();
+   fprintf(fp, ",\n  \"tasks\": {\"total\": %lu, \"useful\": %lu, \"max_pending\": %lu,",
+         s.total, s.useful, s.max_pending);
+   fprintf(fp, "\n    \"fanout\": ");
+   s.fanout.write(fp);
+   fprintf(fp, ",\n    \"pending\": ");
+   s.pending.write(fp);
+   fprintf(fp, "},\n  \"timeline\": [\n");
+   for (uint32_t i = 0; i < s.bins.size(); i++) {
+      const Bin& b = s.bins[i];
+      fprintf(fp, "    {\"first_task\": %lu, \"ts\": %u, \"tasks\": %lu, \"useful\": %lu, "
+            "\"max_pending\": %lu, \"pending\": %lu, \"timestamps\": %lu, "
+            "\"mean_width\": %.3f, \"max_width\": %lu}%s\n",
+            b.first_task, b.first_ts, b.tasks, b.useful, b.max_pending,
+            b.end_pending, b.timestamps, (double) b.tasks / b.timestamps,
+            b.max_width, i + 1 < s.bins.size() ? "," : "");
+   }
+   fprintf(fp, "  ]\n}\n");
+   fclose(fp);
+   printf("Wrote profile %s (%lu tasks, max pending %lu)\n", file, s.total, s.max_pending);
+}
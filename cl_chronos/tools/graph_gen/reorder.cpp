@@ -0,0 +1,152 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Vertex relabeling for locality (--reorder).
+//
+// Vertices that are touched close together in time should have nearby ids,
+// so that their dist/data entries and adjacency lists share cache lines in
+// the L2 and DRAM pages for the prefetcher.
+//  bfs     - BFS order from startNode (remaining components in id order)
+//  rcm     - reverse Cuthill-McKee: BFS from low-degree roots, visiting
+//            neighbors by increasing degree, then reversed
+//  degree  - by decreasing degree
+//  hubsort - vertices with above-average degree first, by decreasing
+//            degree; the rest keep their relative order
+// Each order is a function of the graph only, so the output is
+// deterministic.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+inline uint32_t degree(uint32_t v) {
+   return csr_offset[v+1] - csr_offset[v];
+}
+
+// Appends to order every vertex reachable from root that is not yet
+// visited. If by_degree, each vertex's unvisited neighbors are appended in
+// increasing degree order.
+void bfs(uint32_t root, bool by_degree, std::vector<bool>& visited,
+      std::vector<uint32_t>& order) {
+   uint64_t head = order.size();
+   visited[root] = true;
+   order.push_back(root);
+   std::vector<uint32_t> next;
+   while (head < order.size()) {
+      uint32_t u = order[head++];
+      next.clear();
+      for (uint64_t i = csr_offset[u]; i < csr_offset[u+1]; i++) {
+         uint32_t v = csr_neighbors[i].n;
+         if (!visited[v]) {
+            visited[v] = true;
+            next.push_back(v);
+         }
+      }
+      if (by_degree) {
+         std::stable_sort(next.begin(), next.end(), [](uint32_t a, uint32_t b) {
+            return degree(a) < degree(b);
+         });
+      }
+      order.insert(order.end(), next.begin(), next.end());
+   }
+}
+
+// all vertices sorted by degree, ties by id
+std::vector<uint32_t> by_degree(bool decreasing) {
+   std::vector<uint32_t> order(numV);
+   for (uint32_t v = 0; v < numV; v++) order[v] = v;
+   std::stable_sort(order.begin(), order.end(), [=](uint32_t a, uint32_t b) {
+      return decreasing ? degree(a) > degree(b) : degree(a) < degree(b);
+   });
+   return order;
+}
+
+// Mean |u - v| over all edges; a rough measure of how far apart in memory
+// the endpoints of an edge are.
+double mean_id_gap() {
+   std::vector<double> sum(n_threads, 0);
+   parallel_for(0, numV, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      for (uint64_t u = lo; u < hi; u++) {
+         for (uint64_t i = csr_offset[u]; i < csr_offset[u+1]; i++) {
+            uint32_t v = csr_neighbors[i].n;
+            sum[t] += (u > v) ? u - v : v - u;
+         }
+      }
+   });
+   double total = 0;
+   for (double s : sum) total += s;
+   return numE ? total / numE : 0;
+}
+
+} // namespace
+
+void ReorderGraph(const char* method, bool residual) {
+   double t_start = wall_time();
+   double gap_before = mean_id_gap();
+
+   // order[i] is the old id of the vertex that gets new id i
+   std::vector<uint32_t> order;
+   order.reserve(numV);
+   if (strcmp(method, "bfs") == 0) {
+      std::vector<bool> visited(numV, false);
+      if (startNode < numV) bfs(startNode, false, visited, order);
+      for (uint32_t v = 0; v < numV; v++) {
+         if (!visited[v]) bfs(v, false, visited, order);
+      }
+   } else if (strcmp(method, "rcm") == 0) {
+      std::vector<bool> visited(numV, false);
+      for (uint32_t r : by_degree(false)) {
+         if (!visited[r]) bfs(r, true, visited, order);
+      }
+      std::reverse(order.begin(), order.end());
+   } else if (strcmp(method, "degree") == 0) {
+      order = by_degree(true);
+   } else if (strcmp(method, "hubsort") == 0) {
+      double avg_degree = numV ? (double) numE / numV : 0;
+      for (uint32_t v : by_degree(true)) {
+         if (degree(v) <= avg_degree) break;
+         order.push_back(v);
+      }
+      for (uint32_t v = 0; v < numV; v++) {
+         if (degree(v) <= avg_degree) order.push_back(v);
+      }
+   } else {
+      printf("ERROR: Unknown reorder method %s (bfs, rcm, degree, hubsort)\n",
+            method);
+      exit(1);
+   }
+
+   std::vector<uint32_t> new_id(numV);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t i = lo; i < hi; i++) new_id[order[i]] = i;
+   });
+   PermuteCSR(new_id.data(), residual);
+
+   printf("Reordered (%s) in %.3f s; mean neighbor id gap %.1f -> %.1f\n",
+         method, wall_time() - t_start, gap_before, mean_id_gap());
+}
@@ -0,0 +1,262 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// CSR snapshots of file inputs.
+//
+// After a .gr or edge-list input has been parsed, the CSR from BuildCSR is
+// saved as <source>.csrbin (<source>.residual.csrbin for maxflow, whose CSR
+// has the reverse edges). Later runs on the same source map the snapshot
+// privately and point csr_offset/csr_neighbors into the mapping, skipping
+// the parse. The checksum pass reads every page in up front; only the pages
+// modified later (eg: by makeUndirectional) are copied.
+//
+// Layout: a 64-byte SnapshotHeader, then csr_offset (numV+1 words) and
+// csr_neighbors (numE Adj), each padded to 64 bytes. The snapshot is used
+// only if the version, the residual flag, the source's size and mtime, and
+// a checksum over both arrays all match; anything else rebuilds it. It is
+// written to a temporary name and renamed, so a killed run never leaves a
+// partial snapshot behind.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool use_snapshot = true;
+
+namespace {
+
+// The mapping csr_offset and csr_neighbors point into after LoadSnapshot
+char* snapshot_map = NULL;
+uint64_t snapshot_size = 0;
+uint32_t snapshot_released = 0;
+
+const uint64_t SNAPSHOT_MAGIC = 0x4e4942525343ull; // "CSRBIN"
+const uint32_t SNAPSHOT_VERSION = 2; // 2: 64-bit offsets
+const uint64_t HASH_BLOCK = 1 << 20; // words
+
+struct SnapshotHeader {
+   uint64_t magic;
+   uint32_t version;
+   uint32_t residual;
+   uint32_t numV;
+   uint32_t startNode, endNode;
+   uint32_t pad;
+   uint64_t numE;
+   uint64_t src_size;
+   uint64_t src_mtime_ns;
+   uint64_t checksum;
+};
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header size");
+
+inline uint64_t pad64(uint64_t bytes) {
+   return (bytes + 63) / 64 * 64;
+}
+
+inline uint64_t mix(uint64_t h, uint64_t w) {
+   h ^= w * 0x9e3779b97f4a7c15ull;
+   h = (h << 31) | (h >> 33);
+   return h * 0xbf58476d1ce4e5b9ull;
+}
+
+// A checksum of bytes (a multiple of 8) at src. Blocks are hashed in
+// parallel and the block hashes combined in order, so the result does not
+// depend on n_threads.
+uint64_t Hash(const void* src, uint64_t bytes) {
+   const uint64_t* s = (const uint64_t*) src;
+   uint64_t n_words = bytes / 8;
+   uint32_t n_blocks = (n_words + HASH_BLOCK - 1) / HASH_BLOCK;
+   std::vector<uint64_t> block_hash(n_blocks);
+   parallel_tasks(n_blocks, [&](uint32_t, uint32_t b) {
+      uint64_t lo = b * HASH_BLOCK;
+      uint64_t hi = std::min(lo + HASH_BLOCK, n_words);
+      uint64_t h = b;
+      for (uint64_t i = lo; i < hi; i++) h = mix(h, s[i]);
+      block_hash[b] = h;
+   });
+   uint64_t h = n_words;
+   for (uint64_t bh : block_hash) h = mix(h, bh);
+   return h;
+}
+
+std::string SnapshotName(const char* source, bool residual) {
+   return std::string(source) + (residual ? ".residual.csrbin" : ".csrbin");
+}
+
+bool StatSource(const char* source, uint64_t* size, uint64_t* mtime_ns) {
+   struct stat st;
+   if (stat(source, &st) != 0) return false;
+   *size = st.st_size;
+   *mtime_ns = st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+   return true;
+}
+
+} // namespace
+
+void FreeCSRArray(void* p) {
+   char* c = (char*) p;
+   if (snapshot_map && c >= snapshot_map && c < snapshot_map + snapshot_size) {
+      // both arrays are in the one mapping
+      if (++snapshot_released == 2) {
+         munmap(snapshot_map, snapshot_size);
+         snapshot_map = NULL;
+      }
+      return;
+   }
+   free(p);
+}
+
+bool LoadSnapshot(const char* source, bool residual) {
+   if (!use_snapshot) return false;
+   std::string name = SnapshotName(source, residual);
+   int fd = open(name.c_str(), O_RDONLY);
+   if (fd < 0) return false;
+
+   double t_start = wall_time();
+   bool ok = false;
+   struct stat st;
+   fstat(fd, &st);
+   uint64_t size = st.st_size;
+   char* map = NULL;
+   if (size >= sizeof(SnapshotHeader)) {
+      map = (char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED) map = NULL;
+   }
+   close(fd);
+   if (map) {
+      madvise(map, size, MADV_SEQUENTIAL);
+      const SnapshotHeader* h = (const SnapshotHeader*) map;
+      uint64_t src_size = 0, src_mtime = 0;
+      StatSource(source, &src_size, &src_mtime);
+      uint64_t offset_bytes = pad64(sizeof(uint64_t) * (h->numV + 1ull));
+      uint64_t adj_bytes = pad64(sizeof(Adj) * h->numE);
+      if (h->magic != SNAPSHOT_MAGIC || h->version != SNAPSHOT_VERSION) {
+         printf("Snapshot %s has an old format, rebuilding\n", name.c_str());
+      } else if (h->residual != residual || h->src_size != src_size ||
+            h->src_mtime_ns != src_mtime) {
+         printf("Snapshot %s is stale, rebuilding\n", name.c_str());
+      } else if (size != sizeof(SnapshotHeader) + offset_bytes + adj_bytes) {
+         printf("Snapshot %s is truncated, rebuilding\n", name.c_str());
+      } else {
+         char* p = map + sizeof(SnapshotHeader);
+         uint64_t sum = mix(Hash(p, offset_bytes),
+               Hash(p + offset_bytes, adj_bytes));
+         if (sum != h->checksum) {
+            printf("Snapshot %s has a bad checksum, rebuilding\n", name.c_str());
+         } else {
+            csr_offset = (uint64_t*) p;
+            csr_neighbors = (Adj*) (p + offset_bytes);
+            numV = h->numV;
+            numE = h->numE;
+            startNode = h->startNode;
+            endNode = h->endNode;
+            ok = true;
+         }
+      }
+      if (ok) {
+         // the writers and --reorder do not read it front to back
+         madvise(map, size, MADV_NORMAL);
+         snapshot_map = map;
+         snapshot_size = size;
+         snapshot_released = 0;
+      } else {
+         munmap(map, size);
+      }
+   }
+   if (!ok) return false;
+
+   csr_dist = (uint32_t*) malloc(sizeof(uint32_t) * numV);
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) csr_dist[v] = ~0;
+   });
+   printf("Read %d nodes, %lu adjacencies\n", numV, numE);
+   printf("Loaded snapshot %s in %.3f s\n", name.c_str(), wall_time() - t_start);
+   return true;
+}
+
+void SaveSnapshot(const char* source, bool residual) {
+   if (!use_snapshot) return;
+   double t_start = wall_time();
+   std::string name = SnapshotName(source, residual);
+   std::string tmp_name = name + ".tmp";
+
+   SnapshotHeader h;
+   memset(&h, 0, sizeof(h));
+   h.magic = SNAPSHOT_MAGIC;
+   h.version = SNAPSHOT_VERSION;
+   h.residual = residual;
+   h.numV = numV;
+   h.numE = numE;
+   h.startNode = startNode;
+   h.endNode = endNode;
+   if (!StatSource(source, &h.src_size, &h.src_mtime_ns)) return;
+
+   uint64_t offset_bytes = pad64(sizeof(uint64_t) * (numV + 1ull));
+   uint64_t adj_bytes = pad64(sizeof(Adj) * numE);
+   uint64_t size = sizeof(SnapshotHeader) + offset_bytes + adj_bytes;
+   // The snapshot is only a cache: if it can not be written (eg. a
+   // read-only input directory), carry on without it.
+   int fd = open(tmp_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0) {
+      printf("WARNING: Could not write snapshot %s\n", name.c_str());
+      return;
+   }
+   char* map = NULL;
+   if (ftruncate(fd, size) == 0) {
+      map = (char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (map == MAP_FAILED) map = NULL;
+   }
+   close(fd);
+   if (!map) {
+      printf("WARNING: Could not write snapshot %s\n", name.c_str());
+      unlink(tmp_name.c_str());
+      return;
+   }
+
+   // Copy the arrays first; the padding beyond them is already zero in
+   // the new file, and is hashed from there.
+   char* p = map + sizeof(SnapshotHeader);
+   memcpy(p, csr_offset, sizeof(uint64_t) * (numV + 1ull));
+   parallel_for(0, numE, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      memcpy(p + offset_bytes + lo * sizeof(Adj), csr_neighbors + lo,
+            (hi - lo) * sizeof(Adj));
+   });
+   h.checksum = mix(Hash(p, offset_bytes),
+         Hash(p + offset_bytes, adj_bytes));
+   memcpy(map, &h, sizeof(h));
+   munmap(map, size);
+
+   if (rename(tmp_name.c_str(), name.c_str()) != 0) {
+      printf("WARNING: Could not write snapshot %s\n", name.c_str());
+      unlink(tmp_name.c_str());
+      return;
+   }
+   printf("Wrote snapshot %s in %.3f s\n", name.c_str(), wall_time() - t_start);
+}
@@ -0,0 +1,254 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// SSSP ground truth (csr_dist) for the sssp image.
+//
+// The serial reference mirrors what the sssp app does in hardware: every
+// relaxation becomes a queue entry, and an entry only does work if it
+// improves its vertex. It therefore reports the number of tasks the app
+// will run ("edges traversed") and the peak number of pending tasks
+// ("Max PQ size"). The queue is a radix heap, which is valid because
+// Dijkstra never pushes a key smaller than the last one popped.
+//
+// Delta-stepping (--delta=W) computes the same distances with all threads
+// but prunes redundant relaxations, so it can not observe the queue size.
+// It reports the task count, which depends only on the final distances,
+// and the largest bucket instead.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <time.h>
+
+uint32_t sssp_delta = 0;
+
+namespace {
+
+class RadixHeap {
+   struct Entry {
+      uint32_t key;
+      uint32_t vid;
+   };
+   // bucket i > 0 holds keys whose highest bit differing from last is i-1
+   std::vector<Entry> buckets[33];
+   uint32_t last;
+   uint64_t n;
+
+   static int bucket(uint32_t key, uint32_t last) {
+      return key == last ? 0 : 32 - __builtin_clz(key ^ last);
+   }
+
+  public:
+   RadixHeap() : last(0), n(0) {}
+   uint64_t size() const { return n; }
+   bool empty() const { return n == 0; }
+
+   void push(uint32_t key, uint32_t vid) {
+      Entry e = {key, vid};
+      buckets[bucket(key, last)].push_back(e);
+      n++;
+   }
+
+   void pop(uint32_t* key, uint32_t* vid) {
+      if (buckets[0].empty()) {
+         int i = 1;
+         while (buckets[i].empty()) i++;
+         uint32_t new_last = ~0u;
+         for (const Entry& e : buckets[i]) new_last = std::min(new_last, e.key);
+         last = new_last;
+         for (const Entry& e : buckets[i]) buckets[bucket(e.key, last)].push_back(e);
+         buckets[i].clear();
+      }
+      *key = buckets[0].back().key;
+      *vid = buckets[0].back().vid;
+      buckets[0].pop_back();
+      n--;
+   }
+};
+
+void ComputeReferenceRadix() {
+   printf("Compute Reference\n");
+   RadixHeap pq;
+   uint64_t max_pq_size = 0;
+   uint64_t edges_traversed = 0;
+
+   clock_t t = clock();
+   pq.push(0, startNode);
+   while (!pq.empty()) {
+      uint32_t dist, vid;
+      pq.pop(&dist, &vid);
+      max_pq_size = std::max(max_pq_size, pq.size());
+      edges_traversed++;
+      bool useful = csr_dist[vid] > dist;
+      if (useful) {
+         csr_dist[vid] = dist;
+         for (uint64_t i = csr_offset[vid]; i < csr_offset[vid+1]; i++) {
+            pq.push(dist + csr_neighbors[i].d_cm, csr_neighbors[i].n);
+         }
+      }
+      if (profiling) {
+         ProfileTask(dist, useful ? csr_offset[vid+1] - csr_offset[vid] : 0,
+               useful, pq.size());
+      }
+   }
+   t = clock() - t;
+   printf("Time taken :%f msec\n", ((float)t * 1000)/CLOCKS_PER_SEC);
+   printf("Node %d dist:%d\n", numV -1, csr_dist[numV-1]);
+   printf("Max PQ size %lu\n", max_pq_size);
+   printf("edges traversed %lu\n", edges_traversed);
+}
+
+// Bins [curr, curr + DELTA_WINDOW) of each thread are kept in a ring; any
+// vertex further out goes to the thread's far list and is re-binned once
+// the window drains. This bounds memory when distances are large compared
+// to delta (eg: latlon graphs, in cm).
+const uint32_t DELTA_WINDOW = 1024;
+
+struct ThreadBins {
+   std::vector<uint32_t> bins[DELTA_WINDOW];
+   std::vector<uint32_t> far;
+};
+
+inline bool atomic_min(uint32_t* p, uint32_t val) {
+   uint32_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+   while (val < old) {
+      if (__atomic_compare_exchange_n(p, &old, val, true,
+               __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+         return true;
+      }
+   }
+   return false;
+}
+
+void ComputeReferenceDelta(uint32_t delta) {
+   printf("Compute Reference (delta-stepping, delta %d, %d threads)\n",
+         delta, n_threads);
+   const uint64_t NONE = ~0ull;
+   std::vector<ThreadBins> tb(n_threads);
+   std::vector<uint64_t> next_bin(n_threads), far_min(n_threads), bin_size(n_threads);
+   std::vector<uint32_t> frontier(1, startNode);
+   uint64_t max_frontier = 1;
+   uint64_t rounds = 0;
+   Barrier barrier(n_threads);
+
+   double t_start = wall_time();
+   csr_dist[startNode] = 0;
+   // Every thread runs the same loop and derives the same curr from the
+   // shared per-thread results, so only the frontier needs a single writer.
+   parallel_run([&](uint32_t t) {
+      ThreadBins& my = tb[t];
+      uint64_t curr = 0;
+      auto bin_push = [&](uint32_t v, uint32_t d) {
+         uint64_t b = d / delta;
+         if (b < curr + DELTA_WINDOW) my.bins[b % DELTA_WINDOW].push_back(v);
+         else my.far.push_back(v);
+      };
+
+      while (true) {
+         uint64_t n = frontier.size();
+         for (uint64_t i = n * t / n_threads; i < n * (t+1) / n_threads; i++) {
+            uint32_t u = frontier[i];
+            uint32_t du = __atomic_load_n(&csr_dist[u], __ATOMIC_RELAXED);
+            // stale: u was already settled in an earlier bin
+            if (du / delta < curr) continue;
+            for (uint64_t e = csr_offset[u]; e < csr_offset[u+1]; e++) {
+               uint32_t v = csr_neighbors[e].n;
+               uint32_t dv = du + csr_neighbors[e].d_cm;
+               if (atomic_min(&csr_dist[v], dv)) bin_push(v, dv);
+            }
+         }
+
+         next_bin[t] = NONE;
+         for (uint64_t b = curr; b < curr + DELTA_WINDOW; b++) {
+            if (!my.bins[b % DELTA_WINDOW].empty()) {
+               next_bin[t] = b;
+               break;
+            }
+         }
+         barrier.wait();
+         uint64_t next = *std::min_element(next_bin.begin(), next_bin.end());
+         if (next == NONE) {
+            // Window drained; restart it at the lowest far bin
+            far_min[t] = NONE;
+            for (uint32_t v : my.far) {
+               far_min[t] = std::min(far_min[t], (uint64_t) (csr_dist[v] / delta));
+            }
+            barrier.wait();
+            next = *std::min_element(far_min.begin(), far_min.end());
+            if (next == NONE) break;
+            curr = next;
+            std::vector<uint32_t> far;
+            far.swap(my.far);
+            for (uint32_t v : far) bin_push(v, csr_dist[v]);
+         }
+         curr = next;
+
+         std::vector<uint32_t>& bin = my.bins[curr % DELTA_WINDOW];
+         bin_size[t] = bin.size();
+         barrier.wait();
+         uint64_t offset = 0, total = 0;
+         for (uint32_t k = 0; k < n_threads; k++) {
+            if (k < t) offset += bin_size[k];
+            total += bin_size[k];
+         }
+         if (t == 0) {
+            frontier.resize(total);
+            max_frontier = std::max(max_frontier, total);
+            rounds++;
+         }
+         barrier.wait();
+         std::copy(bin.begin(), bin.end(), frontier.begin() + offset);
+         bin.clear();
+         barrier.wait();
+      }
+   });
+   double t_ref = wall_time() - t_start;
+
+   // A vertex is expanded once, at its final distance, no matter in which
+   // order the tasks run.
+   std::vector<uint64_t> expanded(n_threads, 0);
+   parallel_for(0, numV, [&](uint32_t t, uint64_t lo, uint64_t hi) {
+      for (uint64_t v = lo; v < hi; v++) {
+         if (csr_dist[v] != ~0u) expanded[t] += csr_offset[v+1] - csr_offset[v];
+      }
+   });
+   uint64_t edges_traversed = 1;
+   for (uint64_t e : expanded) edges_traversed += e;
+
+   printf("Time taken :%f msec\n", t_ref * 1000);
+   printf("Node %d dist:%d\n", numV -1, csr_dist[numV-1]);
+   printf("Max bucket size %lu (%lu rounds)\n", max_frontier, rounds);
+   printf("edges traversed %lu\n", edges_traversed);
+}
+
+} // namespace
+
+void ComputeReference() {
+   // the profile needs the tasks in commit order, which only the heap has
+   if (sssp_delta && !profiling) {
+      ComputeReferenceDelta(sssp_delta);
+   } else {
+      ComputeReferenceRadix();
+   }
+}
@@ -0,0 +1,136 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Helpers shared by the mmap'd text input parsers. All parse functions take
+// an explicit end pointer and never read past it.
+
+#ifndef TEXT_UTIL_H
+#define TEXT_UTIL_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A read-only mapping of a whole input file
+struct MappedFile {
+   const char* data;
+   uint64_t size;
+   int fd;
+
+   MappedFile() : data(NULL), size(0), fd(-1) {}
+   ~MappedFile() {
+      if (data) munmap((void*) data, size);
+      if (fd >= 0) close(fd);
+   }
+
+   void open(const char* file) {
+      fd = ::open(file, O_RDONLY);
+      if (fd < 0) {
+         printf("ERROR: Could not open input file\n");
+         exit(1);
+      }
+      struct stat st;
+      fstat(fd, &st);
+      size = st.st_size;
+      if (size == 0) {
+         printf("ERROR: Empty input file\n");
+         exit(1);
+      }
+      data = (const char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+         printf("ERROR: Could not mmap input file\n");
+         exit(1);
+      }
+      madvise((void*) data, size, MADV_WILLNEED);
+   }
+};
+
+inline const char* next_line(const char* p, const char* end) {
+   const char* nl = (const char*) memchr(p, '\n', end - p);
+   return nl ? nl + 1 : end;
+}
+
+inline const char* skip_blanks(const char* p, const char* end) {
+   while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+   return p;
+}
+
+inline bool is_digit(char c) {
+   return (unsigned) (c - '0') < 10;
+}
+
+inline const char* parse_uint(const char* p, const char* end, uint32_t* val) {
+   p = skip_blanks(p, end);
+   uint32_t v = 0;
+   while (p < end && is_digit(*p)) {
+      v = v * 10 + (*p - '0');
+      p++;
+   }
+   *val = v;
+   return p;
+}
+
+inline const char* parse_uint64(const char* p, const char* end, uint64_t* val) {
+   p = skip_blanks(p, end);
+   uint64_t v = 0;
+   while (p < end && is_digit(*p)) {
+      v = v * 10 + (*p - '0');
+      p++;
+   }
+   *val = v;
+   return p;
+}
+
+// [-]digits[.digits][e[-]digits]
+inline const char* parse_double(const char* p, const char* end, double* val) {
+   p = skip_blanks(p, end);
+   double sign = 1, v = 0;
+   if (p < end && (*p == '-' || *p == '+')) sign = (*p++ == '-') ? -1 : 1;
+   while (p < end && is_digit(*p)) v = v * 10 + (*p++ - '0');
+   if (p < end && *p == '.') {
+      double scale = 0.1;
+      for (p++; p < end && is_digit(*p); p++, scale *= 0.1) v += (*p - '0') * scale;
+   }
+   if (p < end && (*p == 'e' || *p == 'E')) {
+      int esign = 1, e = 0;
+      p++;
+      if (p < end && (*p == '-' || *p == '+')) esign = (*p++ == '-') ? -1 : 1;
+      while (p < end && is_digit(*p)) e = e * 10 + (*p++ - '0');
+      while (e-- > 0) v = (esign > 0) ? v * 10 : v / 10;
+   }
+   *val = sign * v;
+   return p;
+}
+
+inline const char* skip_token(const char* p, const char* end) {
+   p = skip_blanks(p, end);
+   while (p < end && *p != ' ' && *p != '\t' && *p != '\n') p++;
+   return p;
+}
+
+#endif
@@ -0,0 +1,121 @@
+/** $lic$
+ * Copyright (C) 2014-2019 by Massachusetts Institute of Technology
+ *
+ * This file is part of the Chronos FPGA Acceleration Framework.
+ *
+ * Chronos is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this framework in your research, we request that you reference
+ * the Chronos paper ("Chronos: Efficient Speculative Parallelism for
+ * Accelerators", Abeydeera and Sanchez, ASPLOS-25, March 2020), and that
+ * you send us a citation of your work.
+ *
+ * Chronos is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Delta + varint adjacency lists (--varint-edges), decoded by
+// riscv_code/sssp-varint and riscv_code/color-varint.
+//
+// The edge offsets are byte offsets into the neighbor section, where the
+// list of vertex v is
+//   varint degree
+//   per edge, by increasing neighbor id:
+//     varint gap  (zigzag(n - v) for the first edge, n - previous n after)
+//     varint weight  (sssp only)
+// Varints are LEB128: 7 bits per byte, low bits first, bit 7 set on every
+// byte but the last.
+
+#include "graph_gen.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+inline uint32_t varint_size(uint32_t x) {
+   uint32_t n = 1;
+   while (x >= 0x80) {
+      x >>= 7;
+      n++;
+   }
+   return n;
+}
+
+inline uint8_t* put_varint(uint8_t* p, uint32_t x) {
+   while (x >= 0x80) {
+      *p++ = (x & 0x7f) | 0x80;
+      x >>= 7;
+   }
+   *p++ = x;
+   return p;
+}
+
+inline uint32_t zigzag(int32_t x) {
+   return ((uint32_t) x << 1) ^ (uint32_t) (x >> 31);
+}
+
+bool adj_less(const Adj& a, const Adj& b) {
+   return (a.n < b.n) || (a.n == b.n && a.d_cm < b.d_cm);
+}
+
+// Calls fn(gap, weight) for each edge of v in encoding order. Lists from
+// BuildCSR are already sorted; latlon inputs are sorted into tmp.
+template <typename F>
+void for_each_gap(uint32_t v, std::vector<Adj>& tmp, F fn) {
+   const Adj* begin = csr_neighbors + csr_offset[v];
+   const Adj* end = csr_neighbors + csr_offset[v+1];
+   if (!std::is_sorted(begin, end, adj_less)) {
+      tmp.assign(begin, end);
+      std::sort(tmp.begin(), tmp.end(), adj_less);
+      begin = tmp.data();
+      end = begin + tmp.size();
+   }
+   uint32_t prev = v;
+   for (const Adj* a = begin; a < end; a++) {
+      uint32_t gap = (a == begin) ? zigzag((int32_t) (a->n - v)) : a->n - prev;
+      fn(gap, a->d_cm);
+      prev = a->n;
+   }
+}
+
+} // namespace
+
+uint64_t VarintOffsets(bool weights, uint64_t* byte_offset) {
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      std::vector<Adj> tmp;
+      for (uint32_t v = lo; v < hi; v++) {
+         uint64_t n = varint_size(csr_offset[v+1] - csr_offset[v]);
+         for_each_gap(v, tmp, [&](uint32_t gap, uint32_t w) {
+            n += varint_size(gap);
+            if (weights) n += varint_size(w);
+         });
+         byte_offset[v] = n;
+      }
+   });
+   uint64_t total = parallel_prefix_sum(byte_offset, numV);
+   printf("Varint edges: %lu bytes, %.2f per edge (vs %d)\n", total,
+         numE ? (double) total / numE : 0.0, weights ? 8 : 4);
+   return total;
+}
+
+void VarintEncode(bool weights, const uint64_t* byte_offset, uint8_t* out) {
+   parallel_for(0, numV, [&](uint32_t, uint64_t lo, uint64_t hi) {
+      std::vector<Adj> tmp;
+      for (uint32_t v = lo; v < hi; v++) {
+         uint8_t* p = put_varint(out + byte_offset[v], csr_offset[v+1] - csr_offset[v]);
+         for_each_gap(v, tmp, [&](uint32_t gap, uint32_t w) {
+            p = put_varint(p, gap);
+            if (weights) p = put_varint(p, w);
+         });
+      }
+   });
+}
@@ -230,6 +230,13 @@ initial begin
          dist_actual[23:16] = tb.hm_get_byte( BASE_END*4 + file[9]*64+ 2);
          dist_actual[31:24] = tb.hm_get_byte( BASE_END*4 + file[9]*64+ 3);
       $display("vid:%3d flow:%d", file[9], dist_actual);
+      // ground truth: {max flow, sink excess}
+      dist_ref = file[file[6]+1];
+      if (dist_ref != '1) begin
+         if (dist_actual != dist_ref) num_errors++;
+         $display("max flow:%d, ref:%d, %s", dist_actual, dist_ref,
+               dist_actual == dist_ref ? "MATCH" : "FAIL");
+      end
    end
    if (APP_NAME == "color" ) begin
       BASE_END = file[8];